@@ -9,6 +9,7 @@
 #define __GB_H__
 
 #include "types.h"
+#include "save_alloc.h"
 
 enum {
 	GB_SAVE_SIZE = 0x8000
@@ -31,15 +32,30 @@ extern "C" {
 #endif
 
 void gb_text_to_ucs2(char16_t *dst, char8_t *src, size_t size);
+void gb_text_to_ucs2_batch(char16_t *dst, const char8_t *src, size_t size, size_t stride, size_t count);
 void ucs2_to_gb_text(char8_t *dst, char16_t *src, size_t size);
 
 gb_save_t *gb_read_save(const uint8_t *);
+gb_save_t *gb_read_save_with(const uint8_t *, const save_allocator_t *);
+gb_save_t *gb_read_save_in(const uint8_t *, void *block);
+size_t gb_save_object_size(void);
 void gb_free_save(gb_save_t *);
 
 uint8_t *gb_create_data();
 
 void gb_write_save(uint8_t *, const gb_save_t *);
 
+/**
+ * @brief Recalculate the stats of every party pokemon from its level, DVs and stat exp.
+ * Box pokemon don't store stats in these games, they are calculated when withdrawn.
+ * @param save The save to update.
+ * @param base_stats Base HP, attack, defense, speed, special attack and special defense (stat_stat_t
+ * order), indexed by the species byte as stored in the save: the internal index on RBY, the
+ * pokedex number on GSC. RBY uses the special attack column for special.
+ * @return The number of pokemon updated, or -1 if the save type is unknown.
+ */
+int gb_calc_party_stats(gb_save_t *save, const uint8_t base_stats[256][6]);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,12 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include "pc_bitmap.h"
+#include "save_diff.h"
+#include "save_archive.h"
+#include "save_journal.h"
+#include "save_alloc.h"
+#include "save_export.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -428,14 +434,93 @@ typedef struct {
 } gba_trainer_t;
 #pragma pack(pop)
 
+/**
+ * @brief Flags that control how a gba_text_query_t matches a name.
+ */
+typedef enum {
+	/** The whole name must match the query. */
+	GBA_TEXT_MATCH_EXACT = 0,
+	/** The name only has to start with the query. */
+	GBA_TEXT_MATCH_PREFIX = 1,
+	/** Upper and lower case letters are treated as the same letter. */
+	GBA_TEXT_MATCH_IGNORE_CASE = 2
+} gba_text_match_t;
+
+enum {
+	/** The longest text a gba_text_query_t can hold. */
+	GBA_TEXT_QUERY_LENGTH = 15
+};
+
+/**
+ * A query is encoded into the GBA character set once, after which it can be compared
+ * against the raw nickname and OT name fields of pk3_box_t without decoding them.
+ * @brief A name encoded for searching GBA text fields.
+ */
+typedef struct {
+	/** @brief The encoded text, padded with terminators. */
+	uint64_t text[2];
+	/** @brief Which bytes of a field take part in the comparison. */
+	uint64_t mask[2];
+	/** @brief The gba_text_match_t flags the query was built with. */
+	uint32_t flags;
+} gba_text_query_t;
+
+enum {
+	/** The number of species in the GBA pokedex, national numbers 1 to 386. */
+	GBA_POKEDEX_SIZE = 386,
+	/** The bytes needed to hold one bit per pokedex entry. */
+	GBA_POKEDEX_BYTES = (GBA_POKEDEX_SIZE + 7) / 8
+};
+
+/**
+ * @brief The pokedex flag sets.
+ */
+typedef enum {
+	/** Seen, kept in three copies that the game expects to agree. */
+	GBA_POKEDEX_LIST_SEEN,
+	/** Owned. */
+	GBA_POKEDEX_LIST_OWNED
+} gba_pokedex_list_t;
+
+/**
+ * @brief How gba_pokedex_merge() combines two pokedexes.
+ */
+typedef enum {
+	/** Set every entry set in either save. */
+	GBA_POKEDEX_UNION,
+	/** Clear every entry set in the other save. */
+	GBA_POKEDEX_DIFFERENCE,
+	/** Keep only entries set in both saves. */
+	GBA_POKEDEX_INTERSECTION
+} gba_pokedex_op_t;
+
 void gba_text_to_ucs2(char16_t *dst, char8_t *src, size_t size);
+void gba_text_to_ucs2_batch(char16_t *dst, const char8_t *src, size_t size, size_t stride, size_t count);
 void ucs2_to_gba_text(char8_t *dst, char16_t *src, size_t size);
 
+void gba_text_query_init(gba_text_query_t *, const char16_t *, size_t, gba_text_match_t);
+uint8_t gba_text_query_match(const gba_text_query_t *, const char8_t *, size_t);
+
+uint8_t gba_is_gba_save(const uint8_t *);
+uint16_t gba_check_main_save(const uint8_t *);
 gba_save_t *gba_read_main_save(const uint8_t *);
 gba_save_t *gba_read_backup_save(const uint8_t *);
+gba_save_t *gba_read_main_save_with(const uint8_t *, const save_allocator_t *);
+gba_save_t *gba_read_main_save_in(const uint8_t *, void *block);
+size_t gba_save_object_size(void);
 void gba_write_main_save(uint8_t *, const gba_save_t *);
 void gba_write_backup_save(uint8_t *, const gba_save_t *);
 void gba_save_game(uint8_t *, gba_save_t *);
+void gba_update_main_save(uint8_t *, gba_save_t *);
+void gba_mark_dirty(gba_save_t *, const void *, size_t);
+uint16_t gba_get_dirty(gba_save_t *);
+int gba_journal_start(gba_save_t *);
+void gba_journal_stop(gba_save_t *);
+save_journal_t *gba_get_journal(gba_save_t *);
+void gba_journal_record(gba_save_t *, const void *ptr, size_t size);
+int gba_journal_checkpoint(gba_save_t *);
+int gba_journal_undo(gba_save_t *);
+int gba_journal_redo(gba_save_t *);
 
 void gba_free_save(gba_save_t *);
 uint8_t *gba_create_data();
@@ -455,12 +540,32 @@ gba_trainer_t *gba_get_trainer(gba_save_t *);
 gba_party_t *gba_get_party(gba_save_t *);
 gba_pc_t *gba_get_pc(gba_save_t *);
 
+size_t gba_pc_find_nickname(gba_pc_t *, const gba_text_query_t *, pk3_box_t **, size_t);
+size_t gba_pc_find_ot_name(gba_pc_t *, const gba_text_query_t *, pk3_box_t **, size_t);
+size_t gba_pc_count_boxes(gba_pc_t *, uint8_t counts[GBA_BOX_COUNT]);
+void gba_pc_refresh_occupancy(gba_save_t *);
+uint8_t gba_pc_is_occupied(gba_save_t *, size_t box, size_t slot);
+void gba_pc_set_occupied(gba_save_t *, size_t box, size_t slot, uint8_t occupied);
+size_t gba_pc_reserve(gba_save_t *, pc_fill_t, size_t count, uint16_t *slots);
+size_t gba_pc_compact(gba_save_t *);
+
 uint8_t gba_pokedex_get_national(gba_save_t *);
 void gba_pokedex_set_national(gba_save_t *, uint8_t);
 uint8_t gba_pokedex_get_owned(gba_save_t *, size_t);
 void gba_pokedex_set_owned(gba_save_t *, size_t, uint8_t);
 uint8_t gba_pokedex_get_seen(gba_save_t *, size_t);
 void gba_pokedex_set_seen(gba_save_t *, size_t, uint8_t);
+size_t gba_pokedex_count(gba_save_t *, gba_pokedex_list_t, size_t first, size_t count);
+void gba_pokedex_set_range(gba_save_t *, gba_pokedex_list_t, size_t first, size_t count, uint8_t set);
+void gba_pokedex_set_all(gba_save_t *, gba_pokedex_list_t, uint8_t set);
+void gba_pokedex_merge(gba_save_t *, gba_save_t *other, gba_pokedex_list_t, gba_pokedex_op_t);
+void gba_pokedex_export(gba_save_t *, gba_pokedex_list_t, uint8_t bits[GBA_POKEDEX_BYTES]);
+void gba_pokedex_import(gba_save_t *, gba_pokedex_list_t, const uint8_t bits[GBA_POKEDEX_BYTES]);
+
+uint16_t gba_diff_sections(const uint8_t *, const uint8_t *);
+int gba_diff(const uint8_t *, const uint8_t *, save_diff_fn_t, void *user);
+int gba_archive_read_section(const save_archive_t *, size_t save, uint8_t section_id, uint8_t *out);
+int gba_export(save_export_t *, gba_save_t *, uint32_t id);
 
 //TODO rival name, badges, day care pokemon (then GBA is done :D)
 
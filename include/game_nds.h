@@ -11,6 +11,12 @@
 #include "prng.h"
 #include "checksum.h"
 #include "pkm.h"
+#include "pc_bitmap.h"
+#include "pc_sort.h"
+#include "save_diff.h"
+#include "save_journal.h"
+#include "save_alloc.h"
+#include "save_export.h"
 #include <stdlib.h>
 #include <stdint.h>
 
@@ -36,6 +42,10 @@ enum {
 	NDS_BOX_COUNT = 18,
 	/** The number of pokemon in a box. */
 	NDS_POKEMON_IN_BOX = 30,
+	/** nds_get_dirty() bit for the small (general) block. */
+	NDS_DIRTY_SMALL = 1,
+	/** nds_get_dirty() bit for the big (storage) block. */
+	NDS_DIRTY_BIG = 2,
 };
 
 #pragma pack(push, 1)
@@ -63,8 +73,12 @@ extern "C" {
 void nds_text_to_ucs2(char16_t *dst, char16_t *src, size_t size);
 void ucs2_to_nds_text(char16_t *dst, char16_t *src, size_t size);
 
+nds_savetype_t nds_detect_save_type(const uint8_t *);
 nds_save_t *nds_read_main_save(const uint8_t *);
 nds_save_t *nds_read_backup_save(const uint8_t *);
+nds_save_t *nds_read_main_save_with(const uint8_t *, const save_allocator_t *);
+nds_save_t *nds_read_main_save_in(const uint8_t *, void *block);
+size_t nds_save_object_size(void);
 void nds_free_save(nds_save_t *);
 
 uint8_t *nds_create_data();
@@ -76,6 +90,25 @@ void nds_write_backup_save(uint8_t *, const nds_save_t *);
 nds_party_t *nds_get_party(nds_save_t *);
 nds_box_t *nds_get_box(nds_save_t *, size_t);
 
+void nds_pc_refresh_occupancy(nds_save_t *);
+uint8_t nds_pc_is_occupied(nds_save_t *, size_t box, size_t slot);
+void nds_pc_set_occupied(nds_save_t *, size_t box, size_t slot, uint8_t occupied);
+size_t nds_pc_reserve(nds_save_t *, pc_fill_t, size_t count, uint16_t *slots);
+size_t nds_pc_compact(nds_save_t *);
+size_t nds_pc_sort(nds_save_t *, pc_sort_key_t, uint8_t descending, size_t top, const uint8_t *growth_rates, size_t growth_count);
+uint8_t nds_get_dirty(nds_save_t *);
+int nds_journal_start(nds_save_t *);
+void nds_journal_stop(nds_save_t *);
+save_journal_t *nds_get_journal(nds_save_t *);
+void nds_journal_record(nds_save_t *, const void *ptr, size_t size);
+int nds_journal_checkpoint(nds_save_t *);
+int nds_journal_undo(nds_save_t *);
+int nds_journal_redo(nds_save_t *);
+
+uint8_t nds_diff_blocks(const uint8_t *, const uint8_t *);
+int nds_diff(const uint8_t *, const uint8_t *, save_diff_fn_t, void *user);
+int nds_export(save_export_t *, nds_save_t *, uint32_t id);
+
 //items
 //pokedex
 //day care
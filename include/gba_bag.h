@@ -0,0 +1,80 @@
+/**
+ * A map from item id to slot for every pocket, so finding, adding and removing items doesn't
+ * have to walk the pocket, and a bitmap of the slots in use so free slots are found at once.
+ *
+ * @file gba_bag.h
+ * @brief Contains the GBA bag index and bulk item functions.
+ */
+
+#ifndef __GBA_BAG_H__
+#define __GBA_BAG_H__
+
+#include "types.h"
+#include "game_gba.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/** The number of pockets, including the PC. */
+	GBA_BAG_POCKETS = 6,
+	/** The most slots a pocket has in any GBA game. */
+	GBA_BAG_POCKET_MAX = 64,
+	/** Item ids below this are mapped, higher ids are searched for. */
+	GBA_BAG_ITEM_MAX = 512,
+	/** The most of one item a PC slot holds after gba_bag_apply(). */
+	GBA_BAG_PC_AMOUNT_MAX = 999,
+	/** The most of one item a bag pocket slot holds after gba_bag_apply(). */
+	GBA_BAG_AMOUNT_MAX = 99
+};
+
+/**
+ * @brief What a gba_bag_change_t does.
+ */
+typedef enum {
+	/** Adds to the item, using a free slot if the pocket doesn't have it. */
+	GBA_BAG_ADD,
+	/** Takes from the item, emptying its slot when none are left. */
+	GBA_BAG_REMOVE,
+	/** Sets the amount of the item, 0 empties its slot. */
+	GBA_BAG_SET
+} gba_bag_op_t;
+
+/**
+ * @brief One change for gba_bag_apply().
+ */
+typedef struct {
+	gba_item_pocket_t pocket;
+	gba_bag_op_t op;
+	uint16_t item;
+	uint16_t amount;
+} gba_bag_change_t;
+
+/**
+ * A slot is in use when it has both an item id and an amount. The index points into the save,
+ * so it stays valid until the save is freed, as long as the bag is only changed through it.
+ * @brief Index of the items in a GBA save's pockets.
+ */
+typedef struct {
+	gba_save_t *save;
+	/** @brief The first slot of each pocket. */
+	gba_item_slot_t *slots[GBA_BAG_POCKETS];
+	/** @brief The number of slots in each pocket. */
+	uint8_t size[GBA_BAG_POCKETS];
+	/** @brief Bit n is set when slot n of the pocket is in use. */
+	uint64_t used[GBA_BAG_POCKETS];
+	/** @brief Slot + 1 of each item id in each pocket, 0 if the pocket doesn't have it. */
+	uint8_t where[GBA_BAG_POCKETS][GBA_BAG_ITEM_MAX];
+} gba_bag_t;
+
+int gba_bag_build(gba_bag_t *, gba_save_t *);
+gba_item_slot_t *gba_bag_find(const gba_bag_t *, gba_item_pocket_t, uint16_t item);
+size_t gba_bag_apply(gba_bag_t *, const gba_bag_change_t *changes, size_t count);
+size_t gba_bag_compact(gba_bag_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__GBA_BAG_H__
@@ -0,0 +1,151 @@
+/**
+ * A column-per-field snapshot of every pokemon in the party and the PC, so searches and
+ * counts can scan dense arrays instead of following pointers to 80 byte records.
+ *
+ * @file gba_pc_index.h
+ * @brief Contains the columnar index of GBA party and PC pokemon.
+ */
+
+#ifndef __GBA_PC_INDEX_H__
+#define __GBA_PC_INDEX_H__
+
+#include "types.h"
+#include "game_gba.h"
+#include "pc_sort.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/** The most rows an index can hold, the party plus every box slot. */
+	GBA_PC_INDEX_SIZE = POKEMON_IN_PARTY + GBA_BOX_COUNT * GBA_POKEMON_IN_BOX,
+	/** The box column value for pokemon in the party. */
+	GBA_PC_INDEX_PARTY = 0xFF
+};
+
+/**
+ * Only occupied slots get a row, in order: the party, then each box from left to right and
+ * top to bottom. Row i of every column describes the same pokemon, found at record[i].
+ * @brief Columnar index of the party and PC.
+ */
+typedef struct {
+	/** @brief The number of rows in use. */
+	size_t count;
+	uint16_t species[GBA_PC_INDEX_SIZE];
+	uint16_t held_item[GBA_PC_INDEX_SIZE];
+	uint32_t pid[GBA_PC_INDEX_SIZE];
+	uint32_t ot_fid[GBA_PC_INDEX_SIZE];
+	uint32_t exp[GBA_PC_INDEX_SIZE];
+	/** @brief Party level, or the level from exp when the species has a growth rate, otherwise 0. */
+	uint8_t level[GBA_PC_INDEX_SIZE];
+	/** @brief Unpacked IVs, indexed by stat_stat_t. */
+	uint8_t iv[6][GBA_PC_INDEX_SIZE];
+	/** @brief The box number, or GBA_PC_INDEX_PARTY. */
+	uint8_t box[GBA_PC_INDEX_SIZE];
+	/** @brief The slot within the box or party. */
+	uint8_t slot[GBA_PC_INDEX_SIZE];
+	/** @brief The record each row was read from. */
+	pk3_box_t *record[GBA_PC_INDEX_SIZE];
+	/** @brief Whether the records are stored decrypted. */
+	uint8_t decrypted;
+	/** @brief Growth rate by species, may be NULL. */
+	const uint8_t *growth_rates;
+	/** @brief The number of entries in growth_rates. */
+	size_t growth_count;
+} gba_pc_index_t;
+
+enum {
+	/** The most operations a gba_pc_query_t can hold. */
+	GBA_PC_QUERY_MAX_OPS = 32,
+	/** The deepest the operand stack of a gba_pc_query_t can get. */
+	GBA_PC_QUERY_MAX_DEPTH = 8,
+	/** Species ids a species set can hold, 0 to GBA_PC_QUERY_SPECIES_MAX - 1. */
+	GBA_PC_QUERY_SPECIES_MAX = 512
+};
+
+/**
+ * @brief The operations of a gba_pc_query_t.
+ */
+typedef enum {
+	GBA_PC_QUERY_LEVEL,
+	GBA_PC_QUERY_IV_TOTAL,
+	GBA_PC_QUERY_SHINY,
+	GBA_PC_QUERY_NATURE,
+	GBA_PC_QUERY_SPECIES,
+	GBA_PC_QUERY_OT_ID,
+	GBA_PC_QUERY_OT_NAME,
+	GBA_PC_QUERY_HELD_ITEM,
+	GBA_PC_QUERY_BOX,
+	GBA_PC_QUERY_AND,
+	GBA_PC_QUERY_OR,
+	GBA_PC_QUERY_NOT
+} gba_pc_query_op_t;
+
+/**
+ * @brief One operation of a gba_pc_query_t.
+ */
+typedef struct {
+	gba_pc_query_op_t op;
+	union {
+		/** Inclusive range, for level and IV total. */
+		struct {
+			uint16_t min;
+			uint16_t max;
+		} range;
+		/** Bit n set for nature n. */
+		uint32_t natures;
+		/** Bit n set for species n. */
+		uint64_t species[GBA_PC_QUERY_SPECIES_MAX / 64];
+		uint32_t ot_fid;
+		gba_text_query_t ot_name;
+		uint16_t held_item;
+		uint8_t box;
+	};
+} gba_pc_query_step_t;
+
+/**
+ * A query is written in postfix order: each predicate pushes a result, and AND, OR and NOT
+ * combine the results on top of the stack. "Pikachu or Raichu, and not shiny" is
+ * species({PIKACHU, RAICHU}), shiny(), not(), and(). Once built, gba_pc_query_run() evaluates
+ * every step for 64 rows at a time as bit masks, in a single pass over the index columns.
+ * @brief A compiled search over a gba_pc_index_t.
+ */
+typedef struct {
+	size_t count;
+	/** @brief Stack depth after the last step, 1 when the query is complete. */
+	size_t depth;
+	/** @brief Set if a step could not be added, the query then matches nothing. */
+	uint8_t invalid;
+	gba_pc_query_step_t step[GBA_PC_QUERY_MAX_OPS];
+} gba_pc_query_t;
+
+void gba_pc_index_build(gba_pc_index_t *, gba_save_t *, uint8_t decrypted, const uint8_t *growth_rates, size_t growth_count);
+void gba_pc_index_refresh(gba_pc_index_t *, size_t row);
+
+size_t gba_pc_index_find_species(const gba_pc_index_t *, uint16_t species, uint16_t *rows, size_t max);
+size_t gba_pc_index_find_genes(const gba_pc_index_t *, const pk3_genes_t *genes, uint16_t *rows, size_t max);
+size_t gba_pc_index_count_species(const gba_pc_index_t *, uint16_t *counts, size_t size);
+
+void gba_pc_query_init(gba_pc_query_t *);
+int gba_pc_query_level(gba_pc_query_t *, uint8_t min, uint8_t max);
+int gba_pc_query_iv_total(gba_pc_query_t *, uint8_t min, uint8_t max);
+int gba_pc_query_shiny(gba_pc_query_t *);
+int gba_pc_query_nature(gba_pc_query_t *, uint32_t natures);
+int gba_pc_query_species(gba_pc_query_t *, const uint16_t *species, size_t count);
+int gba_pc_query_ot_id(gba_pc_query_t *, uint32_t ot_fid);
+int gba_pc_query_ot_name(gba_pc_query_t *, const gba_text_query_t *);
+int gba_pc_query_held_item(gba_pc_query_t *, uint16_t item);
+int gba_pc_query_box(gba_pc_query_t *, uint8_t box);
+int gba_pc_query_and(gba_pc_query_t *);
+int gba_pc_query_or(gba_pc_query_t *);
+int gba_pc_query_not(gba_pc_query_t *);
+size_t gba_pc_query_run(const gba_pc_query_t *, const gba_pc_index_t *, uint16_t *rows, size_t limit);
+
+size_t gba_pc_index_sort(gba_pc_index_t *, gba_save_t *, pc_sort_key_t key, uint8_t descending, size_t top);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__GBA_PC_INDEX_H__
@@ -9,9 +9,37 @@
 #include "game_gba.h"
 #include "game_nds.h"
 #include "game_ndsi.h"
+#include "gba_pc_index.h"
+#include "pc_sort.h"
+#include "gba_bag.h"
+#include "thread_pool.h"
+#include "save_diff.h"
+#include "pkm_store.h"
+#include "save_archive.h"
+#include "save_journal.h"
+#include "save_alloc.h"
+#include "save_pool.h"
+#include "save_pipeline.h"
+#include "save_export.h"
 
 /**
  * @mainpage LibSPEC is a pokemon save editing library written in C.
+ *
+ * @section threads Threads
+ * The library keeps no global state, everything it works on is passed in, so it can be used
+ * from any number of threads, each with its own saves.
+ *
+ * A save (gba_save_t, nds_save_t, ...) is shared like any other object: functions that only
+ * read it, such as the getters and gba_write_main_save() into a buffer of the caller's, may be
+ * called from several threads at once. Editing functions, the journal, gba_save_game() and
+ * gba_update_main_save() (which move the save slot and clear the dirty sections) and freeing
+ * change the save, so they need the only reference to it while they run. The functions taking a raw save image
+ * (gba_read_main_save(), gba_check_main_save(), gba_diff(), ...) never write to it, so a
+ * file mapped read only may be shared between threads freely.
+ *
+ * The thread pool, the save pipeline, the pokemon store and the save archive are made to be
+ * shared, see their headers for what may run concurrently. The save pool is the one piece of
+ * state the library keeps itself, one per thread, see save_pool.h.
  */
 
 #endif //__LIBSPEC_H__
\ No newline at end of file
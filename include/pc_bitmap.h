@@ -0,0 +1,46 @@
+/**
+ * Every box holds 30 pokemon, so a box's occupancy fits in one 32 bit word: bit n is set when
+ * slot n holds a pokemon. The game specific functions (gba_pc_reserve, nds_pc_reserve, ...)
+ * keep one of these per box on the save and are built on the functions here.
+ *
+ * @file pc_bitmap.h
+ * @brief Contains the free slot bitmap used for PC boxes.
+ */
+
+#ifndef __PC_BITMAP_H__
+#define __PC_BITMAP_H__
+
+#include "types.h"
+#include <stddef.h>
+
+enum {
+	/** The number of pokemon in a box, the same in every generation this library handles. */
+	PC_BITMAP_SLOTS = 30,
+	/** The bits of a box word that map to slots. */
+	PC_BITMAP_FULL = (1u << PC_BITMAP_SLOTS) - 1
+};
+
+/**
+ * @brief The order in which free slots are handed out.
+ */
+typedef enum {
+	/** Fill box 0 first, then box 1, and so on. */
+	PC_FILL_FIRST,
+	/** Start from the current box and wrap around, like the games do when catching pokemon. */
+	PC_FILL_CURRENT,
+	/** Always use the box with the most free slots, spreading pokemon across the PC. */
+	PC_FILL_EMPTIEST
+} pc_fill_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t pc_bitmap_count(const uint32_t *occupied, size_t boxes);
+size_t pc_bitmap_reserve(uint32_t *occupied, size_t boxes, size_t current, pc_fill_t fill, size_t count, uint16_t *slots);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PC_BITMAP_H__
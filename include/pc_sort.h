@@ -0,0 +1,49 @@
+/**
+ * Sorting the PC is split in two: working out the new order from one key per pokemon, which
+ * only touches small arrays, and then moving the records into that order. The move follows the
+ * cycles of the permutation, so every record is copied straight to its final slot once and
+ * slots that keep their record are never written. The game specific functions
+ * (gba_pc_index_sort, nds_pc_sort) are built on the functions here.
+ *
+ * @file pc_sort.h
+ * @brief Contains the PC sorting functions shared by the games.
+ */
+
+#ifndef __PC_SORT_H__
+#define __PC_SORT_H__
+
+#include "types.h"
+#include <stddef.h>
+
+enum {
+	/** The most pokemon or slots the sort functions handle. */
+	PC_SORT_MAX = 1024,
+	/** The largest record pc_sort_apply() can move. */
+	PC_SORT_RECORD_MAX = 256
+};
+
+/**
+ * @brief The value PC pokemon are sorted by.
+ */
+typedef enum {
+	PC_SORT_SPECIES,
+	PC_SORT_LEVEL,
+	PC_SORT_IV_TOTAL,
+	PC_SORT_EXP,
+	PC_SORT_HELD_ITEM
+} pc_sort_key_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pc_sort_order(uint16_t *order, const uint32_t *keys, size_t count, uint8_t descending);
+void pc_sort_top(uint16_t *order, const uint32_t *keys, size_t count, size_t top, uint8_t descending);
+size_t pc_sort_apply(void *const *slots, size_t size, uint16_t *from, size_t count);
+size_t pc_sort_slots(void *const *slots, size_t size, size_t total, const uint16_t *used, const uint32_t *keys, size_t count, uint8_t descending, size_t top, uint16_t *from);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PC_SORT_H__
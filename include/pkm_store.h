@@ -0,0 +1,75 @@
+/**
+ * A file of unique pokemon, keyed by a hash of the decrypted data blocks and the PID and OT
+ * header, so a pokemon seen in many saves is kept once and saves refer to it by number.
+ *
+ * Records are appended to a memory mapped file and never move, so a reference stays valid for
+ * the life of the file. The index from hash to record is an open addressing table kept in
+ * memory and rebuilt from the file when it is opened.
+ *
+ * Any number of threads may put pokemon into the same store at once without locking: space for
+ * a record is reserved with an atomic add and the record is published into the index with a
+ * compare and swap. If two threads race to add the same pokemon, one record wins and the other
+ * is marked dead and skipped from then on. Opening and closing must not overlap other calls.
+ *
+ * @file pkm_store.h
+ * @brief Contains the content addressed pokemon store.
+ */
+
+#ifndef __PKM_STORE_H__
+#define __PKM_STORE_H__
+
+#include "types.h"
+#include "pkm.h"
+#include "game_gba.h"
+#include "game_nds.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/** The most records a store can hold. */
+	PKM_STORE_MAX = 0xFFFFFF,
+	/** The reference of a slot with no pokemon, or of a pokemon that couldn't be stored. */
+	PKM_STORE_NONE = 0xFFFFFFFF
+};
+
+/**
+ * @brief What a store record holds.
+ */
+typedef enum {
+	/** A decrypted pk3_box_t. */
+	PKM_STORE_PK3 = 1,
+	/** A decrypted pkm_box_t. */
+	PKM_STORE_PKM = 2
+} pkm_store_kind_t;
+
+/**
+ * @brief The number of a record in a store.
+ */
+typedef uint32_t pkm_store_ref_t;
+
+typedef struct pkm_store pkm_store_t;
+
+pkm_store_t *pkm_store_open(const char *path, size_t capacity);
+void pkm_store_close(pkm_store_t *);
+size_t pkm_store_count(const pkm_store_t *);
+
+uint64_t pkm_store_hash_pk3(const pk3_box_t *);
+uint64_t pkm_store_hash_pkm(const pkm_box_t *);
+
+pkm_store_ref_t pkm_store_put_pk3(pkm_store_t *, const pk3_box_t *);
+pkm_store_ref_t pkm_store_put_pkm(pkm_store_t *, const pkm_box_t *);
+pkm_store_ref_t pkm_store_find_pk3(const pkm_store_t *, const pk3_box_t *);
+pkm_store_ref_t pkm_store_find_pkm(const pkm_store_t *, const pkm_box_t *);
+const pk3_box_t *pkm_store_get_pk3(const pkm_store_t *, pkm_store_ref_t);
+const pkm_box_t *pkm_store_get_pkm(const pkm_store_t *, pkm_store_ref_t);
+
+size_t pkm_store_put_gba_pc(pkm_store_t *, gba_save_t *, pkm_store_ref_t refs[GBA_BOX_COUNT * GBA_POKEMON_IN_BOX]);
+size_t pkm_store_put_nds_pc(pkm_store_t *, nds_save_t *, pkm_store_ref_t refs[NDS_BOX_COUNT * NDS_POKEMON_IN_BOX]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__PKM_STORE_H__
@@ -1,6 +1,13 @@
 // Extraction code copyright 2023 Ben Trask. MIT licensed.
 // The actual data is either copyrighted by Game Freak or public domain.
 
+#ifndef POKEMON_DATA_H
+#define POKEMON_DATA_H
+
+#include "types.h"
+#include "game_gba.h"
+#include "stat.h"
+
 // TODO: This file is currently overly specific to Gen III FireRed/LeafGreen. It doesn't even include Pokemon past #151.
 
 /*
@@ -176,17 +183,6 @@ enum {
 SPECIES(XX)
 #undef XX
 };
-struct {
-	uint16_t id;
-	char const *nameCaps;
-	char const *name;
-	pk3_effort_t stats;
-} const species[] = {
-#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) { id, nameCaps, name, { hp, atk, def, spd, satk, sdef } },
-{ 0, NULL, NULL, { 0, 0, 0, 0, 0, 0 } },
-SPECIES(XX)
-#undef XX
-};
 
 /*
 // https://bulbapedia.bulbagarden.net/wiki/List_of_moves
@@ -567,12 +563,6 @@ enum {
 MOVES(XX)
 #undef XX
 };
-struct { int16_t id; char const *name; int8_t pp; } const moves[] = {
-#define XX(id, token, name, pp) { id, name, pp },
-{ 0, "--", 0},
-MOVES(XX)
-#undef XX
-};
 
 #define NATURES(XX) \
 	XX(0, HARDY) \
@@ -605,11 +595,6 @@ enum {
 NATURES(XX)
 #undef XX
 };
-struct { uint32_t id; char const *name; } const natures[] = {
-#define XX(id, token) { (stat_nature_t)id, #token },
-NATURES(XX)
-#undef XX
-};
 
 /*
 https://bulbapedia.bulbagarden.net/wiki/List_of_items_by_index_number_(Generation_III)
@@ -1007,11 +992,6 @@ enum {
 ITEMS(XX)
 #undef XX
 };
-struct { uint16_t id; char const *name; } const items[] = {
-#define XX(id, token, name) { id, name },
-ITEMS(XX)
-#undef XX
-};
 
 /*
 // https://bulbapedia.bulbagarden.net/wiki/List_of_locations_by_index_number_(Generation_III)
@@ -1250,11 +1230,6 @@ enum {
 LOCATIONS(XX)
 #undef XX
 };
-struct { uint8_t id; char const *name; } const locations[] = {
-#define XX(id, token, name) { id, name },
-LOCATIONS(XX)
-#undef XX
-};
 
 #define POCKETS(XX) \
 	XX(0, PC_ITEMS, "PC Items") \
@@ -1268,11 +1243,6 @@ enum {
 POCKETS(XX)
 #undef XX
 };
-struct { uint8_t id; char const *label; } const pockets[] = {
-#define XX(id, token, label) { id, label },
-POCKETS(XX)
-#undef XX
-};
 
 // https://bulbapedia.bulbagarden.net/wiki/Pok%C3%A9mon_data_substructures_(Generation_III)
 enum {
@@ -1310,21 +1280,51 @@ enum {
 };
 
 // https://bulbapedia.bulbagarden.net/wiki/In-game_trade
-gba_trainer_t const elyssa[1] = {{
-	.name = { 0xbf, 0xc6, 0xd3, 0xcd, 0xcd, 0xbb, 0xff }, // "ELYSSA"
-	.is_female = 1,
-	.id = 8810,
-	.sid = 0, // TODO
-}};
-gba_trainer_t const reyley[1] = {{
-	.name = { 0xcc, 0xbf, 0xd3, 0xc6, 0xbf, 0xd3, 0xff }, // "REYLEY"
-	.is_female = 0,
-	.id = 1985,
-	.sid = 0, // TODO
-}};
-gba_trainer_t const saige[1] = {{
-	.name = { 0xcd, 0xbb, 0xc3, 0xc1, 0xbf, 0xff, 0x00 }, // "SAIGE"
-	.is_female = 1,
-	.id = 63184,
-	.sid = 0, // TODO
-}};
+extern gba_trainer_t const elyssa[1];
+extern gba_trainer_t const reyley[1];
+extern gba_trainer_t const saige[1];
+
+// Table sizes. Ids run from 0 to COUNT-1, species and moves reserve id 0 for "none".
+#define POKEMON_DATA_COUNT(...) +1
+enum {
+	SPECIES_COUNT = 1 SPECIES(POKEMON_DATA_COUNT),
+	MOVES_COUNT = 1 MOVES(POKEMON_DATA_COUNT),
+	NATURES_COUNT = 0 NATURES(POKEMON_DATA_COUNT),
+	ITEMS_COUNT = 0 ITEMS(POKEMON_DATA_COUNT),
+	LOCATIONS_COUNT = 0 LOCATIONS(POKEMON_DATA_COUNT),
+	POCKETS_COUNT = 0 POCKETS(POKEMON_DATA_COUNT),
+};
+#undef POKEMON_DATA_COUNT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The tables live in src/pokemon_data.c. Accessors return NULL (or 0) for ids past the end.
+char const *species_name(uint16_t id);
+char const *species_name_caps(uint16_t id);
+uint8_t species_base_stat(uint16_t id, stat_stat_t stat);
+pk3_effort_t species_base_stats(uint16_t id);
+uint8_t const *species_base_stat_column(stat_stat_t stat);
+char const *move_name(uint16_t id);
+int8_t move_pp(uint16_t id);
+char const *nature_name(uint32_t id);
+char const *item_name(uint16_t id);
+char const *location_name(uint16_t id);
+char const *pocket_label(uint8_t id);
+
+// Name lookup. Names are normalized to the same form as the tokens above ("Thunder Punch",
+// "thunder-punch" and "THUNDER_PUNCH" are all THUNDER_PUNCH), then resolved through minimal
+// perfect hash tables that `make` generates from the X-macros (see tools/pokemon-data-hash.c).
+// Names shared by several entries ("Underwater") resolve to the lowest id.
+// Each returns the id for the name, or -1 if it isn't known.
+int species_lookup(char const *name);
+int move_lookup(char const *name);
+int item_lookup(char const *name);
+int location_lookup(char const *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POKEMON_DATA_H
@@ -0,0 +1,46 @@
+/**
+ * Where the library gets the memory for the save objects it reads.
+ *
+ * Every save object (a gba_save_t, nds_save_t or gb_save_t with its data) is one block of
+ * memory. The plain read functions get it from malloc(), the *_with functions from the given
+ * allocator, and the *_in functions take a block the caller already has, of the size given by
+ * gba_save_object_size(), nds_save_object_size() or gb_save_object_size() and aligned as
+ * malloc() would. Nothing is allocated for a save read into a block, so a block carved from an
+ * arena goes away with the arena.
+ *
+ * The free functions (gba_free_save(), ...) work on every save object and give the block back
+ * to wherever it came from, doing nothing with a caller's block. The undo journal is allocated
+ * separately with malloc(), a save in a caller's block that started one still needs freeing.
+ *
+ * @file save_alloc.h
+ * @brief Contains the save object allocator.
+ */
+
+#ifndef __SAVE_ALLOC_H__
+#define __SAVE_ALLOC_H__
+
+#include "types.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief An allocator, alloc returns NULL when out of memory and free, which is given the size
+ * that was allocated, may be NULL.
+ */
+typedef struct {
+	void *(*alloc)(size_t size, void *user);
+	void (*free)(void *ptr, size_t size, void *user);
+	void *user;
+} save_allocator_t;
+
+void *save_alloc(save_allocator_t *owner, const save_allocator_t *allocator, size_t size);
+void save_alloc_free(const save_allocator_t *owner, void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SAVE_ALLOC_H__
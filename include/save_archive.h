@@ -0,0 +1,58 @@
+/**
+ * An archive of many save files. Saves are split into SAVE_ARCHIVE_CHUNK_SIZE chunks, the size
+ * of a GBA section, and every distinct chunk is stored once, run length encoded. The two slots
+ * of a GBA save and the backup blocks of an NDS save mostly share chunks with each other and
+ * with earlier saves of the same game, and the padding compresses to a few bytes.
+ *
+ * The index at the end of the file lists every chunk and the chunks of every save, so any save,
+ * byte range or single chunk can be read back by decoding only the chunks it covers. The last
+ * SAVE_ARCHIVE_TRAILER_SIZE bytes of each chunk are also kept in the index, which lets the GBA
+ * section footers be read without decoding anything (see gba_archive_read_section()).
+ *
+ * An archive is written once with save_archive_create(), save_archive_add() and
+ * save_archive_finish(), and read with save_archive_open(). Reads don't change the archive, so
+ * any number of threads may read the same open archive at once.
+ *
+ * @file save_archive.h
+ * @brief Contains the deduplicating save archive.
+ */
+
+#ifndef __SAVE_ARCHIVE_H__
+#define __SAVE_ARCHIVE_H__
+
+#include "types.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/** The size saves are split into, the last chunk of a save is padded with zeros. */
+	SAVE_ARCHIVE_CHUNK_SIZE = 0x1000,
+	/** The bytes at the end of every chunk that are kept in the index. */
+	SAVE_ARCHIVE_TRAILER_SIZE = 16
+};
+
+typedef struct save_archive_writer save_archive_writer_t;
+typedef struct save_archive save_archive_t;
+
+save_archive_writer_t *save_archive_create(const char *path);
+int save_archive_add(save_archive_writer_t *, const uint8_t *data, size_t size);
+void save_archive_writer_stats(const save_archive_writer_t *, size_t *chunks, size_t *unique, uint64_t *bytes);
+int save_archive_finish(save_archive_writer_t *);
+
+save_archive_t *save_archive_open(const char *path);
+void save_archive_close(save_archive_t *);
+size_t save_archive_count(const save_archive_t *);
+size_t save_archive_size(const save_archive_t *, size_t save);
+int save_archive_read(const save_archive_t *, size_t save, uint8_t *out);
+int save_archive_read_range(const save_archive_t *, size_t save, size_t offset, size_t size, uint8_t *out);
+int save_archive_read_chunk(const save_archive_t *, size_t save, size_t chunk, uint8_t *out);
+const uint8_t *save_archive_trailer(const save_archive_t *, size_t save, size_t chunk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SAVE_ARCHIVE_H__
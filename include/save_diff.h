@@ -0,0 +1,89 @@
+/**
+ * Compares two save files in place. The diff functions of each game (gba_diff, nds_diff) first
+ * compare the checksums of the sections or blocks of the two files, only looking at the bytes of
+ * sections whose checksums match to make sure they really are the same, and only decode the
+ * fields held in sections that differ. Pokemon are decrypted one at a time on the stack, so
+ * neither file is unpacked or copied.
+ *
+ * Every difference found is passed to a callback as a save_diff_t.
+ *
+ * @file save_diff.h
+ * @brief Contains the types shared by the save diff functions.
+ */
+
+#ifndef __SAVE_DIFF_H__
+#define __SAVE_DIFF_H__
+
+#include "types.h"
+#include <stddef.h>
+
+/**
+ * @brief The part of the save a difference was found in.
+ */
+typedef enum {
+	/** A whole section or block, index is its number and the values are the checksums. */
+	SAVE_DIFF_SECTION,
+	/** The trainer's name, ids and time played. */
+	SAVE_DIFF_TRAINER,
+	/** The money, decrypted. */
+	SAVE_DIFF_MONEY,
+	/** An item slot, group is the pocket and index the slot in the pocket. */
+	SAVE_DIFF_ITEM,
+	/** A pokedex entry, group is the list and index the pokedex number starting at 0. */
+	SAVE_DIFF_POKEDEX,
+	/** A party pokemon, index is the party slot. */
+	SAVE_DIFF_PARTY,
+	/** A PC pokemon or box, group is the box and index the slot. Fields of a whole box have index 0. */
+	SAVE_DIFF_PC
+} save_diff_area_t;
+
+/**
+ * @brief One changed field.
+ */
+typedef struct {
+	save_diff_area_t area;
+	/** @brief The box, pocket or pokedex list, 0 for areas without one. */
+	uint16_t group;
+	/** @brief The slot, pokedex number or section. */
+	uint16_t index;
+	/** @brief The name of the field, such as "exp" or "nickname". */
+	const char *field;
+	/** @brief The old and new values of fields up to 4 bytes long, read little endian. */
+	uint32_t old_value;
+	uint32_t new_value;
+	/**
+	 * Pokemon fields point into decrypted copies, so these are only valid during the callback.
+	 * They are NULL for pokedex entries, which are single bits.
+	 * @brief The old and new bytes of the field.
+	 */
+	const uint8_t *old_data;
+	const uint8_t *new_data;
+	/** @brief The size of the field in bytes. */
+	size_t size;
+} save_diff_t;
+
+/**
+ * @brief Called once for every difference, in the order they are found.
+ */
+typedef void (*save_diff_fn_t)(const save_diff_t *diff, void *user);
+
+/**
+ * @brief A field of a structure, compared by save_diff_fields().
+ */
+typedef struct {
+	const char *name;
+	uint16_t offset;
+	uint16_t size;
+} save_diff_field_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t save_diff_fields(const save_diff_field_t *fields, size_t count, save_diff_t *diff, const uint8_t *a, const uint8_t *b, save_diff_fn_t fn, void *user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SAVE_DIFF_H__
@@ -0,0 +1,103 @@
+/**
+ * Writes the party and PC pokemon of saves as CSV, JSON Lines or a binary column file, one
+ * record per pokemon. The game functions (gba_export(), nds_export()) decode every pokemon of a
+ * save into a save_export_record_t on the stack and pass it to save_export_record(), which
+ * formats it straight into a large output buffer. Nothing is allocated after
+ * save_export_create(), however many saves are written.
+ *
+ * CSV starts with a header line and quotes every name. JSON Lines writes one object per record.
+ * The game functions decode names into the record as UCS-2, and both formats convert them to
+ * escaped UTF-8 as the line is written.
+ *
+ * The column file starts with the magic "LSPKCOLS", a uint32_t version (1), a uint32_t column
+ * count and, for every column, a uint8_t kind (save_export_kind_t), a uint8_t size in bytes, a
+ * uint8_t name length and the name. Groups of up to SAVE_EXPORT_GROUP records follow, each a
+ * uint32_t record count and then every column's values back to back, size bytes each. Names
+ * are UCS-2, zero padded. A group of 0 records ends the file. Every integer and character is
+ * stored little endian, whatever the byte order of the host.
+ *
+ * @file save_export.h
+ * @brief Contains the pokemon record exporter.
+ */
+
+#ifndef __SAVE_EXPORT_H__
+#define __SAVE_EXPORT_H__
+
+#include "types.h"
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/** The box of a party pokemon. */
+	SAVE_EXPORT_PARTY = 0xFF,
+	/** The characters kept of a nickname. */
+	SAVE_EXPORT_NAME_LENGTH = 12,
+	/** The characters kept of an original trainer's name. */
+	SAVE_EXPORT_OT_LENGTH = 8,
+	/** The records in each group of the column file. */
+	SAVE_EXPORT_GROUP = 4096
+};
+
+typedef enum {
+	SAVE_EXPORT_CSV,
+	SAVE_EXPORT_JSONL,
+	SAVE_EXPORT_COLUMNS
+} save_export_format_t;
+
+/**
+ * @brief The type of a column.
+ */
+typedef enum {
+	/** An unsigned integer. */
+	SAVE_EXPORT_UINT,
+	/** UCS-2 text ending at the first 0 or the end of the column. */
+	SAVE_EXPORT_TEXT
+} save_export_kind_t;
+
+/**
+ * @brief One pokemon, decrypted. The fields are written in this order.
+ */
+typedef struct {
+	/** @brief The number the caller gave the save. */
+	uint32_t save;
+	/** @brief 3 for GBA games, 4 for NDS games. */
+	uint8_t generation;
+	/** @brief The PC box, or SAVE_EXPORT_PARTY. */
+	uint8_t box;
+	uint8_t slot;
+	/** @brief The level, 0 in the PC where it isn't stored. */
+	uint8_t level;
+	uint32_t pid;
+	uint16_t ot_id;
+	uint16_t ot_sid;
+	uint16_t species;
+	uint16_t held_item;
+	uint32_t exp;
+	uint8_t friendship;
+	uint8_t is_egg;
+	/** @brief 1 if the pokemon's checksum matches its data. */
+	uint8_t checksum_ok;
+	uint16_t move[4];
+	/** @brief HP, attack, defense, speed, special attack and special defense. */
+	uint8_t iv[6];
+	uint8_t ev[6];
+	char16_t nickname[SAVE_EXPORT_NAME_LENGTH];
+	char16_t ot_name[SAVE_EXPORT_OT_LENGTH];
+} save_export_record_t;
+
+typedef struct save_export save_export_t;
+
+save_export_t *save_export_create(FILE *out, save_export_format_t format);
+int save_export_record(save_export_t *, const save_export_record_t *);
+uint64_t save_export_count(const save_export_t *);
+int save_export_finish(save_export_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SAVE_EXPORT_H__
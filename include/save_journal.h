@@ -0,0 +1,52 @@
+/**
+ * An undo and redo journal of the changes made to a save's data, kept as the bytes that changed
+ * rather than copies of the whole save.
+ *
+ * A range is recorded before it is changed, which keeps its old bytes. Bytes already recorded
+ * in the step aren't kept again, and a range next to the one recorded last grows that one, so
+ * runs of small adjacent writes become one entry. The next checkpoint, undo or redo compares the recorded ranges with the data and keeps
+ * only the bytes that differ, old and new, so recording more than was changed costs nothing
+ * once the step ends. Call save_journal_checkpoint() after every edit the user sees as one.
+ *
+ * Entries are grouped into steps by save_journal_checkpoint(), and undo and redo move a whole
+ * step at a time, touching only its bytes. Recording after an undo drops the steps that could
+ * have been redone.
+ *
+ * The game functions (gba_journal_start(), nds_journal_start(), ...) keep one of these on the
+ * save and record the changes made by the library's editing functions.
+ *
+ * @file save_journal.h
+ * @brief Contains the save edit journal.
+ */
+
+#ifndef __SAVE_JOURNAL_H__
+#define __SAVE_JOURNAL_H__
+
+#include "types.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Called with every range written by an undo or redo.
+ */
+typedef void (*save_journal_fn_t)(size_t offset, size_t size, void *user);
+
+typedef struct save_journal save_journal_t;
+
+save_journal_t *save_journal_create(void);
+void save_journal_free(save_journal_t *);
+int save_journal_record(save_journal_t *, const uint8_t *data, size_t offset, size_t size);
+int save_journal_checkpoint(save_journal_t *, const uint8_t *data);
+int save_journal_undo(save_journal_t *, uint8_t *data, save_journal_fn_t, void *user);
+int save_journal_redo(save_journal_t *, uint8_t *data, save_journal_fn_t, void *user);
+void save_journal_steps(const save_journal_t *, size_t *undo, size_t *redo);
+size_t save_journal_memory(const save_journal_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SAVE_JOURNAL_H__
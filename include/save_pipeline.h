@@ -0,0 +1,67 @@
+/**
+ * Runs items, usually structures holding a save and what is known about it, through a list of
+ * stages on a thread pool: load, verify, edit, write back and so on, each stage a function.
+ * Every item goes through the stages in order, different items run at once on all the workers,
+ * and the pool's work stealing keeps them busy when some items take longer than others.
+ *
+ * Each stage holds at most the capacity given to save_pipeline_create() waiting items.
+ * save_pipeline_push() blocks while the first stage is full, so a producer can't run ahead of
+ * the workers. When a later stage is full the worker that finished the item runs the next
+ * stage on it itself rather than queueing it, which slows the stages feeding a slow stage
+ * without ever blocking a worker.
+ *
+ * The time spent in each stage is counted, see save_pipeline_stats().
+ *
+ * @file save_pipeline.h
+ * @brief Contains the multi stage save pipeline.
+ */
+
+#ifndef __SAVE_PIPELINE_H__
+#define __SAVE_PIPELINE_H__
+
+#include "types.h"
+#include "thread_pool.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A stage, called with the item, the worker running it and the stage's user pointer.
+ * Returns 0 to pass the item to the next stage, anything else to stop it here. The item is the
+ * caller's, the last stage it reaches should free it.
+ */
+typedef int (*save_pipeline_fn_t)(void *item, size_t worker, void *user);
+
+typedef struct {
+	/** @brief The stage's name, as given to save_pipeline_stage(). */
+	const char *name;
+	/** @brief Items the stage was called with. */
+	uint64_t items;
+	/** @brief Items the stage stopped. */
+	uint64_t stopped;
+	/** @brief Items the stage ran on the worker of the stage before, because it was full. */
+	uint64_t inline_runs;
+	/** @brief Nanoseconds spent in the stage, over all workers. */
+	uint64_t busy_ns;
+	/** @brief The longest the stage took with one item, in nanoseconds. */
+	uint64_t max_ns;
+} save_pipeline_stats_t;
+
+typedef struct save_pipeline save_pipeline_t;
+
+save_pipeline_t *save_pipeline_create(thread_pool_t *, size_t capacity);
+int save_pipeline_stage(save_pipeline_t *, const char *name, save_pipeline_fn_t, void *user);
+int save_pipeline_push(save_pipeline_t *, void *item);
+void save_pipeline_wait(save_pipeline_t *);
+size_t save_pipeline_stages(const save_pipeline_t *);
+void save_pipeline_stats(const save_pipeline_t *, size_t stage, save_pipeline_stats_t *);
+uint64_t save_pipeline_push_wait_ns(const save_pipeline_t *);
+void save_pipeline_free(save_pipeline_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SAVE_PIPELINE_H__
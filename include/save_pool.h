@@ -0,0 +1,57 @@
+/**
+ * A cache of save object blocks for programs that read and free saves all the time. Pass
+ * save_pool_allocator() to gba_read_main_save_with(), nds_read_main_save_with() or
+ * gb_read_save_with(), and the free functions put the block back in the pool instead of
+ * freeing it, so the next read of the same generation reuses it without calling malloc().
+ *
+ * A read sets every byte of the block it uses, copying what the file holds and clearing the
+ * rest (the unused sections of a GBA save, the bytes around the two NDS blocks), so a block is
+ * reused without being cleared first and keeps nothing of the save read into it before.
+ *
+ * Every thread has its own pool, so taking and giving back blocks never locks. A block freed
+ * on another thread than the one that read it goes to that thread's pool. Each pool keeps up to
+ * SAVE_POOL_KEEP blocks of each size and frees the rest, call save_pool_trim() before a thread
+ * ends to free the blocks it kept.
+ *
+ * @file save_pool.h
+ * @brief Contains the thread local save object pool.
+ */
+
+#ifndef __SAVE_POOL_H__
+#define __SAVE_POOL_H__
+
+#include "types.h"
+#include "save_alloc.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/** The blocks of each size a thread keeps. */
+	SAVE_POOL_KEEP = 8
+};
+
+typedef struct {
+	/** @brief Blocks taken from the pool. */
+	uint64_t hits;
+	/** @brief Blocks that had to be allocated. */
+	uint64_t misses;
+	/** @brief Blocks freed because the pool was full. */
+	uint64_t drops;
+	/** @brief Blocks in the pool now. */
+	size_t kept;
+	/** @brief Bytes in the pool now. */
+	size_t bytes;
+} save_pool_stats_t;
+
+const save_allocator_t *save_pool_allocator(void);
+void save_pool_stats(save_pool_stats_t *);
+void save_pool_trim(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__SAVE_POOL_H__
@@ -7,6 +7,7 @@
 #define STAT_H_
 
 #include "types.h"
+#include <stddef.h>
 
 /**
  * @brief List of natures by index.
@@ -104,6 +105,19 @@ typedef enum {
 	STAT_GROWTH_RATE_FLUCTUATING = 5
 } stat_growth_rate_t;
 
+/**
+ * @brief Input columns for the *_calc_stats_batch functions, one entry per pokemon.
+ * The base, iv and ev arrays are indexed by stat_stat_t.
+ */
+typedef struct {
+	const uint8_t *level;
+	const uint8_t *base[6];
+	const uint8_t *iv[6];
+	const uint8_t *ev[6];
+	/** Nature ids (stat_nature_t, 0 to 24), e.g. pid % 25. */
+	const uint8_t *nature;
+} stat_batch_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -112,6 +126,32 @@ stat_bonus_t stat_get_bonus(stat_nature_t, stat_stat_t);
 stat_nature_t stat_get_nature(uint32_t pid);
 uint8_t stat_get_level(stat_growth_rate_t, uint32_t exp);
 
+/**
+ * @brief Get the total experience needed to reach a level.
+ * @param growth_rate The growth rate of the pokemon's species.
+ * @param level The level, 1 to 100. Levels above 100 are treated as 100.
+ * @return The experience at the start of the level, 0 for level 0.
+ */
+uint32_t stat_get_exp(stat_growth_rate_t growth_rate, uint8_t level);
+
+/**
+ * @brief Calculate the levels of many pokemon at once, e.g. a whole PC.
+ * @param levels Output array of count levels.
+ * @param growth_rates Array of count stat_growth_rate_t values.
+ * @param exp Array of count experience totals.
+ * @param count Number of pokemon.
+ */
+void stat_get_level_batch(uint8_t *levels, const uint8_t *growth_rates, const uint32_t *exp, size_t count);
+
+/**
+ * @brief Inverse of stat_get_level_batch(), the experience for each (growth rate, level) pair.
+ * @param exp Output array of count experience totals.
+ * @param growth_rates Array of count stat_growth_rate_t values.
+ * @param levels Array of count levels.
+ * @param count Number of pokemon.
+ */
+void stat_get_exp_batch(uint32_t *exp, const uint8_t *growth_rates, const uint8_t *levels, size_t count);
+
 uint16_t gb_calc_stat(uint8_t, uint8_t, uint8_t, uint16_t);
 uint16_t gb_calc_hp_stat(uint8_t, uint8_t, uint8_t, uint16_t);
 
@@ -124,6 +164,10 @@ uint16_t nds_calc_hp_stat(uint8_t, uint8_t, uint8_t, uint8_t);
 uint16_t dsi_calc_stat(uint8_t level, uint8_t base_stat, uint8_t iv, uint8_t ev, stat_bonus_t);
 uint16_t dsi_calc_hp_stat(uint8_t, uint8_t, uint8_t, uint8_t);
 
+void gba_calc_stats_batch(uint16_t *const stats[6], const stat_batch_t *in, size_t count);
+void nds_calc_stats_batch(uint16_t *const stats[6], const stat_batch_t *in, size_t count);
+void dsi_calc_stats_batch(uint16_t *const stats[6], const stat_batch_t *in, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
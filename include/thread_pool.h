@@ -0,0 +1,40 @@
+/**
+ * A fixed set of worker threads, each with its own task queue. Workers take their newest task
+ * first and, when their queue is empty, steal the oldest task from another worker, so a task
+ * that submits more tasks (a directory listing its files, say) keeps its children close while
+ * idle workers spread them out.
+ *
+ * The library functions are not made thread safe by this: give every task its own saves.
+ *
+ * @file thread_pool.h
+ * @brief Contains the work stealing thread pool.
+ */
+
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include "types.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A task, called with its argument and the number of the worker running it.
+ */
+typedef void (*thread_pool_fn_t)(void *arg, size_t worker);
+
+typedef struct thread_pool thread_pool_t;
+
+thread_pool_t *thread_pool_create(size_t threads);
+size_t thread_pool_threads(const thread_pool_t *);
+int thread_pool_submit(thread_pool_t *, thread_pool_fn_t fn, void *arg);
+void thread_pool_wait(thread_pool_t *);
+void thread_pool_free(thread_pool_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__THREAD_POOL_H__
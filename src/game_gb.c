@@ -11,6 +11,8 @@
 #include "checksum.h"
 #include "types.h"
 #include "game_gb.h"
+#include "stat.h"
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -82,24 +84,74 @@ enum {
 	GB_C_PROTECTED2_START = 0x1209,
 	GB_C_CHECKSUM2 = 0x1F0D,
 
-	GB_CODEPAGE_SIZE = 0x100
+	GB_CODEPAGE_SIZE = 0x100,
+
+	//party: count, species list (6 + terminator), then the pokemon
+	GB_RBY_PARTY = 0x2f2c,
+	GB_GS_PARTY = 0x288a,
+	GB_C_PARTY = 0x2865,
+	GB_PARTY_POKEMON = 8,
+
+	//offsets inside a party pokemon, multi-byte values are big endian
+	GB_RBY_PARTY_POKEMON_SIZE = 44,
+	GB_RBY_POKEMON_CURRENT_HP = 0x01,
+	GB_RBY_POKEMON_STAT_EXP = 0x11,
+	GB_RBY_POKEMON_DV = 0x1b,
+	GB_RBY_POKEMON_LEVEL = 0x21,
+	GB_RBY_POKEMON_STATS = 0x22,
+
+	GB_GSC_PARTY_POKEMON_SIZE = 48,
+	GB_GSC_POKEMON_STAT_EXP = 0x0b,
+	GB_GSC_POKEMON_DV = 0x15,
+	GB_GSC_POKEMON_LEVEL = 0x1f,
+	GB_GSC_POKEMON_CURRENT_HP = 0x22,
+	GB_GSC_POKEMON_STATS = 0x24
 };
 
 void gb_text_to_ucs2(char16_t *dst, char8_t *src, size_t size) {
-	for(int i = 0; i < size; ++i) {
+	for(size_t i = 0; i < size; ++i) {
 		dst[i] = GB_TO_CODEPAGE[src[i]];
 	}
 }
 
+/**
+ * @brief Converts an array of fixed width GB encoded names into UCS2 encoded text.
+ * @param dst Pointer to destination, name n is written to dst + n * size.
+ * @param src Pointer to the first name.
+ * @param size Number of bytes to convert per name.
+ * @param stride Distance in bytes between the start of each name in src.
+ * @param count Number of names to convert.
+ */
+void gb_text_to_ucs2_batch(char16_t *dst, const char8_t *src, size_t size, size_t stride, size_t count) {
+	for(size_t n = 0; n < count; ++n) {
+		const char8_t *in = src + n * stride;
+		char16_t *out = dst + n * size;
+		size_t i = 0;
+		for(; i + 4 <= size; i += 4) {
+			char16_t a = GB_TO_CODEPAGE[in[i + 0]];
+			char16_t b = GB_TO_CODEPAGE[in[i + 1]];
+			char16_t c = GB_TO_CODEPAGE[in[i + 2]];
+			char16_t d = GB_TO_CODEPAGE[in[i + 3]];
+			out[i + 0] = a;
+			out[i + 1] = b;
+			out[i + 2] = c;
+			out[i + 3] = d;
+		}
+		for(; i < size; ++i) {
+			out[i] = GB_TO_CODEPAGE[in[i]];
+		}
+	}
+}
+
 void ucs2_to_gb_text(char8_t *dst, char16_t *src, size_t size) {
 	uint8_t ended = 0;
-	for(int i = 0; i < size; ++i) {
+	for(size_t i = 0; i < size; ++i) {
 		//go through the table and find the matching symbol for src[i]
 		if(ended) {
 			dst[i] = 0x50;
 		}
 		dst[i] = 0xE6; //question mark by default
-		for(int j = 0; j < GB_CODEPAGE_SIZE; ++j) {
+		for(size_t j = 0; j < GB_CODEPAGE_SIZE; ++j) {
 			if(GB_TO_CODEPAGE[j] == src[i]) {
 				dst[i] = GB_TO_CODEPAGE[j];
 				if(!src[i]) {
@@ -146,20 +198,68 @@ gb_savetype_t gb_detect_type(const uint8_t *ptr) {
 	return GB_TYPE_UNKNOWN;
 }
 
-gb_save_t *gb_read_save(const uint8_t *ptr) {
-	gb_save_t *save = malloc(sizeof(gb_save_t));
+//a save and its data, in one block
+typedef struct {
+	//how to free the block
+	save_allocator_t owner;
+	gb_save_t save;
+	uint8_t data[GB_SAVE_SIZE];
+} gb_save_object_t;
+
+/**
+ * @brief Gets the size of the block a save is read into by gb_read_save_in().
+ * @return The size in bytes.
+ */
+size_t gb_save_object_size(void) {
+	return sizeof(gb_save_object_t);
+}
+
+static gb_save_t *gb_read_save_internal(const uint8_t *ptr, gb_save_object_t *object) {
+	gb_save_t *save = &object->save;
 	save->type = gb_detect_type(ptr);
 	//TODO vary based on save type
-	save->data = malloc(GB_SAVE_SIZE);
+	save->data = object->data;
 	memcpy(save->data, ptr, GB_SAVE_SIZE);
 	return save;
 }
 
+gb_save_t *gb_read_save(const uint8_t *ptr) {
+	return gb_read_save_with(ptr, NULL);
+}
+
+/**
+ * @brief Reads a save into memory from an allocator.
+ * @param ptr The save file.
+ * @param allocator The allocator, NULL for malloc(). gb_free_save() gives the memory back to it.
+ * @return The save, or NULL if out of memory.
+ */
+gb_save_t *gb_read_save_with(const uint8_t *ptr, const save_allocator_t *allocator) {
+	save_allocator_t owner;
+	gb_save_object_t *object = save_alloc(&owner, allocator, sizeof(gb_save_object_t));
+	if(!object) {
+		return NULL;
+	}
+	object->owner = owner;
+	return gb_read_save_internal(ptr, object);
+}
+
+/**
+ * Nothing is allocated, the save lives in the block until it is reused.
+ * @brief Reads a save into a block of the caller's.
+ * @param ptr The save file.
+ * @param block The block, gb_save_object_size() bytes aligned as malloc() would.
+ * @return The save.
+ */
+gb_save_t *gb_read_save_in(const uint8_t *ptr, void *block) {
+	gb_save_object_t *object = block;
+	object->owner = (save_allocator_t){ NULL, NULL, NULL };
+	return gb_read_save_internal(ptr, object);
+}
+
 void gb_free_save(gb_save_t *sav) {
-	//SIGTRAP OCCURING HERE?
-	free(sav->data);
-	sav->data = NULL;
-	free(sav);
+	gb_save_object_t *object = (gb_save_object_t *)((uint8_t *)sav - offsetof(gb_save_object_t, save));
+	save_allocator_t owner = object->owner;
+	save_alloc_free(&owner, object, sizeof(gb_save_object_t));
 }
 
 uint8_t *gb_create_data() {
@@ -179,3 +279,69 @@ void gb_write_save(uint8_t *ptr, const gb_save_t *save) {
 		*((uint16_t *)&ptr[GB_C_CHECKSUM2]) = gb_gsc_checksum(ptr + GB_C_PROTECTED2_START, GB_C_PROTECTED_LENGTH);
 	}
 }
+
+static inline uint16_t gb_get_be16(const uint8_t *ptr) {
+	return (uint16_t)(ptr[0] << 8 | ptr[1]);
+}
+
+static inline void gb_set_be16(uint8_t *ptr, uint16_t value) {
+	ptr[0] = value >> 8;
+	ptr[1] = value & 0xff;
+}
+
+int gb_calc_party_stats(gb_save_t *save, const uint8_t base_stats[256][6]) {
+	size_t party, size, stat_exp, dv, level, current_hp, stats;
+	switch(save->type) {
+		case GB_TYPE_RBY:
+			party = GB_RBY_PARTY;
+			size = GB_RBY_PARTY_POKEMON_SIZE;
+			stat_exp = GB_RBY_POKEMON_STAT_EXP;
+			dv = GB_RBY_POKEMON_DV;
+			level = GB_RBY_POKEMON_LEVEL;
+			current_hp = GB_RBY_POKEMON_CURRENT_HP;
+			stats = GB_RBY_POKEMON_STATS;
+			break;
+		case GB_TYPE_GS:
+		case GB_TYPE_C:
+			party = save->type == GB_TYPE_GS ? GB_GS_PARTY : GB_C_PARTY;
+			size = GB_GSC_PARTY_POKEMON_SIZE;
+			stat_exp = GB_GSC_POKEMON_STAT_EXP;
+			dv = GB_GSC_POKEMON_DV;
+			level = GB_GSC_POKEMON_LEVEL;
+			current_hp = GB_GSC_POKEMON_CURRENT_HP;
+			stats = GB_GSC_POKEMON_STATS;
+			break;
+		default:
+			return -1;
+	}
+	uint8_t count = save->data[party];
+	if(count > POKEMON_IN_PARTY) {
+		count = POKEMON_IN_PARTY;
+	}
+	for(size_t i = 0; i < count; ++i) {
+		uint8_t *pkmn = save->data + party + GB_PARTY_POKEMON + i * size;
+		const uint8_t *base = base_stats[save->data[party + 1 + i]];
+		uint8_t lvl = pkmn[level];
+		//DVs are nibbles: attack, defense, speed, special. HP takes the low bit of each.
+		uint8_t atk = pkmn[dv] >> 4, def = pkmn[dv] & 0xf;
+		uint8_t spd = pkmn[dv + 1] >> 4, spc = pkmn[dv + 1] & 0xf;
+		uint8_t hp = (atk & 1) << 3 | (def & 1) << 2 | (spd & 1) << 1 | (spc & 1);
+		const uint8_t *exp = pkmn + stat_exp;
+		uint8_t *out = pkmn + stats;
+
+		uint16_t max_hp = gb_calc_hp_stat(lvl, base[STAT_HP], hp, gb_get_be16(exp));
+		gb_set_be16(out, max_hp);
+		gb_set_be16(out + 2, gb_calc_stat(lvl, base[STAT_ATTACK], atk, gb_get_be16(exp + 2)));
+		gb_set_be16(out + 4, gb_calc_stat(lvl, base[STAT_DEFENSE], def, gb_get_be16(exp + 4)));
+		gb_set_be16(out + 6, gb_calc_stat(lvl, base[STAT_SPEED], spd, gb_get_be16(exp + 6)));
+		gb_set_be16(out + 8, gb_calc_stat(lvl, base[STAT_SP_ATTACK], spc, gb_get_be16(exp + 8)));
+		if(save->type != GB_TYPE_RBY) {
+			//special attack and special defense share the special DV and stat exp
+			gb_set_be16(out + 10, gb_calc_stat(lvl, base[STAT_SP_DEFENSE], spc, gb_get_be16(exp + 8)));
+		}
+		if(gb_get_be16(pkmn + current_hp) > max_hp) {
+			gb_set_be16(pkmn + current_hp, max_hp);
+		}
+	}
+	return count;
+}
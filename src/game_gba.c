@@ -7,10 +7,12 @@
 #include "types.h"
 #include "game_gba.h"
 #include "checksum.h"
+#include <stddef.h>
 #include <string.h>
 
 // Prototypes
 void gba_crypt_secure(gba_save_t *);
+static void gba_crypt_copy(const gba_save_t *, uint8_t *, size_t);
 
 // End Prototypes
 
@@ -66,11 +68,44 @@ enum gba_checksum {
  * @param size Number of bytes to convert.
  */
 void gba_text_to_ucs2(char16_t *dst, char8_t *src, size_t size) {
-	for(int i = 0; i < size; ++i) {
+	for(size_t i = 0; i < size; ++i) {
 		dst[i] = GBA_TO_CODEPAGE[src[i]];
 	}
 }
 
+/**
+ * Used to decode many fixed width names at once, such as all the box names in gba_pc_t
+ * (stride GBA_BOX_NAME_LENGTH) or every nickname in a box (stride PK3_BOX_SIZE).
+ * The decoded names are written back to back, so name n starts at dst + n * size.
+ * @brief Converts an array of GBA encoded names into UCS2 encoded text.
+ * @param dst Pointer to destination, must hold size * count characters.
+ * @param src Pointer to the first name.
+ * @param size Number of bytes to convert per name.
+ * @param stride Distance in bytes between the start of each name in src.
+ * @param count Number of names to convert.
+ */
+void gba_text_to_ucs2_batch(char16_t *dst, const char8_t *src, size_t size, size_t stride, size_t count) {
+	for(size_t n = 0; n < count; ++n) {
+		const char8_t *in = src + n * stride;
+		char16_t *out = dst + n * size;
+		size_t i = 0;
+		//unrolled so the independent table loads can be issued together
+		for(; i + 4 <= size; i += 4) {
+			char16_t a = GBA_TO_CODEPAGE[in[i + 0]];
+			char16_t b = GBA_TO_CODEPAGE[in[i + 1]];
+			char16_t c = GBA_TO_CODEPAGE[in[i + 2]];
+			char16_t d = GBA_TO_CODEPAGE[in[i + 3]];
+			out[i + 0] = a;
+			out[i + 1] = b;
+			out[i + 2] = c;
+			out[i + 3] = d;
+		}
+		for(; i < size; ++i) {
+			out[i] = GBA_TO_CODEPAGE[in[i]];
+		}
+	}
+}
+
 #include <stdio.h>
 
 /**
@@ -80,9 +115,9 @@ void gba_text_to_ucs2(char16_t *dst, char8_t *src, size_t size) {
  * @param size Number of bytes to convert.
  */
 void ucs2_to_gba_text(char8_t *dst, char16_t *src, size_t size) {
-	for(int i = 0; i < size; ++i) {
+	for(size_t i = 0; i < size; ++i) {
 		dst[i] = 0xAC; //question mark
-		for(int j = 0; j < GBA_CODEPAGE_SIZE; ++j) {
+		for(size_t j = 0; j < GBA_CODEPAGE_SIZE; ++j) {
 			if(GBA_TO_CODEPAGE[j] == src[i]) {
 				dst[i] = j;
 				break;
@@ -91,6 +126,88 @@ void ucs2_to_gba_text(char8_t *dst, char16_t *src, size_t size) {
 	}
 }
 
+enum gba_text_search {
+	GBA_TEXT_TERMINATOR = 0xFF,
+	GBA_TEXT_WORD_SIZE = 16,
+	//lower case letters sit a fixed distance above their upper case forms
+	GBA_TEXT_LOWER_START = 0xD5,
+	GBA_TEXT_LOWER_END = 0xEE,
+	GBA_TEXT_LOWER_DELTA = 0x1A,
+	GBA_TEXT_UMLAUT_START = 0xF4,
+	GBA_TEXT_UMLAUT_END = 0xF6,
+	GBA_TEXT_UMLAUT_DELTA = 0x3
+};
+
+static inline void gba_text_load(uint64_t *dst, const char8_t *src, size_t size) {
+	uint8_t buf[GBA_TEXT_WORD_SIZE];
+	memset(buf, GBA_TEXT_TERMINATOR, GBA_TEXT_WORD_SIZE);
+	memcpy(buf, src, size < GBA_TEXT_WORD_SIZE ? size : GBA_TEXT_WORD_SIZE);
+	memcpy(dst, buf, GBA_TEXT_WORD_SIZE);
+}
+
+/* Subtracts delta from every byte in [lo, hi] of the word, eight characters at a time. Both bounds must have the top bit set. */
+static inline uint64_t gba_text_fold_range(uint64_t x, uint8_t lo, uint8_t hi, uint8_t delta) {
+	const uint64_t ones = 0x0101010101010101ULL;
+	const uint64_t high = ones * 0x80;
+	uint64_t low = x & ~high;
+	uint64_t above = (low + ones * (0x80 - (lo & 0x7F))) & high;
+	uint64_t below = (ones * (0x80 + (hi & 0x7F)) - low) & high;
+	return x - ((above & below & x) >> 7) * delta;
+}
+
+static inline uint64_t gba_text_fold(uint64_t x) {
+	x = gba_text_fold_range(x, GBA_TEXT_LOWER_START, GBA_TEXT_LOWER_END, GBA_TEXT_LOWER_DELTA);
+	return gba_text_fold_range(x, GBA_TEXT_UMLAUT_START, GBA_TEXT_UMLAUT_END, GBA_TEXT_UMLAUT_DELTA);
+}
+
+/**
+ * @brief Encodes a UCS2 string into a query for searching GBA text.
+ * @param query The query to initialize.
+ * @param text The UCS2 text to search for, it ends at the first null or after length characters.
+ * @param length The maximum number of characters to read from text, at most GBA_TEXT_QUERY_LENGTH are used.
+ * @param flags The gba_text_match_t flags to match with.
+ */
+void gba_text_query_init(gba_text_query_t *query, const char16_t *text, size_t length, gba_text_match_t flags) {
+	uint8_t buf[GBA_TEXT_WORD_SIZE];
+	uint8_t mask[GBA_TEXT_WORD_SIZE];
+	size_t size = 0;
+	while(size < length && size < GBA_TEXT_QUERY_LENGTH && text[size]) {
+		++size;
+	}
+	memset(buf, GBA_TEXT_TERMINATOR, GBA_TEXT_WORD_SIZE);
+	memset(mask, 0, GBA_TEXT_WORD_SIZE);
+	ucs2_to_gba_text(buf, (char16_t *)text, size);
+	memset(mask, 0xFF, size);
+	if(!(flags & GBA_TEXT_MATCH_PREFIX)) {
+		//the terminator has to match as well, unless the name fills the whole field
+		mask[size] = 0xFF;
+	}
+	memcpy(query->text, buf, GBA_TEXT_WORD_SIZE);
+	memcpy(query->mask, mask, GBA_TEXT_WORD_SIZE);
+	if(flags & GBA_TEXT_MATCH_IGNORE_CASE) {
+		query->text[0] = gba_text_fold(query->text[0]);
+		query->text[1] = gba_text_fold(query->text[1]);
+	}
+	query->flags = flags;
+}
+
+/**
+ * @brief Compares a GBA encoded text field against a query.
+ * @param query The query made with gba_text_query_init().
+ * @param text The GBA encoded field, such as pk3_box_t::nickname.
+ * @param size The size of the field in bytes.
+ * @return true if the field matches, false otherwise.
+ */
+uint8_t gba_text_query_match(const gba_text_query_t *query, const char8_t *text, size_t size) {
+	uint64_t word[2];
+	gba_text_load(word, text, size);
+	if(query->flags & GBA_TEXT_MATCH_IGNORE_CASE) {
+		word[0] = gba_text_fold(word[0]);
+		word[1] = gba_text_fold(word[1]);
+	}
+	return !(((word[0] ^ query->text[0]) & query->mask[0]) | ((word[1] ^ query->text[1]) & query->mask[1]));
+}
+
 #pragma pack(push, 1)
 //12 byte footer for every data block
 typedef struct {
@@ -104,8 +221,23 @@ typedef struct {
 typedef struct {
 	uint8_t order[GBA_SAVE_BLOCK_COUNT];
 	uint32_t save_index;
+	//one pc_bitmap word per box
+	uint32_t occupied[GBA_BOX_COUNT];
+	//one bit per section id changed since the save was read
+	uint16_t dirty;
+	//NULL unless gba_journal_start() was called
+	save_journal_t *journal;
 } gba_internal_save_t;
 
+//a save and everything it holds, in one block
+typedef struct {
+	//how to free the block
+	save_allocator_t owner;
+	gba_save_t save;
+	gba_internal_save_t internal;
+	uint8_t data[GBA_UNPACKED_SIZE];
+} gba_save_object_t;
+
 static inline gba_footer_t *get_block_footer(const uint8_t *ptr) {
 	return (gba_footer_t *)(ptr + GBA_BLOCK_LENGTH - GBA_BLOCK_FOOTER_LENGTH);
 }
@@ -144,6 +276,60 @@ size_t gba_get_backup_offset(const uint8_t *ptr) {
 	return 0;
 }
 
+/**
+ * @brief Checks the footer mark and checksum of every block of the main save.
+ * @param ptr The save file, GBA_SAVE_SIZE bytes long.
+ * @return Bit n is set if block n of the main save is damaged, 0 if the save is intact.
+ */
+uint16_t gba_check_main_save(const uint8_t *ptr) {
+	const uint8_t *save = ptr + gba_get_save_offset(ptr);
+	uint16_t bad = 0;
+	for(size_t i = 0; i < GBA_SAVE_BLOCK_COUNT; ++i) {
+		const uint8_t *block = save + i * GBA_BLOCK_LENGTH;
+		gba_footer_t *footer = get_block_footer(block);
+		if(footer->mark != GBA_BLOCK_FOOTER_MARK || footer->section_id >= GBA_SAVE_BLOCK_COUNT
+				|| footer->checksum != get_block_checksum(block)) {
+			bad |= 1u << i;
+		}
+	}
+	return bad;
+}
+
+_Static_assert((size_t)SAVE_ARCHIVE_CHUNK_SIZE == (size_t)GBA_BLOCK_LENGTH, "archive chunks must be GBA sections");
+_Static_assert((size_t)SAVE_ARCHIVE_TRAILER_SIZE >= (size_t)GBA_BLOCK_FOOTER_LENGTH, "archive trailers must hold GBA footers");
+_Static_assert((size_t)GBA_UNPACKED_SIZE == (size_t)GBA_SAVE_BLOCK_COUNT * GBA_BLOCK_DATA_LENGTH, "the sections must cover the unpacked data");
+
+static inline const gba_footer_t *get_archive_footer(const uint8_t *trailer) {
+	return (const gba_footer_t *)(trailer + SAVE_ARCHIVE_TRAILER_SIZE - GBA_BLOCK_FOOTER_LENGTH);
+}
+
+/**
+ * The slot and section are found from the footers kept in the archive index, so only the chunk
+ * holding the section is read.
+ * @brief Reads one section of the main save of a GBA save in an archive.
+ * @param archive The archive.
+ * @param save The number of the save in the archive.
+ * @param section_id The section to read, such as 5 to 13 for the PC.
+ * @param out Receives the section with its footer, 0x1000 bytes.
+ * @return 0 on success, -1 if the save isn't a GBA save, has no such section or couldn't be read.
+ */
+int gba_archive_read_section(const save_archive_t *archive, size_t save, uint8_t section_id, uint8_t *out) {
+	if(save_archive_size(archive, save) != GBA_SAVE_SIZE || section_id >= GBA_SAVE_BLOCK_COUNT) {
+		return -1;
+	}
+	const gba_footer_t *a = get_archive_footer(save_archive_trailer(archive, save, 0));
+	const gba_footer_t *b = get_archive_footer(save_archive_trailer(archive, save, GBA_SAVE_BLOCK_COUNT));
+	//the same slot gba_get_save_offset() picks
+	size_t first = b->save_index > a->save_index ? GBA_SAVE_BLOCK_COUNT : 0;
+	for(size_t i = first; i < first + GBA_SAVE_BLOCK_COUNT; ++i) {
+		const gba_footer_t *footer = get_archive_footer(save_archive_trailer(archive, save, i));
+		if(footer->mark == GBA_BLOCK_FOOTER_MARK && footer->section_id == section_id) {
+			return save_archive_read_chunk(archive, save, i, out);
+		}
+	}
+	return -1;
+}
+
 typedef union {
 	uint32_t key;
 	struct {
@@ -164,22 +350,24 @@ gba_security_key_t gba_get_security_key(uint8_t *ptr) {
 	return *(gba_security_key_t *)ptr;
 }
 
-gba_savetype_t gba_detect_save_type(gba_save_t *save) {
+//data is section 0, the security keys are all in it
+static gba_savetype_t gba_detect_type(const uint8_t *data) {
+	uint8_t *ptr = (uint8_t *)data;
 	//Detecting GBA save type is a pain in the ass
 	//Currently using the security key to determine the save type is a crap shoot, since the key can be zero
 	//Ruby/Sapphire have a zero security key, the security feature was incomplete in this version
-	if(gba_get_security_key(save->data + GBA_RSE_SECURITY_KEY_OFFSET).key == 0
-			&& gba_get_security_key(save->data + GBA_RSE_SECURITY_KEY2_OFFSET).key == 0) {
+	if(gba_get_security_key(ptr + GBA_RSE_SECURITY_KEY_OFFSET).key == 0
+			&& gba_get_security_key(ptr + GBA_RSE_SECURITY_KEY2_OFFSET).key == 0) {
 		return GBA_TYPE_RS;
 	}
 	//But it works fine in Emerald
-	if(gba_get_security_key(save->data + GBA_RSE_SECURITY_KEY_OFFSET).key
-			== gba_get_security_key(save->data + GBA_RSE_SECURITY_KEY2_OFFSET).key) {
+	if(gba_get_security_key(ptr + GBA_RSE_SECURITY_KEY_OFFSET).key
+			== gba_get_security_key(ptr + GBA_RSE_SECURITY_KEY2_OFFSET).key) {
 		return GBA_TYPE_E;
 	}
 	//FRLG has the keys in different locations, yay!
-	if(gba_get_security_key(save->data + GBA_FRLG_SECURITY_KEY_OFFSET).key
-			== gba_get_security_key(save->data + GBA_FRLG_SECURITY_KEY2_OFFSET).key) {
+	if(gba_get_security_key(ptr + GBA_FRLG_SECURITY_KEY_OFFSET).key
+			== gba_get_security_key(ptr + GBA_FRLG_SECURITY_KEY2_OFFSET).key) {
 		return GBA_TYPE_FRLG;
 	}
 	//TODO base it off from pokemon encryption, so we can be more sure that we have the correct versions
@@ -187,43 +375,119 @@ gba_savetype_t gba_detect_save_type(gba_save_t *save) {
 	return GBA_TYPE_UNKNOWN;
 }
 
+gba_savetype_t gba_detect_save_type(gba_save_t *save) {
+	return gba_detect_type(save->data);
+}
+
+/**
+ * @brief Gets the size of the block a save is read into by gba_read_main_save_in().
+ * @return The size in bytes.
+ */
+size_t gba_save_object_size(void) {
+	return sizeof(gba_save_object_t);
+}
+
 /**
  * Unpacks the save at the pointer to a gba_save_t
  * @param ptr pointer to the data
+ * @param object the block to unpack into
  * @return the save
  */
-gba_save_t *gba_read_save_internal(const uint8_t *ptr) {
+static gba_save_t *gba_read_save_internal(const uint8_t *ptr, gba_save_object_t *object) {
+	gba_save_t *save = &object->save;
+	gba_internal_save_t *internal = save->internal = &object->internal;
+	save->data = object->data;
 	//check first footer ID
-	gba_save_t *save = malloc(sizeof(gba_save_t));
-	gba_internal_save_t *internal = save->internal = malloc(sizeof(gba_internal_save_t));
-	save->data = malloc(GBA_UNPACKED_SIZE);
 	internal->save_index = get_block_footer(ptr)->save_index;
-	memset(save->data, 0, GBA_UNPACKED_SIZE); //not sure if it is 0 or 0xFF
+	internal->dirty = 0;
+	internal->journal = NULL;
+	uint16_t unpacked = 0;
 	for(size_t i = 0; i < GBA_SAVE_BLOCK_COUNT; ++i) {
 		const uint8_t *block_ptr = ptr + i * GBA_BLOCK_LENGTH;
 		//get footer
 		gba_footer_t *footer = get_block_footer(block_ptr);
+		if(footer->section_id >= GBA_SAVE_BLOCK_COUNT) {
+			//damaged, it is given one of the missing sections below
+			internal->order[i] = GBA_SAVE_BLOCK_COUNT;
+			continue;
+		}
 		internal->order[i] = footer->section_id;
+		unpacked |= 1 << footer->section_id;
 		//get ptr to unpack too
 		uint8_t *unpack_ptr = save->data + footer->section_id * GBA_BLOCK_DATA_LENGTH;
 		memcpy(unpack_ptr, block_ptr, GBA_BLOCK_DATA_LENGTH);
 	}
+	//the sections cover the data exactly, so only the missing ones need clearing, usually none
+	size_t damaged = 0;
+	for(size_t i = 0; i < GBA_SAVE_BLOCK_COUNT; ++i) {
+		if((unpacked >> i) & 1) {
+			continue;
+		}
+		memset(save->data + i * GBA_BLOCK_DATA_LENGTH, 0, GBA_BLOCK_DATA_LENGTH); //not sure if it is 0 or 0xFF
+		//so the write paths always see an id in range
+		while(damaged < GBA_SAVE_BLOCK_COUNT && internal->order[damaged] != GBA_SAVE_BLOCK_COUNT) {
+			++damaged;
+		}
+		if(damaged < GBA_SAVE_BLOCK_COUNT) {
+			internal->order[damaged] = i;
+		}
+	}
 	save->type = gba_detect_save_type(save);
 	//Decrypt data that needs to be
 	gba_crypt_secure(save);
+	gba_pc_refresh_occupancy(save);
 	return save;
 }
 
+static gba_save_object_t *gba_alloc_save(const save_allocator_t *allocator) {
+	save_allocator_t owner;
+	gba_save_object_t *object = save_alloc(&owner, allocator, sizeof(gba_save_object_t));
+	if(object) {
+		object->owner = owner;
+	}
+	return object;
+}
+
 /**
  * @brief Reads the main save from the given save pointer.
  * @param ptr The pointer to read from.
  * @return The main save for this GBA game.
  */
 gba_save_t *gba_read_main_save(const uint8_t *ptr) {
+	return gba_read_main_save_with(ptr, NULL);
+}
+
+/**
+ * @brief Reads the main save from the given save pointer into memory from an allocator.
+ * @param ptr The pointer to read from.
+ * @param allocator The allocator, NULL for malloc(). gba_free_save() gives the memory back to it.
+ * @return The main save for this GBA game, or NULL if it isn't one or out of memory.
+ */
+gba_save_t *gba_read_main_save_with(const uint8_t *ptr, const save_allocator_t *allocator) {
+	if(!gba_is_gba_save(ptr)) {
+		return NULL;
+	}
+	gba_save_object_t *object = gba_alloc_save(allocator);
+	if(!object) {
+		return NULL;
+	}
+	return gba_read_save_internal(ptr + gba_get_save_offset(ptr), object);
+}
+
+/**
+ * Nothing is allocated, the save lives in the block until it is reused.
+ * @brief Reads the main save from the given save pointer into a block of the caller's.
+ * @param ptr The pointer to read from.
+ * @param block The block, gba_save_object_size() bytes aligned as malloc() would.
+ * @return The main save for this GBA game, or NULL if it isn't one.
+ */
+gba_save_t *gba_read_main_save_in(const uint8_t *ptr, void *block) {
 	if(!gba_is_gba_save(ptr)) {
 		return NULL;
 	}
-	return gba_read_save_internal(ptr + gba_get_save_offset(ptr));
+	gba_save_object_t *object = block;
+	object->owner = (save_allocator_t){ NULL, NULL, NULL };
+	return gba_read_save_internal(ptr + gba_get_save_offset(ptr), object);
 }
 
 /**
@@ -235,30 +499,34 @@ gba_save_t *gba_read_backup_save(const uint8_t *ptr) {
 	if(!gba_is_gba_save(ptr)) {
 		return NULL;
 	}
-	return gba_read_save_internal(ptr + gba_get_backup_offset(ptr));
+	gba_save_object_t *object = gba_alloc_save(NULL);
+	if(!object) {
+		return NULL;
+	}
+	return gba_read_save_internal(ptr + gba_get_backup_offset(ptr), object);
 }
 
 /**
  * @brief Frees the gba save made for the user.
- * @param save The pointer to the save to free.
+ * @param save The pointer to the save to free. A save read into a block of the caller's only has its journal freed.
  */
 void gba_free_save(gba_save_t *save) {
-	free(save->data);
-	free((gba_internal_save_t *)save->internal);
-	free(save);
+	gba_journal_stop(save);
+	gba_save_object_t *object = (gba_save_object_t *)((uint8_t *)save - offsetof(gba_save_object_t, save));
+	save_allocator_t owner = object->owner;
+	save_alloc_free(&owner, object, sizeof(gba_save_object_t));
 }
 
 void gba_write_save_internal(uint8_t *ptr, const gba_save_t *save) {
 	//wipe whatever is there now
 	memset(ptr, 0, GBA_SAVE_SECTION);
 	gba_internal_save_t *internal = save->internal;
-	//Encrypt data that needs to be
-	gba_crypt_secure((gba_save_t *)save);
 	for(size_t i = 0; i < GBA_SAVE_BLOCK_COUNT; ++i) {
-		//write data
+		//write data, encrypting what needs to be in the copy so the save is left alone
 		uint8_t *dest_ptr = ptr + i * GBA_BLOCK_LENGTH;
 		uint8_t *src_ptr = save->data + internal->order[i] * GBA_BLOCK_DATA_LENGTH;
 		memcpy(dest_ptr, src_ptr, GBA_BLOCK_DATA_LENGTH);
+		gba_crypt_copy(save, dest_ptr, internal->order[i]);
 		//write footer
 		gba_footer_t *footer = get_block_footer(dest_ptr);
 		footer->section_id = internal->order[i];
@@ -267,9 +535,6 @@ void gba_write_save_internal(uint8_t *ptr, const gba_save_t *save) {
 		//calculate checksum
 		footer->checksum = get_block_checksum(dest_ptr);
 	}
-	//Decrypt the data again! Since they might make more edits and such.
-	gba_crypt_secure((gba_save_t *)save);
-	//See... we didn't change anything <.< >.>
 }
 
 /**
@@ -290,6 +555,167 @@ void gba_write_backup_save(uint8_t *dst, const gba_save_t *save) {
 	gba_write_save_internal(dst + gba_get_backup_offset(dst), save);
 }
 
+/**
+ * Only sections marked with gba_mark_dirty() are copied and given new checksums, the rest of
+ * dst is left alone. dst must hold the file the save was read from with gba_read_main_save(),
+ * since the sections are written where that file keeps them. The dirty marks are cleared.
+ * @brief Writes the changed sections of the save back to the main slot of dst.
+ * @param dst The file the save was read from, GBA_SAVE_SIZE bytes long.
+ * @param save The save to write.
+ */
+void gba_update_main_save(uint8_t *dst, gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	uint8_t *ptr = dst + gba_get_save_offset(dst);
+	if(!internal->dirty) {
+		return;
+	}
+	for(size_t i = 0; i < GBA_SAVE_BLOCK_COUNT; ++i) {
+		if(!((internal->dirty >> internal->order[i]) & 1)) {
+			continue;
+		}
+		uint8_t *dest_ptr = ptr + i * GBA_BLOCK_LENGTH;
+		memcpy(dest_ptr, save->data + internal->order[i] * GBA_BLOCK_DATA_LENGTH, GBA_BLOCK_DATA_LENGTH);
+		gba_crypt_copy(save, dest_ptr, internal->order[i]);
+		get_block_footer(dest_ptr)->checksum = get_block_checksum(dest_ptr);
+	}
+	internal->dirty = 0;
+}
+
+/**
+ * @brief Marks the sections holding part of the save data as changed.
+ * @param save The save that was changed.
+ * @param ptr Pointer to the changed bytes, inside save->data.
+ * @param size The number of bytes changed.
+ */
+void gba_mark_dirty(gba_save_t *save, const void *ptr, size_t size) {
+	gba_internal_save_t *internal = save->internal;
+	size_t offset = (const uint8_t *)ptr - save->data;
+	if(!size || offset >= GBA_UNPACKED_SIZE) {
+		return;
+	}
+	size_t first = offset / GBA_BLOCK_DATA_LENGTH;
+	size_t last = (offset + size - 1) / GBA_BLOCK_DATA_LENGTH;
+	for(size_t i = first; i <= last && i < GBA_SAVE_BLOCK_COUNT; ++i) {
+		internal->dirty |= 1u << i;
+	}
+}
+
+/**
+ * @brief Gets the sections changed since the save was read or last updated.
+ * @param save The save to check.
+ * @return Bit n is set if section n was changed.
+ */
+uint16_t gba_get_dirty(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	return internal->dirty;
+}
+
+/**
+ * Once started, the library's editing functions record what they change. Changes made through
+ * the pointers it hands out, such as gba_get_party(), must be recorded with gba_journal_record().
+ * @brief Starts keeping an undo journal for the save.
+ * @param save The save to keep a journal for.
+ * @return 0 on success, -1 if out of memory.
+ */
+int gba_journal_start(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	if(!internal->journal) {
+		internal->journal = save_journal_create();
+	}
+	return internal->journal ? 0 : -1;
+}
+
+/**
+ * @brief Stops keeping an undo journal for the save, forgetting its steps.
+ * @param save The save.
+ */
+void gba_journal_stop(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	if(internal->journal) {
+		save_journal_free(internal->journal);
+		internal->journal = NULL;
+	}
+}
+
+/**
+ * @brief Gets the undo journal of the save, for save_journal_steps() and save_journal_memory().
+ * @param save The save.
+ * @return The journal, or NULL if gba_journal_start() wasn't called.
+ */
+save_journal_t *gba_get_journal(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	return internal->journal;
+}
+
+/**
+ * Does nothing unless the save has a journal. This doesn't mark the bytes dirty, call
+ * gba_mark_dirty() after the change as usual.
+ * @brief Records part of the save data that is about to change, so the change can be undone.
+ * @param save The save that is about to change.
+ * @param ptr Pointer to the bytes that may change, inside save->data.
+ * @param size The number of bytes that may change.
+ */
+void gba_journal_record(gba_save_t *save, const void *ptr, size_t size) {
+	gba_internal_save_t *internal = save->internal;
+	size_t offset = (const uint8_t *)ptr - save->data;
+	if(!internal->journal || offset >= GBA_UNPACKED_SIZE) {
+		return;
+	}
+	if(size > GBA_UNPACKED_SIZE - offset) {
+		size = GBA_UNPACKED_SIZE - offset;
+	}
+	save_journal_record(internal->journal, save->data, offset, size);
+}
+
+/**
+ * @brief Ends the current undo step of the save.
+ * @param save The save.
+ * @return 0 on success, -1 if the save has no journal or it ran out of memory.
+ */
+int gba_journal_checkpoint(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	if(!internal->journal) {
+		return -1;
+	}
+	return save_journal_checkpoint(internal->journal, save->data);
+}
+
+static void gba_journal_dirty(size_t offset, size_t size, void *user) {
+	gba_save_t *save = user;
+	gba_mark_dirty(save, save->data + offset, size);
+}
+
+/**
+ * Only the sections holding the bytes put back are marked dirty. Indexes built on the save,
+ * such as a gba_bag_t or gba_pc_index_t, must be built again.
+ * @brief Undoes the last step of changes to the save.
+ * @param save The save.
+ * @return 0 on success, -1 if there is nothing to undo.
+ */
+int gba_journal_undo(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	if(!internal->journal || save_journal_undo(internal->journal, save->data, gba_journal_dirty, save)) {
+		return -1;
+	}
+	gba_pc_refresh_occupancy(save);
+	return 0;
+}
+
+/**
+ * As with gba_journal_undo(), indexes built on the save must be built again.
+ * @brief Redoes the last step of changes undone.
+ * @param save The save.
+ * @return 0 on success, -1 if there is nothing to redo.
+ */
+int gba_journal_redo(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	if(!internal->journal || save_journal_redo(internal->journal, save->data, gba_journal_dirty, save)) {
+		return -1;
+	}
+	gba_pc_refresh_occupancy(save);
+	return 0;
+}
+
 /**
  * @brief Writes the save to the dst similar to how the game would do it.
  * @param dst The pointer to the destination data block. Which should be at least GBA_SAVE_SIZE bytes long.
@@ -346,26 +772,24 @@ void pk3_shuffle(pk3_box_t *pkm) {
 	//0,12,24,36 to shuffle[0 .. 3]
 	const uint8_t *shuffle = pk3_get_shuffle(pkm);
 	uint8_t *bptr = (uint8_t *)pkm->block;
-	uint8_t *tmp = malloc(PK3_DATA_SIZE);
+	uint8_t tmp[PK3_DATA_SIZE];
 	memcpy(tmp, bptr, PK3_DATA_SIZE);
 	memcpy(&bptr[PK3_BLOCK0_START], &tmp[shuffle[0]], PK3_BLOCK_SIZE);
 	memcpy(&bptr[PK3_BLOCK1_START], &tmp[shuffle[1]], PK3_BLOCK_SIZE);
 	memcpy(&bptr[PK3_BLOCK2_START], &tmp[shuffle[2]], PK3_BLOCK_SIZE);
 	memcpy(&bptr[PK3_BLOCK3_START], &tmp[shuffle[3]], PK3_BLOCK_SIZE);
-	free(tmp);
 }
 
 void pk3_unshuffle(pk3_box_t *pkm) {
 	//shuffle[0 .. 3] to 0,12,24,36
 	const uint8_t *shuffle = pk3_get_shuffle(pkm);
 	uint8_t *bptr = (uint8_t *)pkm->block;
-	uint8_t *tmp = malloc(PK3_DATA_SIZE);
+	uint8_t tmp[PK3_DATA_SIZE];
 	memcpy(tmp, bptr, PK3_DATA_SIZE);
 	memcpy(&bptr[shuffle[0]], &tmp[PK3_BLOCK0_START], PK3_BLOCK_SIZE);
 	memcpy(&bptr[shuffle[1]], &tmp[PK3_BLOCK1_START], PK3_BLOCK_SIZE);
 	memcpy(&bptr[shuffle[2]], &tmp[PK3_BLOCK2_START], PK3_BLOCK_SIZE);
 	memcpy(&bptr[shuffle[3]], &tmp[PK3_BLOCK3_START], PK3_BLOCK_SIZE);
-	free(tmp);
 }
 
 void pk3_crypt(pk3_box_t *pkm) {
@@ -429,19 +853,186 @@ gba_pc_t *gba_get_pc(gba_save_t *save) {
 	return (gba_pc_t *)(save->data + GBA_BOX_DATA_OFFSET);
 }
 
+static size_t gba_pc_find_text(gba_pc_t *pc, const gba_text_query_t *query, size_t offset, size_t size, pk3_box_t **found, size_t max) {
+	size_t count = 0;
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		for(size_t j = 0; j < GBA_POKEMON_IN_BOX && count < max; ++j) {
+			pk3_box_t *pkm = &pc->box[i].pokemon[j];
+			//names live in the unencrypted header, so this works on encrypted and decrypted boxes alike
+			if(!pkm->has_species) {
+				continue;
+			}
+			if(gba_text_query_match(query, (const char8_t *)pkm + offset, size)) {
+				found[count++] = pkm;
+			}
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief Finds the pokemon in the PC whose nickname matches the query.
+ * @param pc The PC to search.
+ * @param query The query made with gba_text_query_init().
+ * @param found Array that receives pointers to the matching pokemon.
+ * @param max The size of the found array, the search stops once it is full.
+ * @return The number of pokemon written to found.
+ */
+size_t gba_pc_find_nickname(gba_pc_t *pc, const gba_text_query_t *query, pk3_box_t **found, size_t max) {
+	return gba_pc_find_text(pc, query, offsetof(pk3_box_t, nickname), PK3_NICKNAME_LENGTH, found, max);
+}
+
+/**
+ * @brief Finds the pokemon in the PC whose original trainer name matches the query.
+ * @param pc The PC to search.
+ * @param query The query made with gba_text_query_init().
+ * @param found Array that receives pointers to the matching pokemon.
+ * @param max The size of the found array, the search stops once it is full.
+ * @return The number of pokemon written to found.
+ */
+size_t gba_pc_find_ot_name(gba_pc_t *pc, const gba_text_query_t *query, pk3_box_t **found, size_t max) {
+	return gba_pc_find_text(pc, query, offsetof(pk3_box_t, ot_name), PK3_OT_NAME_LENGTH, found, max);
+}
+
+/**
+ * @brief Counts the pokemon in every box of the PC in a single pass.
+ * @param pc The PC to count.
+ * @param counts Array that receives the number of pokemon in each box.
+ * @return The total number of pokemon in the PC.
+ */
+size_t gba_pc_count_boxes(gba_pc_t *pc, uint8_t counts[GBA_BOX_COUNT]) {
+	size_t total = 0;
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		uint8_t count = 0;
+		for(size_t j = 0; j < GBA_POKEMON_IN_BOX; ++j) {
+			//has_species is in the unencrypted header
+			count += pc->box[i].pokemon[j].has_species;
+		}
+		counts[i] = count;
+		total += count;
+	}
+	return total;
+}
+
+/**
+ * The bitmap is built when the save is read. Call this after changing PC slots without going
+ * through gba_pc_set_occupied(), gba_pc_reserve() or gba_pc_compact().
+ * @brief Rebuilds the PC occupancy bitmap from the PC data.
+ * @param save The save to update.
+ */
+void gba_pc_refresh_occupancy(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	gba_pc_t *pc = gba_get_pc(save);
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		uint32_t word = 0;
+		for(size_t j = 0; j < GBA_POKEMON_IN_BOX; ++j) {
+			//has_species is in the unencrypted header
+			word |= (uint32_t)pc->box[i].pokemon[j].has_species << j;
+		}
+		internal->occupied[i] = word;
+	}
+}
+
+/**
+ * @brief Checks the occupancy bitmap for a PC slot.
+ * @param save The save to check.
+ * @param box The box number.
+ * @param slot The slot within the box.
+ * @return Non-zero if the slot holds a pokemon.
+ */
+uint8_t gba_pc_is_occupied(gba_save_t *save, size_t box, size_t slot) {
+	gba_internal_save_t *internal = save->internal;
+	if(box >= GBA_BOX_COUNT || slot >= GBA_POKEMON_IN_BOX) {
+		return 0;
+	}
+	return (internal->occupied[box] >> slot) & 1;
+}
+
+/**
+ * @brief Marks a PC slot as filled or emptied in the occupancy bitmap.
+ * @param save The save to update.
+ * @param box The box number.
+ * @param slot The slot within the box.
+ * @param occupied Non-zero if the slot now holds a pokemon.
+ */
+void gba_pc_set_occupied(gba_save_t *save, size_t box, size_t slot, uint8_t occupied) {
+	gba_internal_save_t *internal = save->internal;
+	if(box >= GBA_BOX_COUNT || slot >= GBA_POKEMON_IN_BOX) {
+		return;
+	}
+	if(occupied) {
+		internal->occupied[box] |= 1u << slot;
+	} else {
+		internal->occupied[box] &= ~(1u << slot);
+	}
+}
+
+/**
+ * @brief Finds and reserves free PC slots, see pc_bitmap_reserve().
+ * @param save The save to reserve slots in.
+ * @param fill The order to hand out slots in. PC_FILL_CURRENT starts from the PC's current box.
+ * @param count The number of slots wanted.
+ * @param slots Array that receives count slot numbers, each box * GBA_POKEMON_IN_BOX + slot.
+ * @return The number of slots reserved, less than count if the PC is full.
+ */
+size_t gba_pc_reserve(gba_save_t *save, pc_fill_t fill, size_t count, uint16_t *slots) {
+	gba_internal_save_t *internal = save->internal;
+	return pc_bitmap_reserve(internal->occupied, GBA_BOX_COUNT, gba_get_pc(save)->current_box, fill, count, slots);
+}
+
+/**
+ * Pokemon keep their order, box by box and slot by slot, and records are moved as they are,
+ * so this works on encrypted and decrypted boxes alike.
+ * @brief Moves every PC pokemon to the front of the PC, leaving the free slots at the end.
+ * @param save The save to compact.
+ * @return The number of pokemon in the PC.
+ */
+size_t gba_pc_compact(gba_save_t *save) {
+	gba_internal_save_t *internal = save->internal;
+	gba_pc_t *pc = gba_get_pc(save);
+	size_t count = 0;
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		for(uint32_t word = internal->occupied[i] & PC_BITMAP_FULL; word; word &= word - 1) {
+			size_t slot = __builtin_ctz(word);
+			pk3_box_t *from = &pc->box[i].pokemon[slot];
+			pk3_box_t *to = &pc->box[count / GBA_POKEMON_IN_BOX].pokemon[count % GBA_POKEMON_IN_BOX];
+			if(from != to) {
+				gba_journal_record(save, to, sizeof(pk3_box_t));
+				gba_journal_record(save, from, sizeof(pk3_box_t));
+				*to = *from;
+				memset(from, 0, sizeof(pk3_box_t));
+				gba_mark_dirty(save, to, sizeof(pk3_box_t));
+				gba_mark_dirty(save, from, sizeof(pk3_box_t));
+			}
+			++count;
+		}
+	}
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		size_t full = count > i * GBA_POKEMON_IN_BOX ? count - i * GBA_POKEMON_IN_BOX : 0;
+		internal->occupied[i] = full >= GBA_POKEMON_IN_BOX ? PC_BITMAP_FULL : (1u << full) - 1;
+	}
+	return count;
+}
+
 enum {
 	GBA_RSE_STORAGE_OFFSET = GBA_BLOCK_DATA_LENGTH + 0x490,
 	GBA_FRLG_STORAGE_OFFSET = GBA_BLOCK_DATA_LENGTH + 0x290,
 };
 
-uint8_t *gba_get_storage_ptr(gba_save_t *save) {
-	if(save->type == GBA_TYPE_RS || save->type == GBA_TYPE_E) {
-		return save->data + GBA_RSE_STORAGE_OFFSET;
+//where the money and bag are in the unpacked save, 0 for an unknown game
+static size_t gba_storage_offset(gba_savetype_t type) {
+	if(type == GBA_TYPE_RS || type == GBA_TYPE_E) {
+		return GBA_RSE_STORAGE_OFFSET;
 	}
-	if(save->type == GBA_TYPE_FRLG) {
-		return save->data + GBA_FRLG_STORAGE_OFFSET;
+	if(type == GBA_TYPE_FRLG) {
+		return GBA_FRLG_STORAGE_OFFSET;
 	}
-	return NULL;
+	return 0;
+}
+
+uint8_t *gba_get_storage_ptr(gba_save_t *save) {
+	size_t offset = gba_storage_offset(save->type);
+	return offset ? save->data + offset : NULL;
 }
 
 uint32_t gba_get_money(gba_save_t *save) {
@@ -455,7 +1046,10 @@ void gba_set_money(gba_save_t *save, uint32_t money) {
 	if(save->type == GBA_TYPE_UNKNOWN) {
 		return;
 	}
-	*(uint32_t *)gba_get_storage_ptr(save) = money;
+	uint32_t *ptr = (uint32_t *)gba_get_storage_ptr(save);
+	gba_journal_record(save, ptr, sizeof(uint32_t));
+	*ptr = money;
+	gba_mark_dirty(save, ptr, sizeof(uint32_t));
 }
 
 gba_item_slot_t *gba_get_item(gba_save_t *save, size_t index) {
@@ -507,32 +1101,58 @@ size_t gba_get_pocket_size(gba_save_t *save, gba_item_pocket_t pocket) {
 }
 
 
-void gba_crypt_secure(gba_save_t *save) {
-	if(save->type == GBA_TYPE_RS) {
+//the security key of an unpacked save, 0 for games without one
+static uint32_t gba_security_key(gba_savetype_t type, const uint8_t *data) {
+	if(type == GBA_TYPE_E) {
+		return ((const gba_security_key_t *)(data + GBA_RSE_SECURITY_KEY_OFFSET))->key;
+	}
+	if(type == GBA_TYPE_FRLG) {
+		return ((const gba_security_key_t *)(data + GBA_FRLG_SECURITY_KEY_OFFSET))->key;
+	}
+	return 0;
+}
+
+//XORs the key into the money and the bag item amounts, storage is the money
+static void gba_crypt_storage(gba_savetype_t type, uint8_t *storage, uint32_t key) {
+	gba_security_key_t k;
+	k.key = key;
+	//skip the PC items, they aren't encrypted
+	size_t first = 0, count = 0;
+	if(type == GBA_TYPE_E) {
+		first = 50;
+		count = GBA_E_ITEM_COUNT;
+	} else if(type == GBA_TYPE_FRLG) {
+		first = 30;
+		count = GBA_FRLG_ITEM_COUNT;
+	} else {
 		return;
 	}
-	gba_security_key_t key;
-	key.key = 0;
-
-	uint8_t *ptr = save->data;
-	if(save->type == GBA_TYPE_E) {
-		key = gba_get_security_key(save->data + GBA_RSE_SECURITY_KEY_OFFSET);
-		ptr += GBA_RSE_STORAGE_OFFSET;
-		//crypt item data, skip the PC data (not encrypted)
-		for(size_t i = 50; i < GBA_E_ITEM_COUNT; ++i) {
-			gba_item_slot_t *slot = gba_get_item(save, i);
-			slot->amount ^= key.lower;
-		}
-	} else if(save->type == GBA_TYPE_FRLG) {
-		key = gba_get_security_key(save->data + GBA_FRLG_SECURITY_KEY_OFFSET);
-		ptr += GBA_FRLG_STORAGE_OFFSET;
-		//crypt item data, skip the PC data (not encrypted)
-		for(size_t i = 30; i < GBA_FRLG_ITEM_COUNT; ++i) {
-			gba_item_slot_t *slot = gba_get_item(save, i);
-			slot->amount ^= key.lower;
-		}
+	for(size_t i = first; i < count; ++i) {
+		gba_item_slot_t *slot = (gba_item_slot_t *)(storage + i * 4 + 8);
+		slot->amount ^= k.lower;
+	}
+	*(uint32_t *)storage ^= key;
+}
+
+void gba_crypt_secure(gba_save_t *save) {
+	uint8_t *storage = gba_get_storage_ptr(save);
+	if(storage) {
+		gba_crypt_storage(save->type, storage, gba_security_key(save->type, save->data));
+	}
+}
+
+/**
+ * @brief Encrypts the fields of a section that the game keeps encrypted, in a copy of it.
+ * @param save The save the section was copied from, which isn't changed.
+ * @param block The copy of the section data.
+ * @param section_id The id of the section.
+ */
+static void gba_crypt_copy(const gba_save_t *save, uint8_t *block, size_t section_id) {
+	size_t offset = gba_storage_offset(save->type);
+	if(!offset || section_id != offset / GBA_BLOCK_DATA_LENGTH) {
+		return;
 	}
-	*(uint32_t *)ptr ^= key.key;
+	gba_crypt_storage(save->type, block + offset % GBA_BLOCK_DATA_LENGTH, gba_security_key(save->type, save->data));
 }
 
 /**
@@ -604,6 +1224,16 @@ uint8_t gba_pokedex_get_national(gba_save_t *save) {
 	return 0;
 }
 
+//records and marks the three national pokedex flags before they change
+static void gba_national_touch(gba_save_t *save, size_t a, size_t a_size, size_t b, size_t c) {
+	gba_journal_record(save, save->data + a, a_size);
+	gba_journal_record(save, save->data + b, 1);
+	gba_journal_record(save, save->data + c, sizeof(uint16_t));
+	gba_mark_dirty(save, save->data + a, a_size);
+	gba_mark_dirty(save, save->data + b, 1);
+	gba_mark_dirty(save, save->data + c, sizeof(uint16_t));
+}
+
 /**
  * @brief Sets if the national pokedex is owned.
  * @param save The save to set.
@@ -611,6 +1241,7 @@ uint8_t gba_pokedex_get_national(gba_save_t *save) {
  */
 void gba_pokedex_set_national(gba_save_t *save, uint8_t has) {
 	if(save->type == GBA_TYPE_RS) {
+		gba_national_touch(save, GBA_RS_NATIONAL_POKEDEX_A, sizeof(uint16_t), GBA_RS_NATIONAL_POKEDEX_B, GBA_RS_NATIONAL_POKEDEX_C);
 		*(uint16_t *)(save->data + GBA_RS_NATIONAL_POKEDEX_A) = 0xDA01 * has;
 		*(uint16_t *)(save->data + GBA_RS_NATIONAL_POKEDEX_C) = 0x302 * has;
 		if(has) {
@@ -619,6 +1250,7 @@ void gba_pokedex_set_national(gba_save_t *save, uint8_t has) {
 			*(save->data + GBA_RS_NATIONAL_POKEDEX_B) &= ~0x40;
 		}
 	} else if(save->type == GBA_TYPE_E) {
+		gba_national_touch(save, GBA_E_NATIONAL_POKEDEX_A, sizeof(uint16_t), GBA_E_NATIONAL_POKEDEX_B, GBA_E_NATIONAL_POKEDEX_C);
 		*(uint16_t *)(save->data + GBA_E_NATIONAL_POKEDEX_A) = 0xDA01 * has;
 		*(uint16_t *)(save->data + GBA_E_NATIONAL_POKEDEX_C) = 0x302 * has;
 		if(has) {
@@ -627,6 +1259,7 @@ void gba_pokedex_set_national(gba_save_t *save, uint8_t has) {
 			*(save->data + GBA_E_NATIONAL_POKEDEX_B) &= ~0x40;
 		}
 	} else if(save->type == GBA_TYPE_FRLG) {
+		gba_national_touch(save, GBA_FRLG_NATIONAL_POKEDEX_A, 1, GBA_FRLG_NATIONAL_POKEDEX_B, GBA_FRLG_NATIONAL_POKEDEX_C);
 		*(save->data + GBA_FRLG_NATIONAL_POKEDEX_A) = 0xB9 * has;
 		*(uint16_t *)(save->data + GBA_FRLG_NATIONAL_POKEDEX_C) = 0x6258 * has;
 		if(has) {
@@ -647,7 +1280,9 @@ uint8_t gba_pokedex_get_owned(gba_save_t *save, size_t index) {
 	return ((save->data + GBA_POKEDEX_OWNED)[index >> 3] >> (index & 7)) & 1;
 }
 
-static inline void gba_dex_set(uint8_t *ptr, size_t index, uint8_t set) {
+static inline void gba_dex_set(gba_save_t *save, uint8_t *ptr, size_t index, uint8_t set) {
+	gba_journal_record(save, &ptr[index >> 3], 1);
+	gba_mark_dirty(save, &ptr[index >> 3], 1);
 	if(set) { //set
 		ptr[index >> 3] |= 1 << (index & 7);
 	} else {
@@ -662,7 +1297,7 @@ static inline void gba_dex_set(uint8_t *ptr, size_t index, uint8_t set) {
  * @param owned true to set it, false to remove it.
  */
 void gba_pokedex_set_owned(gba_save_t *save, size_t index, uint8_t owned) {
-	gba_dex_set(save->data + GBA_POKEDEX_OWNED, index, owned);
+	gba_dex_set(save, save->data + GBA_POKEDEX_OWNED, index, owned);
 }
 
 /**
@@ -683,15 +1318,599 @@ uint8_t gba_pokedex_get_seen(gba_save_t *save, size_t index) {
  * @param owned true to set it, false to remove it.
  */
 void gba_pokedex_set_seen(gba_save_t *save, size_t index, uint8_t seen) {
-	gba_dex_set(save->data + GBA_POKEDEX_SEEN_A, index, seen);
+	gba_dex_set(save, save->data + GBA_POKEDEX_SEEN_A, index, seen);
+	if(save->type == GBA_TYPE_RS) {
+		gba_dex_set(save, save->data + GBA_RS_POKEDEX_SEEN_B, index, seen);
+		gba_dex_set(save, save->data + GBA_RS_POKEDEX_SEEN_C, index, seen);
+	} else if(save->type == GBA_TYPE_E) {
+		gba_dex_set(save, save->data + GBA_E_POKEDEX_SEEN_B, index, seen);
+		gba_dex_set(save, save->data + GBA_E_POKEDEX_SEEN_C, index, seen);
+	} else if(save->type == GBA_TYPE_FRLG) {
+		gba_dex_set(save, save->data + GBA_FRLG_POKEDEX_SEEN_B, index, seen);
+		gba_dex_set(save, save->data + GBA_FRLG_POKEDEX_SEEN_C, index, seen);
+	}
+}
+
+enum {
+	GBA_POKEDEX_WORDS = (GBA_POKEDEX_SIZE + 63) / 64
+};
+
+//the copies of a pokedex list, the first one is the one read from
+static size_t gba_dex_copies(gba_save_t *save, gba_pokedex_list_t list, uint8_t *copies[3]) {
+	if(list == GBA_POKEDEX_LIST_OWNED) {
+		copies[0] = save->data + GBA_POKEDEX_OWNED;
+		return 1;
+	}
+	copies[0] = save->data + GBA_POKEDEX_SEEN_A;
 	if(save->type == GBA_TYPE_RS) {
-		gba_dex_set(save->data + GBA_RS_POKEDEX_SEEN_B, index, seen);
-		gba_dex_set(save->data + GBA_RS_POKEDEX_SEEN_C, index, seen);
+		copies[1] = save->data + GBA_RS_POKEDEX_SEEN_B;
+		copies[2] = save->data + GBA_RS_POKEDEX_SEEN_C;
 	} else if(save->type == GBA_TYPE_E) {
-		gba_dex_set(save->data + GBA_E_POKEDEX_SEEN_B, index, seen);
-		gba_dex_set(save->data + GBA_E_POKEDEX_SEEN_C, index, seen);
+		copies[1] = save->data + GBA_E_POKEDEX_SEEN_B;
+		copies[2] = save->data + GBA_E_POKEDEX_SEEN_C;
 	} else if(save->type == GBA_TYPE_FRLG) {
-		gba_dex_set(save->data + GBA_FRLG_POKEDEX_SEEN_B, index, seen);
-		gba_dex_set(save->data + GBA_FRLG_POKEDEX_SEEN_C, index, seen);
+		copies[1] = save->data + GBA_FRLG_POKEDEX_SEEN_B;
+		copies[2] = save->data + GBA_FRLG_POKEDEX_SEEN_C;
+	} else {
+		return 1;
+	}
+	return 3;
+}
+
+//the bits of word w that are pokedex entries
+static inline uint64_t gba_dex_mask(size_t w) {
+	size_t bits = GBA_POKEDEX_SIZE - w * 64;
+	return bits >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << bits) - 1;
+}
+
+//the bits of word w that fall in [first, first + count)
+static inline uint64_t gba_dex_range(size_t w, size_t first, size_t count) {
+	size_t lo = w * 64, hi = lo + 64, end = first + count;
+	if(end <= lo || first >= hi) {
+		return 0;
+	}
+	uint64_t mask = ~(uint64_t)0;
+	if(first > lo) {
+		mask &= ~(uint64_t)0 << (first - lo);
+	}
+	if(end < hi) {
+		mask &= ((uint64_t)1 << (end - lo)) - 1;
+	}
+	return mask;
+}
+
+//read a list as words, from the first copy
+static void gba_dex_read(gba_save_t *save, gba_pokedex_list_t list, uint64_t words[GBA_POKEDEX_WORDS]) {
+	uint8_t *copies[3];
+	gba_dex_copies(save, list, copies);
+	uint8_t bytes[GBA_POKEDEX_WORDS * 8] = { 0 };
+	memcpy(bytes, copies[0], GBA_POKEDEX_BYTES);
+	memcpy(words, bytes, sizeof(bytes));
+	for(size_t w = 0; w < GBA_POKEDEX_WORDS; ++w) {
+		words[w] &= gba_dex_mask(w);
+	}
+}
+
+//write a list to every copy, leaving the bits past the last entry alone
+static void gba_dex_write(gba_save_t *save, gba_pokedex_list_t list, const uint64_t words[GBA_POKEDEX_WORDS]) {
+	uint8_t *copies[3];
+	size_t count = gba_dex_copies(save, list, copies);
+	uint8_t bytes[GBA_POKEDEX_WORDS * 8];
+	memcpy(bytes, words, sizeof(bytes));
+	for(size_t i = 0; i < count; ++i) {
+		//the last byte is shared with whatever follows the list
+		uint8_t keep = GBA_POKEDEX_SIZE % 8 ? (uint8_t)(0xFF << (GBA_POKEDEX_SIZE % 8)) : 0;
+		uint8_t last = (bytes[GBA_POKEDEX_BYTES - 1] & ~keep) | (copies[i][GBA_POKEDEX_BYTES - 1] & keep);
+		gba_journal_record(save, copies[i], GBA_POKEDEX_BYTES);
+		memcpy(copies[i], bytes, GBA_POKEDEX_BYTES - 1);
+		copies[i][GBA_POKEDEX_BYTES - 1] = last;
+		gba_mark_dirty(save, copies[i], GBA_POKEDEX_BYTES);
+	}
+}
+
+/**
+ * @brief Counts the set entries in part of a pokedex list.
+ * @param save The save to check.
+ * @param list The list to count.
+ * @param first The first national index number (starting from 0) to count.
+ * @param count The number of entries to count.
+ * @return The number of entries set.
+ */
+size_t gba_pokedex_count(gba_save_t *save, gba_pokedex_list_t list, size_t first, size_t count) {
+	uint64_t words[GBA_POKEDEX_WORDS];
+	size_t total = 0;
+	gba_dex_read(save, list, words);
+	for(size_t w = 0; w < GBA_POKEDEX_WORDS; ++w) {
+		total += __builtin_popcountll(words[w] & gba_dex_range(w, first, count));
+	}
+	return total;
+}
+
+/**
+ * Every copy of the list is updated. Owned entries don't imply seen ones, set both lists to
+ * add a pokemon to the pokedex.
+ * @brief Sets or clears a range of pokedex entries.
+ * @param save The save to change.
+ * @param list The list to change.
+ * @param first The first national index number (starting from 0) to change.
+ * @param count The number of entries to change.
+ * @param set true to set the entries, false to clear them.
+ */
+void gba_pokedex_set_range(gba_save_t *save, gba_pokedex_list_t list, size_t first, size_t count, uint8_t set) {
+	uint64_t words[GBA_POKEDEX_WORDS];
+	gba_dex_read(save, list, words);
+	for(size_t w = 0; w < GBA_POKEDEX_WORDS; ++w) {
+		uint64_t range = gba_dex_range(w, first, count);
+		words[w] = set ? words[w] | range : words[w] & ~range;
+	}
+	gba_dex_write(save, list, words);
+}
+
+/**
+ * @brief Sets or clears every entry of a pokedex list.
+ * @param save The save to change.
+ * @param list The list to change.
+ * @param set true to set the entries, false to clear them.
+ */
+void gba_pokedex_set_all(gba_save_t *save, gba_pokedex_list_t list, uint8_t set) {
+	gba_pokedex_set_range(save, list, 0, GBA_POKEDEX_SIZE, set);
+}
+
+/**
+ * @brief Combines a pokedex list with the same list from another save.
+ * @param save The save to change.
+ * @param other The save to combine with, it is not changed.
+ * @param list The list to combine.
+ * @param op How to combine them.
+ */
+void gba_pokedex_merge(gba_save_t *save, gba_save_t *other, gba_pokedex_list_t list, gba_pokedex_op_t op) {
+	uint64_t words[GBA_POKEDEX_WORDS], others[GBA_POKEDEX_WORDS];
+	gba_dex_read(save, list, words);
+	gba_dex_read(other, list, others);
+	for(size_t w = 0; w < GBA_POKEDEX_WORDS; ++w) {
+		if(op == GBA_POKEDEX_UNION) {
+			words[w] |= others[w];
+		} else if(op == GBA_POKEDEX_DIFFERENCE) {
+			words[w] &= ~others[w];
+		} else if(op == GBA_POKEDEX_INTERSECTION) {
+			words[w] &= others[w];
+		}
+	}
+	gba_dex_write(save, list, words);
+}
+
+/**
+ * @brief Copies a pokedex list out of the save.
+ * @param save The save to read.
+ * @param list The list to copy.
+ * @param bits Receives the list, bit n % 8 of byte n / 8 is national index number n (starting
+ * from 0). Bits past the last entry are cleared.
+ */
+void gba_pokedex_export(gba_save_t *save, gba_pokedex_list_t list, uint8_t bits[GBA_POKEDEX_BYTES]) {
+	uint64_t words[GBA_POKEDEX_WORDS];
+	gba_dex_read(save, list, words);
+	memcpy(bits, words, GBA_POKEDEX_BYTES);
+}
+
+/**
+ * @brief Replaces a pokedex list, updating every copy.
+ * @param save The save to change.
+ * @param list The list to replace.
+ * @param bits The new list, laid out as by gba_pokedex_export(). Bits past the last entry are ignored.
+ */
+void gba_pokedex_import(gba_save_t *save, gba_pokedex_list_t list, const uint8_t bits[GBA_POKEDEX_BYTES]) {
+	uint64_t words[GBA_POKEDEX_WORDS] = { 0 };
+	memcpy(words, bits, GBA_POKEDEX_BYTES);
+	for(size_t w = 0; w < GBA_POKEDEX_WORDS; ++w) {
+		words[w] &= gba_dex_mask(w);
+	}
+	gba_dex_write(save, list, words);
+}
+
+//the main save of a file, read where it lies without unpacking it
+typedef struct {
+	//the data of each section by id, NULL if the file doesn't have it
+	const uint8_t *section[GBA_SAVE_BLOCK_COUNT];
+	uint16_t checksum[GBA_SAVE_BLOCK_COUNT];
+	gba_savetype_t type;
+	gba_security_key_t key;
+} gba_view_t;
+
+static int gba_view_init(gba_view_t *view, const uint8_t *ptr) {
+	if(!gba_is_gba_save(ptr)) {
+		return -1;
+	}
+	memset(view, 0, sizeof(*view));
+	const uint8_t *save = ptr + gba_get_save_offset(ptr);
+	for(size_t i = 0; i < GBA_SAVE_BLOCK_COUNT; ++i) {
+		const uint8_t *block = save + i * GBA_BLOCK_LENGTH;
+		gba_footer_t *footer = get_block_footer(block);
+		if(footer->mark == GBA_BLOCK_FOOTER_MARK && footer->section_id < GBA_SAVE_BLOCK_COUNT) {
+			view->section[footer->section_id] = block;
+			view->checksum[footer->section_id] = footer->checksum;
+		}
+	}
+	view->type = view->section[0] ? gba_detect_type(view->section[0]) : GBA_TYPE_UNKNOWN;
+	if(view->type == GBA_TYPE_E) {
+		view->key = gba_get_security_key((uint8_t *)view->section[0] + GBA_RSE_SECURITY_KEY_OFFSET);
+	} else if(view->type == GBA_TYPE_FRLG) {
+		view->key = gba_get_security_key((uint8_t *)view->section[0] + GBA_FRLG_SECURITY_KEY_OFFSET);
+	}
+	return 0;
+}
+
+//copies bytes at an offset into the unpacked save out of the sections holding them
+static void gba_view_read(const gba_view_t *view, size_t offset, void *dst, size_t size) {
+	uint8_t *out = dst;
+	while(size) {
+		size_t id = offset / GBA_BLOCK_DATA_LENGTH;
+		size_t at = offset % GBA_BLOCK_DATA_LENGTH;
+		size_t length = GBA_BLOCK_DATA_LENGTH - at < size ? GBA_BLOCK_DATA_LENGTH - at : size;
+		if(id < GBA_SAVE_BLOCK_COUNT && view->section[id]) {
+			memcpy(out, view->section[id] + at, length);
+		} else {
+			memset(out, 0, length);
+		}
+		out += length;
+		offset += length;
+		size -= length;
+	}
+}
+
+//the sections holding any of the bytes at an offset into the unpacked save
+static uint16_t gba_view_sections(size_t offset, size_t size) {
+	size_t first = offset / GBA_BLOCK_DATA_LENGTH;
+	size_t last = (offset + size - 1) / GBA_BLOCK_DATA_LENGTH;
+	uint16_t mask = 0;
+	for(size_t i = first; i <= last && i < GBA_SAVE_BLOCK_COUNT; ++i) {
+		mask |= 1u << i;
+	}
+	return mask;
+}
+
+static uint16_t gba_view_compare(const gba_view_t *a, const gba_view_t *b) {
+	uint16_t changed = 0;
+	for(size_t i = 0; i < GBA_SAVE_BLOCK_COUNT; ++i) {
+		if(!a->section[i] || !b->section[i]) {
+			if(a->section[i] != b->section[i]) {
+				changed |= 1u << i;
+			}
+		} else if(a->checksum[i] != b->checksum[i]
+				|| memcmp(a->section[i], b->section[i], GBA_BLOCK_DATA_LENGTH)) {
+			//equal checksums are only a hint, the bytes have the final say
+			changed |= 1u << i;
+		}
+	}
+	return changed;
+}
+
+/**
+ * The checksum in each section's footer is compared first, and the section data only if the
+ * checksums are the same.
+ * @brief Finds the sections that differ between the main saves of two files.
+ * @param a The old file, GBA_SAVE_SIZE bytes long.
+ * @param b The new file, GBA_SAVE_SIZE bytes long.
+ * @return Bit n is set if section n differs, every bit is set if either file isn't a GBA save.
+ */
+uint16_t gba_diff_sections(const uint8_t *a, const uint8_t *b) {
+	gba_view_t va, vb;
+	if(gba_view_init(&va, a) || gba_view_init(&vb, b)) {
+		return (1u << GBA_SAVE_BLOCK_COUNT) - 1;
+	}
+	return gba_view_compare(&va, &vb);
+}
+
+#define GBA_DIFF_FIELD(type, name, member) { name, offsetof(type, member), sizeof(((type *)0)->member) }
+
+static const save_diff_field_t GBA_DIFF_TRAINER[] = {
+	GBA_DIFF_FIELD(gba_trainer_t, "name", name),
+	GBA_DIFF_FIELD(gba_trainer_t, "gender", gender),
+	GBA_DIFF_FIELD(gba_trainer_t, "id", id),
+	GBA_DIFF_FIELD(gba_trainer_t, "sid", sid),
+	GBA_DIFF_FIELD(gba_trainer_t, "hours", time_played.hours),
+	GBA_DIFF_FIELD(gba_trainer_t, "minutes", time_played.minutes),
+	GBA_DIFF_FIELD(gba_trainer_t, "seconds", time_played.seconds),
+	GBA_DIFF_FIELD(gba_trainer_t, "frames", time_played.frames)
+};
+
+static const save_diff_field_t GBA_DIFF_ITEM[] = {
+	GBA_DIFF_FIELD(gba_item_slot_t, "item", index),
+	GBA_DIFF_FIELD(gba_item_slot_t, "amount", amount)
+};
+
+//fields of a decrypted pk3_box_t, the checksum is left out as it follows the data
+static const save_diff_field_t GBA_DIFF_PK3[] = {
+	GBA_DIFF_FIELD(pk3_box_t, "pid", pid),
+	GBA_DIFF_FIELD(pk3_box_t, "ot_id", ot_id),
+	GBA_DIFF_FIELD(pk3_box_t, "ot_sid", ot_sid),
+	GBA_DIFF_FIELD(pk3_box_t, "nickname", nickname),
+	GBA_DIFF_FIELD(pk3_box_t, "language", language),
+	{ "flags", offsetof(pk3_box_t, language) + 1, 1 },
+	GBA_DIFF_FIELD(pk3_box_t, "ot_name", ot_name),
+	GBA_DIFF_FIELD(pk3_box_t, "markings", markings),
+	GBA_DIFF_FIELD(pk3_box_t, "species", species),
+	GBA_DIFF_FIELD(pk3_box_t, "held_item", held_item),
+	GBA_DIFF_FIELD(pk3_box_t, "exp", exp),
+	GBA_DIFF_FIELD(pk3_box_t, "pp_up", pp_up),
+	GBA_DIFF_FIELD(pk3_box_t, "friendship", friendship),
+	GBA_DIFF_FIELD(pk3_box_t, "moves", move),
+	GBA_DIFF_FIELD(pk3_box_t, "move_pp", move_pp),
+	GBA_DIFF_FIELD(pk3_box_t, "ev", ev),
+	GBA_DIFF_FIELD(pk3_box_t, "contest", contest),
+	GBA_DIFF_FIELD(pk3_box_t, "pokerus", pokerus),
+	GBA_DIFF_FIELD(pk3_box_t, "met_loc", met_loc),
+	//level met, game, ball and OT gender share these bytes
+	{ "origins", offsetof(pk3_box_t, met_loc) + 1, 2 },
+	{ "iv", offsetof(pk3_box_t, ribbon) - 4, 4 },
+	GBA_DIFF_FIELD(pk3_box_t, "ribbon", ribbon)
+};
+
+static const save_diff_field_t GBA_DIFF_PK3_PARTY[] = {
+	{ "status", offsetof(pk3_t, party), 1 },
+	GBA_DIFF_FIELD(pk3_t, "level", party.level),
+	GBA_DIFF_FIELD(pk3_t, "pokerus_time", party.pokerus_time),
+	GBA_DIFF_FIELD(pk3_t, "hp", party.stats.hp),
+	GBA_DIFF_FIELD(pk3_t, "max_hp", party.stats.max_hp),
+	GBA_DIFF_FIELD(pk3_t, "atk", party.stats.atk),
+	GBA_DIFF_FIELD(pk3_t, "def", party.stats.def),
+	GBA_DIFF_FIELD(pk3_t, "spd", party.stats.spd),
+	GBA_DIFF_FIELD(pk3_t, "satk", party.stats.satk),
+	GBA_DIFF_FIELD(pk3_t, "sdef", party.stats.sdef)
+};
+
+#undef GBA_DIFF_FIELD
+
+static size_t gba_diff_pokedex(const gba_view_t *va, const gba_view_t *vb, save_diff_t *diff, save_diff_fn_t fn, void *user) {
+	static const char *const NAMES[] = { "seen", "owned" };
+	static const size_t OFFSETS[] = { GBA_POKEDEX_SEEN_A, GBA_POKEDEX_OWNED };
+	size_t found = 0;
+	for(size_t list = 0; list < 2; ++list) {
+		uint8_t a[GBA_POKEDEX_BYTES], b[GBA_POKEDEX_BYTES];
+		gba_view_read(va, OFFSETS[list], a, GBA_POKEDEX_BYTES);
+		gba_view_read(vb, OFFSETS[list], b, GBA_POKEDEX_BYTES);
+		diff->area = SAVE_DIFF_POKEDEX;
+		diff->group = list;
+		diff->field = NAMES[list];
+		diff->old_data = diff->new_data = NULL;
+		diff->size = 0;
+		for(size_t i = 0; i < GBA_POKEDEX_BYTES; ++i) {
+			for(uint8_t bits = a[i] ^ b[i]; bits; bits &= bits - 1) {
+				size_t bit = __builtin_ctz(bits);
+				if(i * 8 + bit >= GBA_POKEDEX_SIZE) {
+					break;
+				}
+				diff->index = i * 8 + bit;
+				diff->old_value = (a[i] >> bit) & 1;
+				diff->new_value = (b[i] >> bit) & 1;
+				fn(diff, user);
+				++found;
+			}
+		}
+	}
+	return found;
+}
+
+static size_t gba_diff_items(const gba_view_t *va, const gba_view_t *vb, size_t storage, save_diff_t *diff, save_diff_fn_t fn, void *user) {
+	gba_item_slot_t a[GBA_E_ITEM_COUNT], b[GBA_E_ITEM_COUNT];
+	size_t game = va->type - GBA_TYPE_RS;
+	size_t count = va->type == GBA_TYPE_E ? GBA_E_ITEM_COUNT : GBA_RS_ITEM_COUNT;
+	gba_view_read(va, storage + 8, a, count * sizeof(gba_item_slot_t));
+	gba_view_read(vb, storage + 8, b, count * sizeof(gba_item_slot_t));
+	//the PC pocket isn't encrypted, and ruby and sapphire have no key
+	for(size_t i = gba_pocket_sizes[game][GBA_ITEM_POCKET_PC]; i < count; ++i) {
+		a[i].amount ^= va->key.lower;
+		b[i].amount ^= vb->key.lower;
+	}
+	size_t found = 0;
+	diff->area = SAVE_DIFF_ITEM;
+	for(size_t pocket = 0; pocket < 6; ++pocket) {
+		size_t first = gba_pocket_offsets[game][pocket];
+		diff->group = pocket;
+		for(size_t i = 0; i < gba_pocket_sizes[game][pocket]; ++i) {
+			diff->index = i;
+			found += save_diff_fields(GBA_DIFF_ITEM, 2, diff, (uint8_t *)&a[first + i], (uint8_t *)&b[first + i], fn, user);
+		}
+	}
+	return found;
+}
+
+//compares a pokemon if its sections changed, party pokemon have size sizeof(pk3_t)
+static size_t gba_diff_pokemon(const gba_view_t *va, const gba_view_t *vb, uint16_t changed, size_t offset, size_t size, save_diff_t *diff, save_diff_fn_t fn, void *user) {
+	pk3_t a, b;
+	if(!(gba_view_sections(offset, size) & changed)) {
+		return 0;
+	}
+	gba_view_read(va, offset, &a, size);
+	gba_view_read(vb, offset, &b, size);
+	if(!memcmp(&a, &b, size)) {
+		return 0;
+	}
+	pk3_decrypt(&a.box);
+	pk3_decrypt(&b.box);
+	size_t found = save_diff_fields(GBA_DIFF_PK3, sizeof(GBA_DIFF_PK3) / sizeof(*GBA_DIFF_PK3), diff, (uint8_t *)&a, (uint8_t *)&b, fn, user);
+	if(size == sizeof(pk3_t)) {
+		found += save_diff_fields(GBA_DIFF_PK3_PARTY, sizeof(GBA_DIFF_PK3_PARTY) / sizeof(*GBA_DIFF_PK3_PARTY), diff, (uint8_t *)&a, (uint8_t *)&b, fn, user);
+	}
+	return found;
+}
+
+static size_t gba_diff_pc(const gba_view_t *va, const gba_view_t *vb, uint16_t changed, save_diff_t *diff, save_diff_fn_t fn, void *user) {
+	static const save_diff_field_t CURRENT = { "current_box", 0, 4 };
+	//the box name and wallpaper, read side by side so one table covers both
+	static const save_diff_field_t BOX[] = {
+		{ "box_name", 0, GBA_BOX_NAME_LENGTH },
+		{ "wallpaper", GBA_BOX_NAME_LENGTH, 1 }
+	};
+	size_t found = 0;
+	uint8_t a[GBA_BOX_NAME_LENGTH + 1], b[GBA_BOX_NAME_LENGTH + 1];
+	diff->area = SAVE_DIFF_PC;
+	diff->group = 0;
+	diff->index = 0;
+	gba_view_read(va, GBA_BOX_DATA_OFFSET, a, 4);
+	gba_view_read(vb, GBA_BOX_DATA_OFFSET, b, 4);
+	found += save_diff_fields(&CURRENT, 1, diff, a, b, fn, user);
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		diff->group = i;
+		for(size_t j = 0; j < GBA_POKEMON_IN_BOX; ++j) {
+			size_t offset = GBA_BOX_DATA_OFFSET + offsetof(gba_pc_t, box) + (i * GBA_POKEMON_IN_BOX + j) * sizeof(pk3_box_t);
+			diff->index = j;
+			found += gba_diff_pokemon(va, vb, changed, offset, sizeof(pk3_box_t), diff, fn, user);
+		}
+		size_t name = GBA_BOX_DATA_OFFSET + offsetof(gba_pc_t, name) + i * GBA_BOX_NAME_LENGTH;
+		size_t wallpaper = GBA_BOX_DATA_OFFSET + offsetof(gba_pc_t, wallpaper) + i;
+		gba_view_read(va, name, a, GBA_BOX_NAME_LENGTH);
+		gba_view_read(vb, name, b, GBA_BOX_NAME_LENGTH);
+		gba_view_read(va, wallpaper, a + GBA_BOX_NAME_LENGTH, 1);
+		gba_view_read(vb, wallpaper, b + GBA_BOX_NAME_LENGTH, 1);
+		diff->index = 0;
+		found += save_diff_fields(BOX, 2, diff, a, b, fn, user);
+	}
+	return found;
+}
+
+/**
+ * Sections are compared as by gba_diff_sections() and fields are only read from sections that
+ * differ. The money and item amounts are reported decrypted, and pokemon are decrypted one at a
+ * time on the stack, so neither file is unpacked.
+ * @brief Reports every difference between the main saves of two GBA files.
+ * @param a The old file, GBA_SAVE_SIZE bytes long.
+ * @param b The new file, GBA_SAVE_SIZE bytes long.
+ * @param fn Called with each difference, first the sections that differ and then the fields.
+ * @param user Passed to fn.
+ * @return The number of differences reported, or -1 if the files aren't both GBA saves of the
+ * same known game.
+ */
+int gba_diff(const uint8_t *a, const uint8_t *b, save_diff_fn_t fn, void *user) {
+	gba_view_t va, vb;
+	if(gba_view_init(&va, a) || gba_view_init(&vb, b) || va.type == GBA_TYPE_UNKNOWN || va.type != vb.type) {
+		return -1;
+	}
+	uint16_t changed = gba_view_compare(&va, &vb);
+	save_diff_t diff = { 0 };
+	size_t found = 0;
+	diff.area = SAVE_DIFF_SECTION;
+	diff.field = "checksum";
+	diff.size = 2;
+	for(uint16_t bits = changed; bits; bits &= bits - 1) {
+		size_t id = __builtin_ctz(bits);
+		diff.index = id;
+		diff.old_value = va.checksum[id];
+		diff.new_value = vb.checksum[id];
+		diff.old_data = (const uint8_t *)&va.checksum[id];
+		diff.new_data = (const uint8_t *)&vb.checksum[id];
+		fn(&diff, user);
+		++found;
+	}
+	if(!changed) {
+		return 0;
+	}
+	if(changed & 1) {
+		gba_trainer_t ta, tb;
+		gba_view_read(&va, 0, &ta, sizeof(ta));
+		gba_view_read(&vb, 0, &tb, sizeof(tb));
+		diff.area = SAVE_DIFF_TRAINER;
+		diff.group = diff.index = 0;
+		found += save_diff_fields(GBA_DIFF_TRAINER, sizeof(GBA_DIFF_TRAINER) / sizeof(*GBA_DIFF_TRAINER), &diff, (uint8_t *)&ta, (uint8_t *)&tb, fn, user);
+		//the seen list has copies in other sections, the one beside owned is the one read
+		found += gba_diff_pokedex(&va, &vb, &diff, fn, user);
+	}
+	size_t storage = va.type == GBA_TYPE_FRLG ? GBA_FRLG_STORAGE_OFFSET : GBA_RSE_STORAGE_OFFSET;
+	if(gba_view_sections(storage, 8 + GBA_E_ITEM_COUNT * sizeof(gba_item_slot_t)) & changed) {
+		static const save_diff_field_t MONEY = { "money", 0, 4 };
+		uint32_t ma, mb;
+		gba_view_read(&va, storage, &ma, 4);
+		gba_view_read(&vb, storage, &mb, 4);
+		ma ^= va.key.key;
+		mb ^= vb.key.key;
+		diff.area = SAVE_DIFF_MONEY;
+		diff.group = diff.index = 0;
+		found += save_diff_fields(&MONEY, 1, &diff, (uint8_t *)&ma, (uint8_t *)&mb, fn, user);
+		found += gba_diff_items(&va, &vb, storage, &diff, fn, user);
+	}
+	size_t team = va.type == GBA_TYPE_FRLG ? GBA_FRLG_TEAM_OFFSET : GBA_RSE_TEAM_OFFSET;
+	if(gba_view_sections(team, sizeof(gba_party_t)) & changed) {
+		static const save_diff_field_t SIZE = { "size", 0, 4 };
+		uint32_t sa, sb;
+		gba_view_read(&va, team, &sa, 4);
+		gba_view_read(&vb, team, &sb, 4);
+		diff.area = SAVE_DIFF_PARTY;
+		diff.group = diff.index = 0;
+		found += save_diff_fields(&SIZE, 1, &diff, (uint8_t *)&sa, (uint8_t *)&sb, fn, user);
+		for(size_t i = 0; i < POKEMON_IN_PARTY; ++i) {
+			diff.index = i;
+			found += gba_diff_pokemon(&va, &vb, changed, team + offsetof(gba_party_t, pokemon) + i * sizeof(pk3_t), sizeof(pk3_t), &diff, fn, user);
+		}
+	}
+	if(gba_view_sections(GBA_BOX_DATA_OFFSET, sizeof(gba_pc_t)) & changed) {
+		found += gba_diff_pc(&va, &vb, changed, &diff, fn, user);
+	}
+	return found;
+}
+
+//fills a record from a decrypted pokemon, the caller sets where it is
+static void gba_export_pokemon(save_export_record_t *record, pk3_box_t *pkm, uint32_t id) {
+	memset(record, 0, sizeof(*record));
+	record->save = id;
+	record->generation = 3;
+	record->pid = pkm->pid;
+	record->ot_id = pkm->ot_id;
+	record->ot_sid = pkm->ot_sid;
+	record->species = pkm->species;
+	record->held_item = pkm->held_item;
+	record->exp = pkm->exp;
+	record->friendship = pkm->friendship;
+	record->is_egg = pkm->is_egg;
+	record->checksum_ok = pkm->checksum == pk3_checksum((uint8_t *)pkm->block, sizeof(pkm->block));
+	for(size_t i = 0; i < 4; ++i) {
+		record->move[i] = pkm->move[i];
+	}
+	const uint8_t iv[6] = { pkm->iv.hp, pkm->iv.atk, pkm->iv.def, pkm->iv.spd, pkm->iv.satk, pkm->iv.sdef };
+	memcpy(record->iv, iv, sizeof(iv));
+	memcpy(record->ev, &pkm->ev, sizeof(record->ev));
+	gba_text_to_ucs2(record->nickname, pkm->nickname, PK3_NICKNAME_LENGTH);
+	gba_text_to_ucs2(record->ot_name, pkm->ot_name, PK3_OT_NAME_LENGTH);
+}
+
+/**
+ * Pokemon are decrypted one at a time on the stack, the save isn't changed.
+ * @brief Writes every party and PC pokemon of the save to an export.
+ * @param exporter The exporter.
+ * @param save The save.
+ * @param id The number written as the save of every record.
+ * @return The number of records written, or -1 if the game is unknown or writing failed.
+ */
+int gba_export(save_export_t *exporter, gba_save_t *save, uint32_t id) {
+	gba_party_t *party = gba_get_party(save);
+	if(!party) {
+		return -1;
+	}
+	save_export_record_t record;
+	int count = 0, failed = 0;
+	size_t size = party->size < POKEMON_IN_PARTY ? party->size : POKEMON_IN_PARTY;
+	for(size_t i = 0; i < size; ++i) {
+		pk3_t pkm = party->pokemon[i];
+		pk3_decrypt(&pkm.box);
+		gba_export_pokemon(&record, &pkm.box, id);
+		record.box = SAVE_EXPORT_PARTY;
+		record.slot = i;
+		record.level = pkm.party.level;
+		failed |= save_export_record(exporter, &record);
+		++count;
+	}
+	gba_pc_t *pc = gba_get_pc(save);
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		for(size_t j = 0; j < GBA_POKEMON_IN_BOX; ++j) {
+			if(!gba_pc_is_occupied(save, i, j)) {
+				continue;
+			}
+			pk3_box_t pkm = pc->box[i].pokemon[j];
+			pk3_decrypt(&pkm);
+			gba_export_pokemon(&record, &pkm, id);
+			record.box = i;
+			record.slot = j;
+			failed |= save_export_record(exporter, &record);
+			++count;
+		}
 	}
+	return failed ? -1 : count;
 }
@@ -6,6 +6,9 @@
 
 #include "types.h"
 #include "game_nds.h"
+#include "pc_sort.h"
+#include "stat.h"
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -346,8 +349,23 @@ typedef struct {
 typedef struct {
 	nds_block_data_t index;
 	nds_bptr_t block;
+	//one pc_bitmap word per box
+	uint32_t occupied[NDS_BOX_COUNT];
+	//NDS_DIRTY_* bits for the blocks changed since the save was read
+	uint8_t dirty;
+	//NULL unless nds_journal_start() was called
+	save_journal_t *journal;
 } nds_sdat_t;
 
+//a save and everything it holds, in one block
+typedef struct {
+	//how to free the block
+	save_allocator_t owner;
+	nds_save_t save;
+	nds_sdat_t sdat;
+	uint8_t data[NDS_ONESAVE_LENGTH];
+} nds_save_object_t;
+
 nds_savetype_t nds_detect_save_type(const uint8_t *ptr) {
 	if(*(uint32_t *)(ptr + NDS_TYPE_DETECT_DP) == NDS_DP_SMALL_BLOCK_LENGTH) {
 		return NDS_TYPE_DP;
@@ -385,11 +403,11 @@ nds_bdat_t nds_get_bdat(const uint8_t *ptr) {
 	return bdat;
 }
 
-nds_sdat_t *nds_get_sdat(const nds_save_t *save, const nds_bdat_t bdat) {
-	nds_sdat_t *sdat = malloc(sizeof(nds_sdat_t));
+static void nds_init_sdat(nds_sdat_t *sdat, const nds_save_t *save, const nds_bdat_t bdat) {
 	sdat->index = bdat.index;
 	sdat->block = nds_get_bptr(save->data, bdat.index);
-	return sdat;
+	sdat->dirty = 0;
+	sdat->journal = NULL;
 }
 
 nds_save_index_t nds_get_main_save_index(const nds_bdat_t bdat) {
@@ -422,37 +440,98 @@ nds_save_index_t nds_get_main_save_index(const nds_bdat_t bdat) {
 	return index;
 }
 
-nds_save_t *nds_read_save_internal(nds_bdat_t bdat, nds_save_index_t index) {
-	nds_save_t *save = malloc(sizeof(nds_save_t));
+/**
+ * @brief Gets the size of the block a save is read into by nds_read_main_save_in().
+ * @return The size in bytes.
+ */
+size_t nds_save_object_size(void) {
+	return sizeof(nds_save_object_t);
+}
+
+static nds_save_t *nds_read_save_internal(nds_bdat_t bdat, nds_save_index_t index, nds_save_object_t *object) {
+	nds_save_t *save = &object->save;
 	save->type = bdat.type;
-	save->data = malloc(NDS_ONESAVE_LENGTH);
-	memcpy(save->data, bdat.block[index.small].small, bdat.index.small_size);
-	memcpy(save->data + bdat.index.big_start, bdat.block[index.big].big, bdat.index.big_size);
-	save->internal = nds_get_sdat(save, bdat);
+	save->data = object->data;
+	const nds_block_data_t *layout = &bdat.index;
+	memcpy(save->data, bdat.block[index.small].small, layout->small_size);
+	memcpy(save->data + layout->big_start, bdat.block[index.big].big, layout->big_size);
+	//the bytes around the blocks aren't in the file, clear them so a reused block keeps nothing
+	//of the save read into it before
+	if(layout->small_size <= layout->big_start && layout->big_start + layout->big_size <= NDS_ONESAVE_LENGTH) {
+		memset(save->data + layout->small_size, 0, layout->big_start - layout->small_size);
+		memset(save->data + layout->big_start + layout->big_size, 0, NDS_ONESAVE_LENGTH - layout->big_start - layout->big_size);
+	}
+	nds_init_sdat(&object->sdat, save, bdat);
+	save->internal = &object->sdat;
+	nds_pc_refresh_occupancy(save);
 	return save;
 }
 
+static nds_save_object_t *nds_alloc_save(const save_allocator_t *allocator) {
+	save_allocator_t owner;
+	nds_save_object_t *object = save_alloc(&owner, allocator, sizeof(nds_save_object_t));
+	if(object) {
+		object->owner = owner;
+	}
+	return object;
+}
+
 nds_save_t *nds_read_main_save(const uint8_t *ptr) {
+	return nds_read_main_save_with(ptr, NULL);
+}
+
+/**
+ * @brief Reads the main save into memory from an allocator.
+ * @param ptr The save file.
+ * @param allocator The allocator, NULL for malloc(). nds_free_save() gives the memory back to it.
+ * @return The save, or NULL if out of memory.
+ */
+nds_save_t *nds_read_main_save_with(const uint8_t *ptr, const save_allocator_t *allocator) {
+	nds_save_object_t *object = nds_alloc_save(allocator);
+	if(!object) {
+		return NULL;
+	}
+	nds_bdat_t bdat = nds_get_bdat(ptr);
+	nds_save_index_t index = nds_get_main_save_index(bdat);
+	return nds_read_save_internal(bdat, index, object);
+}
+
+/**
+ * Nothing is allocated, the save lives in the block until it is reused.
+ * @brief Reads the main save into a block of the caller's.
+ * @param ptr The save file.
+ * @param block The block, nds_save_object_size() bytes aligned as malloc() would.
+ * @return The save.
+ */
+nds_save_t *nds_read_main_save_in(const uint8_t *ptr, void *block) {
+	nds_save_object_t *object = block;
+	object->owner = (save_allocator_t){ NULL, NULL, NULL };
 	nds_bdat_t bdat = nds_get_bdat(ptr);
 	nds_save_index_t index = nds_get_main_save_index(bdat);
-	return nds_read_save_internal(bdat, index);
+	return nds_read_save_internal(bdat, index, object);
 }
 
 nds_save_t *nds_read_backup_save(const uint8_t *ptr) {
+	nds_save_object_t *object = nds_alloc_save(NULL);
+	if(!object) {
+		return NULL;
+	}
 	nds_bdat_t bdat = nds_get_bdat(ptr);
 	nds_save_index_t index = nds_get_main_save_index(bdat);
 	index.small ^= 1;
 	index.big ^= 1;
-	return nds_read_save_internal(bdat, index);
+	return nds_read_save_internal(bdat, index, object);
 }
 
+/**
+ * @brief Frees a save, a save read into a block of the caller's only has its journal freed.
+ * @param save The save.
+ */
 void nds_free_save(nds_save_t *save) {
-	free(save->internal);
-	free(save->data);
-	free(save);
-	save->internal = NULL;
-	save->data = NULL;
-	save = NULL;
+	nds_journal_stop(save);
+	nds_save_object_t *object = (nds_save_object_t *)((uint8_t *)save - offsetof(nds_save_object_t, save));
+	save_allocator_t owner = object->owner;
+	save_alloc_free(&owner, object, sizeof(nds_save_object_t));
 }
 
 /**
@@ -525,3 +604,566 @@ nds_box_t *nds_get_box(nds_save_t *save, size_t index) {
 	nds_sdat_t *sdat = save->internal;
 	return (nds_box_t *)(sdat->block.big + nds_box_offset(save->type, index));
 }
+
+static uint8_t nds_pc_slot_used(const pkm_box_t *slot) {
+	//empty slots are zero filled, which doesn't decrypt to zeros, so check for that first
+	if(slot->header.pid == 0 && slot->header.checksum == 0) {
+		return 0;
+	}
+	//the species is encrypted, so look at a decrypted copy
+	pkm_box_t pkm = *slot;
+	pkm_decrypt(&pkm);
+	return pkm.species != 0;
+}
+
+/**
+ * The bitmap is built when the save is read. Call this after changing PC slots without going
+ * through nds_pc_set_occupied(), nds_pc_reserve() or nds_pc_compact().
+ * @brief Rebuilds the PC occupancy bitmap from the PC data.
+ * @param save The save to update.
+ */
+void nds_pc_refresh_occupancy(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+		nds_box_t *box = nds_get_box(save, i);
+		uint32_t word = 0;
+		for(size_t j = 0; j < NDS_POKEMON_IN_BOX; ++j) {
+			word |= (uint32_t)nds_pc_slot_used(&box->pokemon[j]) << j;
+		}
+		sdat->occupied[i] = word;
+	}
+}
+
+/**
+ * @brief Checks the occupancy bitmap for a PC slot.
+ * @param save The save to check.
+ * @param box The box number.
+ * @param slot The slot within the box.
+ * @return Non-zero if the slot holds a pokemon.
+ */
+uint8_t nds_pc_is_occupied(nds_save_t *save, size_t box, size_t slot) {
+	nds_sdat_t *sdat = save->internal;
+	if(box >= NDS_BOX_COUNT || slot >= NDS_POKEMON_IN_BOX) {
+		return 0;
+	}
+	return (sdat->occupied[box] >> slot) & 1;
+}
+
+/**
+ * @brief Marks a PC slot as filled or emptied in the occupancy bitmap.
+ * @param save The save to update.
+ * @param box The box number.
+ * @param slot The slot within the box.
+ * @param occupied Non-zero if the slot now holds a pokemon.
+ */
+void nds_pc_set_occupied(nds_save_t *save, size_t box, size_t slot, uint8_t occupied) {
+	nds_sdat_t *sdat = save->internal;
+	if(box >= NDS_BOX_COUNT || slot >= NDS_POKEMON_IN_BOX) {
+		return;
+	}
+	if(occupied) {
+		sdat->occupied[box] |= 1u << slot;
+	} else {
+		sdat->occupied[box] &= ~(1u << slot);
+	}
+}
+
+/**
+ * @brief Finds and reserves free PC slots, see pc_bitmap_reserve().
+ * @param save The save to reserve slots in.
+ * @param fill The order to hand out slots in. The current box isn't known for these games yet,
+ * so PC_FILL_CURRENT starts from the first box.
+ * @param count The number of slots wanted.
+ * @param slots Array that receives count slot numbers, each box * NDS_POKEMON_IN_BOX + slot.
+ * @return The number of slots reserved, less than count if the PC is full.
+ */
+size_t nds_pc_reserve(nds_save_t *save, pc_fill_t fill, size_t count, uint16_t *slots) {
+	nds_sdat_t *sdat = save->internal;
+	return pc_bitmap_reserve(sdat->occupied, NDS_BOX_COUNT, 0, fill, count, slots);
+}
+
+/**
+ * Pokemon keep their order and records are moved as they are, still encrypted.
+ * @brief Moves every PC pokemon to the front of the PC, leaving the free slots at the end.
+ * @param save The save to compact.
+ * @return The number of pokemon in the PC.
+ */
+size_t nds_pc_compact(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	size_t count = 0;
+	for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+		nds_box_t *box = nds_get_box(save, i);
+		for(uint32_t word = sdat->occupied[i] & PC_BITMAP_FULL; word; word &= word - 1) {
+			pkm_box_t *from = &box->pokemon[__builtin_ctz(word)];
+			pkm_box_t *to = &nds_get_box(save, count / NDS_POKEMON_IN_BOX)->pokemon[count % NDS_POKEMON_IN_BOX];
+			if(from != to) {
+				nds_journal_record(save, to, sizeof(pkm_box_t));
+				nds_journal_record(save, from, sizeof(pkm_box_t));
+				*to = *from;
+				memset(from, 0, sizeof(pkm_box_t));
+				sdat->dirty |= NDS_DIRTY_BIG;
+			}
+			++count;
+		}
+	}
+	for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+		size_t full = count > i * NDS_POKEMON_IN_BOX ? count - i * NDS_POKEMON_IN_BOX : 0;
+		sdat->occupied[i] = full >= NDS_POKEMON_IN_BOX ? PC_BITMAP_FULL : (1u << full) - 1;
+	}
+	return count;
+}
+
+/**
+ * @brief Gets the blocks changed by the library since the save was read.
+ * @param save The save to check.
+ * @return NDS_DIRTY_SMALL and NDS_DIRTY_BIG bits.
+ */
+uint8_t nds_get_dirty(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	return sdat->dirty;
+}
+
+/**
+ * Once started, the library's editing functions record what they change. Changes made through
+ * the pointers it hands out, such as nds_get_party(), must be recorded with nds_journal_record().
+ * @brief Starts keeping an undo journal for the save.
+ * @param save The save to keep a journal for.
+ * @return 0 on success, -1 if out of memory.
+ */
+int nds_journal_start(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	if(!sdat->journal) {
+		sdat->journal = save_journal_create();
+	}
+	return sdat->journal ? 0 : -1;
+}
+
+/**
+ * @brief Stops keeping an undo journal for the save, forgetting its steps.
+ * @param save The save.
+ */
+void nds_journal_stop(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	if(sdat->journal) {
+		save_journal_free(sdat->journal);
+		sdat->journal = NULL;
+	}
+}
+
+/**
+ * @brief Gets the undo journal of the save, for save_journal_steps() and save_journal_memory().
+ * @param save The save.
+ * @return The journal, or NULL if nds_journal_start() wasn't called.
+ */
+save_journal_t *nds_get_journal(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	return sdat->journal;
+}
+
+/**
+ * Does nothing unless the save has a journal.
+ * @brief Records part of the save data that is about to change, so the change can be undone.
+ * @param save The save that is about to change.
+ * @param ptr Pointer to the bytes that may change, inside save->data.
+ * @param size The number of bytes that may change.
+ */
+void nds_journal_record(nds_save_t *save, const void *ptr, size_t size) {
+	nds_sdat_t *sdat = save->internal;
+	size_t offset = (const uint8_t *)ptr - save->data;
+	if(!sdat->journal || offset >= NDS_ONESAVE_LENGTH) {
+		return;
+	}
+	if(size > NDS_ONESAVE_LENGTH - offset) {
+		size = NDS_ONESAVE_LENGTH - offset;
+	}
+	save_journal_record(sdat->journal, save->data, offset, size);
+}
+
+/**
+ * @brief Ends the current undo step of the save.
+ * @param save The save.
+ * @return 0 on success, -1 if the save has no journal or it ran out of memory.
+ */
+int nds_journal_checkpoint(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	if(!sdat->journal) {
+		return -1;
+	}
+	return save_journal_checkpoint(sdat->journal, save->data);
+}
+
+static void nds_journal_dirty(size_t offset, size_t size, void *user) {
+	nds_sdat_t *sdat = user;
+	sdat->dirty |= offset + size > sdat->index.big_start ? NDS_DIRTY_BIG : 0;
+	sdat->dirty |= offset < sdat->index.small_size ? NDS_DIRTY_SMALL : 0;
+}
+
+/**
+ * @brief Undoes the last step of changes to the save.
+ * @param save The save.
+ * @return 0 on success, -1 if there is nothing to undo.
+ */
+int nds_journal_undo(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	if(!sdat->journal || save_journal_undo(sdat->journal, save->data, nds_journal_dirty, sdat)) {
+		return -1;
+	}
+	nds_pc_refresh_occupancy(save);
+	return 0;
+}
+
+/**
+ * @brief Redoes the last step of changes undone.
+ * @param save The save.
+ * @return 0 on success, -1 if there is nothing to redo.
+ */
+int nds_journal_redo(nds_save_t *save) {
+	nds_sdat_t *sdat = save->internal;
+	if(!sdat->journal || save_journal_redo(sdat->journal, save->data, nds_journal_dirty, sdat)) {
+		return -1;
+	}
+	nds_pc_refresh_occupancy(save);
+	return 0;
+}
+
+/**
+ * Every occupied slot is decrypted once to read its key, then the records are moved still
+ * encrypted, each at most once, see pc_sort_apply().
+ * @brief Sorts the PC, packing the pokemon into the first slots.
+ * @param save The save to sort.
+ * @param key The value to sort by.
+ * @param descending Non-zero to put the largest value first.
+ * @param top If not 0, only the top pokemon are sorted to the front of the PC and the rest
+ * follow in their old order.
+ * @param growth_rates stat_growth_rate_t for each species id, for PC_SORT_LEVEL. If NULL,
+ * PC_SORT_LEVEL sorts by experience instead.
+ * @param growth_count The number of entries in growth_rates. Pokemon with a species id past
+ * the end sort as level 0.
+ * @return The number of slots written.
+ */
+size_t nds_pc_sort(nds_save_t *save, pc_sort_key_t key, uint8_t descending, size_t top, const uint8_t *growth_rates, size_t growth_count) {
+	enum { TOTAL = NDS_BOX_COUNT * NDS_POKEMON_IN_BOX };
+	nds_sdat_t *sdat = save->internal;
+	void *slots[TOTAL];
+	uint16_t used[TOTAL];
+	uint32_t keys[TOTAL];
+	uint16_t from[TOTAL];
+	size_t count = 0;
+	for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+		nds_box_t *box = nds_get_box(save, i);
+		for(size_t j = 0; j < NDS_POKEMON_IN_BOX; ++j) {
+			slots[i * NDS_POKEMON_IN_BOX + j] = &box->pokemon[j];
+		}
+		for(uint32_t word = sdat->occupied[i] & PC_BITMAP_FULL; word; word &= word - 1) {
+			size_t slot = __builtin_ctz(word);
+			pkm_box_t pkm = box->pokemon[slot];
+			pkm_decrypt(&pkm);
+			uint32_t value = 0;
+			switch(key) {
+				case PC_SORT_SPECIES:
+					value = pkm.species;
+					break;
+				case PC_SORT_LEVEL:
+					if(!growth_rates) {
+						value = pkm.exp;
+					} else if(pkm.species < growth_count) {
+						value = stat_get_level(growth_rates[pkm.species], pkm.exp);
+					}
+					break;
+				case PC_SORT_IV_TOTAL:
+					value = pkm.iv.hp + pkm.iv.atk + pkm.iv.def + pkm.iv.spd + pkm.iv.satk + pkm.iv.sdef;
+					break;
+				case PC_SORT_EXP:
+					value = pkm.exp;
+					break;
+				case PC_SORT_HELD_ITEM:
+					value = pkm.held_item;
+					break;
+			}
+			used[count] = i * NDS_POKEMON_IN_BOX + slot;
+			keys[count] = value;
+			++count;
+		}
+	}
+	//the journal keeps only the bytes that end up changed
+	uint8_t *first = (uint8_t *)nds_get_box(save, 0);
+	nds_journal_record(save, first, (uint8_t *)(nds_get_box(save, NDS_BOX_COUNT - 1) + 1) - first);
+	size_t moved = pc_sort_slots(slots, sizeof(pkm_box_t), TOTAL, used, keys, count, descending, top, from);
+	if(!moved) {
+		return 0;
+	}
+	for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+		size_t full = count > i * NDS_POKEMON_IN_BOX ? count - i * NDS_POKEMON_IN_BOX : 0;
+		sdat->occupied[i] = full >= NDS_POKEMON_IN_BOX ? PC_BITMAP_FULL : (1u << full) - 1;
+	}
+	sdat->dirty |= NDS_DIRTY_BIG;
+	return moved;
+}
+
+static uint16_t nds_footer_checksum(nds_savetype_t type, const nds_footer_t *footer) {
+	return type == NDS_TYPE_HGSS ? footer->hgss.checksum : footer->dppt.checksum;
+}
+
+//the main small and big blocks of a file, read in place
+static int nds_diff_blocks_of(const uint8_t *ptr, nds_savetype_t *type, nds_block_data_t *index, const uint8_t **small, const uint8_t **big, uint16_t checksum[2]) {
+	nds_bdat_t bdat = nds_get_bdat(ptr);
+	if(bdat.type == NDS_TYPE_UNKNOWN) {
+		return -1;
+	}
+	nds_save_index_t main = nds_get_main_save_index(bdat);
+	*type = bdat.type;
+	*index = bdat.index;
+	*small = bdat.block[main.small].small;
+	*big = bdat.block[main.big].big;
+	checksum[0] = nds_footer_checksum(bdat.type, bdat.block[main.small].small_footer);
+	checksum[1] = nds_footer_checksum(bdat.type, bdat.block[main.big].big_footer);
+	return 0;
+}
+
+static uint8_t nds_diff_compare(const nds_block_data_t *index, const uint8_t *small[2], const uint8_t *big[2], const uint16_t checksum[2][2]) {
+	uint8_t changed = 0;
+	//equal checksums are only a hint, the bytes have the final say
+	if(checksum[0][0] != checksum[1][0] || memcmp(small[0], small[1], index->small_size)) {
+		changed |= NDS_DIRTY_SMALL;
+	}
+	if(checksum[0][1] != checksum[1][1] || memcmp(big[0], big[1], index->big_size)) {
+		changed |= NDS_DIRTY_BIG;
+	}
+	return changed;
+}
+
+/**
+ * The checksum in each block's footer is compared first, and the block data only if the
+ * checksums are the same.
+ * @brief Finds the blocks that differ between the main saves of two files.
+ * @param a The old file, NDS_SAVE_SIZE bytes long.
+ * @param b The new file, NDS_SAVE_SIZE bytes long.
+ * @return NDS_DIRTY_SMALL and NDS_DIRTY_BIG bits for the blocks that differ, both if the files
+ * aren't saves of the same game.
+ */
+uint8_t nds_diff_blocks(const uint8_t *a, const uint8_t *b) {
+	nds_savetype_t type[2];
+	nds_block_data_t index[2];
+	const uint8_t *small[2], *big[2];
+	uint16_t checksum[2][2];
+	if(nds_diff_blocks_of(a, &type[0], &index[0], &small[0], &big[0], checksum[0])
+			|| nds_diff_blocks_of(b, &type[1], &index[1], &small[1], &big[1], checksum[1])
+			|| type[0] != type[1]) {
+		return NDS_DIRTY_SMALL | NDS_DIRTY_BIG;
+	}
+	return nds_diff_compare(&index[0], small, big, checksum);
+}
+
+#define NDS_DIFF_FIELD(type, name, member) { name, offsetof(type, member), sizeof(((type *)0)->member) }
+
+//fields of a decrypted pkm_box_t, the checksum is left out as it follows the data
+static const save_diff_field_t NDS_DIFF_PKM[] = {
+	NDS_DIFF_FIELD(pkm_box_t, "pid", header.pid),
+	NDS_DIFF_FIELD(pkm_box_t, "flags", header.padding),
+	NDS_DIFF_FIELD(pkm_box_t, "species", species),
+	NDS_DIFF_FIELD(pkm_box_t, "held_item", held_item),
+	NDS_DIFF_FIELD(pkm_box_t, "ot_id", ot_id),
+	NDS_DIFF_FIELD(pkm_box_t, "ot_sid", ot_sid),
+	NDS_DIFF_FIELD(pkm_box_t, "exp", exp),
+	NDS_DIFF_FIELD(pkm_box_t, "friendship", friendship),
+	NDS_DIFF_FIELD(pkm_box_t, "ability", ability),
+	NDS_DIFF_FIELD(pkm_box_t, "markings", markings),
+	NDS_DIFF_FIELD(pkm_box_t, "country", country),
+	NDS_DIFF_FIELD(pkm_box_t, "ev", ev),
+	NDS_DIFF_FIELD(pkm_box_t, "contest", contest),
+	NDS_DIFF_FIELD(pkm_box_t, "moves", move),
+	NDS_DIFF_FIELD(pkm_box_t, "move_pp", move_pp),
+	NDS_DIFF_FIELD(pkm_box_t, "move_pp_up", move_pp_up),
+	{ "iv", offsetof(pkm_box_t, ribbon_hoenn1) - 4, 4 },
+	//fateful encounter, gender and forme share a byte, then the leaf crown or nature byte
+	{ "forme", offsetof(pkm_box_t, egg_loc_plat) - 4, 1 },
+	{ "nature", offsetof(pkm_box_t, egg_loc_plat) - 3, 1 },
+	NDS_DIFF_FIELD(pkm_box_t, "egg_loc_plat", egg_loc_plat),
+	NDS_DIFF_FIELD(pkm_box_t, "met_loc_plat", met_loc_plat),
+	NDS_DIFF_FIELD(pkm_box_t, "nickname", nickname),
+	NDS_DIFF_FIELD(pkm_box_t, "hometown", hometown),
+	NDS_DIFF_FIELD(pkm_box_t, "ot_name", ot_name),
+	NDS_DIFF_FIELD(pkm_box_t, "egg_met_date", egg_met_date),
+	NDS_DIFF_FIELD(pkm_box_t, "met_date", met_date),
+	NDS_DIFF_FIELD(pkm_box_t, "egg_loc_dp", egg_loc_dp),
+	NDS_DIFF_FIELD(pkm_box_t, "met_loc_dp", met_loc_dp),
+	NDS_DIFF_FIELD(pkm_box_t, "pokerus", pokerus),
+	NDS_DIFF_FIELD(pkm_box_t, "pokeball", pokeball),
+	//level met and OT gender
+	{ "origins", offsetof(pkm_box_t, pokeball) + 1, 1 },
+	NDS_DIFF_FIELD(pkm_box_t, "encounter_type", encounter_type),
+	NDS_DIFF_FIELD(pkm_box_t, "pokeball_hgss", pokeball_hgss)
+};
+
+static const save_diff_field_t NDS_DIFF_PKM_PARTY[] = {
+	{ "status", offsetof(pkm_nds_t, party), 1 },
+	NDS_DIFF_FIELD(pkm_nds_t, "level", party.level),
+	NDS_DIFF_FIELD(pkm_nds_t, "capsule", party.capsule),
+	NDS_DIFF_FIELD(pkm_nds_t, "hp", party.hp),
+	NDS_DIFF_FIELD(pkm_nds_t, "max_hp", party.maxhp),
+	NDS_DIFF_FIELD(pkm_nds_t, "atk", party.atk),
+	NDS_DIFF_FIELD(pkm_nds_t, "def", party.def),
+	NDS_DIFF_FIELD(pkm_nds_t, "spd", party.spd),
+	NDS_DIFF_FIELD(pkm_nds_t, "satk", party.satk),
+	NDS_DIFF_FIELD(pkm_nds_t, "sdef", party.sdef)
+};
+
+#undef NDS_DIFF_FIELD
+
+//compares a pokemon stored at a and b, party pokemon have size sizeof(pkm_nds_t)
+static size_t nds_diff_pokemon(const uint8_t *a, const uint8_t *b, size_t size, save_diff_t *diff, save_diff_fn_t fn, void *user) {
+	pkm_nds_t pa, pb;
+	if(!memcmp(a, b, size)) {
+		return 0;
+	}
+	memcpy(&pa, a, size);
+	memcpy(&pb, b, size);
+	if(size == sizeof(pkm_nds_t)) {
+		//the party data has its own encryption, keyed on the pid
+		pkm_crypt_nds_party(&pa);
+		pkm_crypt_nds_party(&pb);
+	}
+	pkm_decrypt(&pa.box);
+	pkm_decrypt(&pb.box);
+	size_t found = save_diff_fields(NDS_DIFF_PKM, sizeof(NDS_DIFF_PKM) / sizeof(*NDS_DIFF_PKM), diff, (uint8_t *)&pa, (uint8_t *)&pb, fn, user);
+	if(size == sizeof(pkm_nds_t)) {
+		found += save_diff_fields(NDS_DIFF_PKM_PARTY, sizeof(NDS_DIFF_PKM_PARTY) / sizeof(*NDS_DIFF_PKM_PARTY), diff, (uint8_t *)&pa, (uint8_t *)&pb, fn, user);
+	}
+	return found;
+}
+
+/**
+ * Blocks are compared as by nds_diff_blocks(). The library doesn't know where the trainer,
+ * money, items or pokedex are kept in these games yet, so only the party and PC pokemon are
+ * compared field by field, each decrypted on the stack.
+ * @brief Reports every difference between the main saves of two NDS files.
+ * @param a The old file, NDS_SAVE_SIZE bytes long.
+ * @param b The new file, NDS_SAVE_SIZE bytes long.
+ * @param fn Called with each difference, first the blocks that differ (index 0 for the small
+ * block, 1 for the big block) and then the fields.
+ * @param user Passed to fn.
+ * @return The number of differences reported, or -1 if the files aren't saves of the same game.
+ */
+int nds_diff(const uint8_t *a, const uint8_t *b, save_diff_fn_t fn, void *user) {
+	nds_savetype_t type[2];
+	nds_block_data_t index[2];
+	const uint8_t *small[2], *big[2];
+	uint16_t checksum[2][2];
+	if(nds_diff_blocks_of(a, &type[0], &index[0], &small[0], &big[0], checksum[0])
+			|| nds_diff_blocks_of(b, &type[1], &index[1], &small[1], &big[1], checksum[1])
+			|| type[0] != type[1]) {
+		return -1;
+	}
+	uint8_t changed = nds_diff_compare(&index[0], small, big, checksum);
+	save_diff_t diff = { 0 };
+	size_t found = 0;
+	diff.area = SAVE_DIFF_SECTION;
+	diff.field = "checksum";
+	diff.size = 2;
+	for(size_t i = 0; i < 2; ++i) {
+		if(changed & (i ? NDS_DIRTY_BIG : NDS_DIRTY_SMALL)) {
+			diff.index = i;
+			diff.old_value = checksum[0][i];
+			diff.new_value = checksum[1][i];
+			diff.old_data = (const uint8_t *)&checksum[0][i];
+			diff.new_data = (const uint8_t *)&checksum[1][i];
+			fn(&diff, user);
+			++found;
+		}
+	}
+	if(changed & NDS_DIRTY_SMALL) {
+		static const save_diff_field_t SIZE = { "size", 0, 4 };
+		size_t start = type[0] == NDS_TYPE_PLAT ? NDS_PLAT_PARTY_START : NDS_DP_HGSS_PARTY_START;
+		const uint8_t *pa = small[0] + start, *pb = small[1] + start;
+		diff.area = SAVE_DIFF_PARTY;
+		diff.group = diff.index = 0;
+		found += save_diff_fields(&SIZE, 1, &diff, pa, pb, fn, user);
+		for(size_t i = 0; i < POKEMON_IN_PARTY; ++i) {
+			size_t offset = offsetof(nds_party_t, pokemon) + i * sizeof(pkm_nds_t);
+			diff.index = i;
+			found += nds_diff_pokemon(pa + offset, pb + offset, sizeof(pkm_nds_t), &diff, fn, user);
+		}
+	}
+	if(changed & NDS_DIRTY_BIG) {
+		diff.area = SAVE_DIFF_PC;
+		for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+			size_t offset = nds_box_offset(type[0], i);
+			diff.group = i;
+			for(size_t j = 0; j < NDS_POKEMON_IN_BOX; ++j) {
+				size_t slot = offset + j * sizeof(pkm_box_t);
+				diff.index = j;
+				found += nds_diff_pokemon(big[0] + slot, big[1] + slot, sizeof(pkm_box_t), &diff, fn, user);
+			}
+		}
+	}
+	return found;
+}
+
+//fills a record from a decrypted pokemon, the caller sets where it is
+static void nds_export_pokemon(save_export_record_t *record, pkm_box_t *pkm, uint32_t id) {
+	memset(record, 0, sizeof(*record));
+	record->save = id;
+	record->generation = 4;
+	record->pid = pkm->header.pid;
+	record->ot_id = pkm->ot_id;
+	record->ot_sid = pkm->ot_sid;
+	record->species = pkm->species;
+	record->held_item = pkm->held_item;
+	record->exp = pkm->exp;
+	record->friendship = pkm->friendship;
+	record->is_egg = pkm->is_egg;
+	record->checksum_ok = pkm->header.checksum == pkm_checksum((uint8_t *)pkm->block, sizeof(pkm->block));
+	for(size_t i = 0; i < 4; ++i) {
+		record->move[i] = pkm->move[i];
+	}
+	const uint8_t iv[6] = { pkm->iv.hp, pkm->iv.atk, pkm->iv.def, pkm->iv.spd, pkm->iv.satk, pkm->iv.sdef };
+	memcpy(record->iv, iv, sizeof(iv));
+	memcpy(record->ev, &pkm->ev, sizeof(record->ev));
+	nds_text_to_ucs2(record->nickname, pkm->nickname, PKM_NICKNAME_LENGTH);
+	nds_text_to_ucs2(record->ot_name, pkm->ot_name, PKM_OT_NAME_LENGTH);
+}
+
+/**
+ * Pokemon are decrypted one at a time on the stack, the save isn't changed.
+ * @brief Writes every party and PC pokemon of the save to an export.
+ * @param exporter The exporter.
+ * @param save The save.
+ * @param id The number written as the save of every record.
+ * @return The number of records written, or -1 if the game is unknown or writing failed.
+ */
+int nds_export(save_export_t *exporter, nds_save_t *save, uint32_t id) {
+	nds_party_t *party = nds_get_party(save);
+	if(!party) {
+		return -1;
+	}
+	save_export_record_t record;
+	int count = 0, failed = 0;
+	size_t size = party->size < POKEMON_IN_PARTY ? party->size : POKEMON_IN_PARTY;
+	for(size_t i = 0; i < size; ++i) {
+		pkm_nds_t pkm = party->pokemon[i];
+		pkm_crypt_nds_party(&pkm);
+		pkm_decrypt(&pkm.box);
+		nds_export_pokemon(&record, &pkm.box, id);
+		record.box = SAVE_EXPORT_PARTY;
+		record.slot = i;
+		record.level = pkm.party.level;
+		failed |= save_export_record(exporter, &record);
+		++count;
+	}
+	for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+		nds_box_t *box = nds_get_box(save, i);
+		for(size_t j = 0; j < NDS_POKEMON_IN_BOX; ++j) {
+			if(!nds_pc_is_occupied(save, i, j)) {
+				continue;
+			}
+			pkm_box_t pkm = box->pokemon[j];
+			pkm_decrypt(&pkm);
+			nds_export_pokemon(&record, &pkm, id);
+			record.box = i;
+			record.slot = j;
+			failed |= save_export_record(exporter, &record);
+			++count;
+		}
+	}
+	return failed ? -1 : count;
+}
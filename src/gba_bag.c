@@ -0,0 +1,188 @@
+//Item id to slot index of the GBA bag
+
+#include "types.h"
+#include "game_gba.h"
+#include "gba_bag.h"
+#include <string.h>
+
+static inline uint8_t gba_bag_slot_used(const gba_item_slot_t *slot) {
+	return slot->index && slot->amount;
+}
+
+//find an item by looking at every used slot, for ids past the map
+static int gba_bag_scan(const gba_bag_t *bag, size_t pocket, uint16_t item) {
+	for(uint64_t used = bag->used[pocket]; used; used &= used - 1) {
+		size_t slot = __builtin_ctzll(used);
+		if(bag->slots[pocket][slot].index == item) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+static int gba_bag_lookup(const gba_bag_t *bag, size_t pocket, uint16_t item) {
+	if(item < GBA_BAG_ITEM_MAX) {
+		return (int)bag->where[pocket][item] - 1;
+	}
+	return gba_bag_scan(bag, pocket, item);
+}
+
+//point the map at the first used slot holding the item, if any
+static void gba_bag_remap(gba_bag_t *bag, size_t pocket, uint16_t item) {
+	if(item < GBA_BAG_ITEM_MAX) {
+		bag->where[pocket][item] = gba_bag_scan(bag, pocket, item) + 1;
+	}
+}
+
+/**
+ * Items are left exactly where they are, this only reads the pockets.
+ * @brief Builds the item index of a save.
+ * @param bag The index to fill.
+ * @param save The save to index.
+ * @return 0 on success, -1 if the save type is unknown.
+ */
+int gba_bag_build(gba_bag_t *bag, gba_save_t *save) {
+	if(save->type == GBA_TYPE_UNKNOWN) {
+		return -1;
+	}
+	memset(bag, 0, sizeof(*bag));
+	bag->save = save;
+	for(size_t i = 0; i < GBA_BAG_POCKETS; ++i) {
+		bag->slots[i] = gba_get_pocket_item(save, (gba_item_pocket_t)i, 0);
+		bag->size[i] = gba_get_pocket_size(save, (gba_item_pocket_t)i);
+		//walk backwards so the first slot holding an item wins
+		for(size_t j = bag->size[i]; j-- > 0;) {
+			gba_item_slot_t *slot = &bag->slots[i][j];
+			if(!gba_bag_slot_used(slot)) {
+				continue;
+			}
+			bag->used[i] |= (uint64_t)1 << j;
+			if(slot->index < GBA_BAG_ITEM_MAX) {
+				bag->where[i][slot->index] = j + 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Finds the slot holding an item.
+ * @param bag The bag to search.
+ * @param pocket The pocket to look in.
+ * @param item The item id.
+ * @return The slot, or NULL if the pocket doesn't have the item.
+ */
+gba_item_slot_t *gba_bag_find(const gba_bag_t *bag, gba_item_pocket_t pocket, uint16_t item) {
+	if((size_t)pocket >= GBA_BAG_POCKETS || !item) {
+		return NULL;
+	}
+	int slot = gba_bag_lookup(bag, pocket, item);
+	return slot < 0 ? NULL : &bag->slots[pocket][slot];
+}
+
+static void gba_bag_empty(gba_bag_t *bag, size_t pocket, size_t slot) {
+	uint16_t item = bag->slots[pocket][slot].index;
+	bag->slots[pocket][slot].index = 0;
+	bag->slots[pocket][slot].amount = 0;
+	bag->used[pocket] &= ~((uint64_t)1 << slot);
+	gba_bag_remap(bag, pocket, item);
+}
+
+/**
+ * Quantities are kept decoded in memory and encoded again when the save is written, so the
+ * changes are plain stores. Only the sections holding changed slots are marked dirty. Amounts
+ * are capped at 999 in the PC and 99 in the other pockets, as in the games.
+ * @brief Adds, removes and sets items, in order.
+ * @param bag The bag to change.
+ * @param changes The changes to make.
+ * @param count The number of changes.
+ * @return The number of changes made. A change is skipped if its pocket is full, it removes
+ * an item the pocket doesn't have, or its pocket or item is invalid.
+ */
+size_t gba_bag_apply(gba_bag_t *bag, const gba_bag_change_t *changes, size_t count) {
+	size_t done = 0;
+	for(size_t i = 0; i < count; ++i) {
+		const gba_bag_change_t *change = &changes[i];
+		size_t pocket = change->pocket;
+		if(pocket >= GBA_BAG_POCKETS || !change->item) {
+			continue;
+		}
+		int slot = gba_bag_lookup(bag, pocket, change->item);
+		uint32_t amount = slot < 0 ? 0 : bag->slots[pocket][slot].amount;
+		if(change->op == GBA_BAG_ADD) {
+			amount += change->amount;
+		} else if(change->op == GBA_BAG_REMOVE) {
+			if(slot < 0) {
+				continue;
+			}
+			amount = amount > change->amount ? amount - change->amount : 0;
+		} else {
+			amount = change->amount;
+		}
+		uint32_t max = pocket == GBA_ITEM_POCKET_PC ? GBA_BAG_PC_AMOUNT_MAX : GBA_BAG_AMOUNT_MAX;
+		if(amount > max) {
+			amount = max;
+		}
+		if(slot < 0) {
+			if(!amount) {
+				++done;
+				continue;
+			}
+			uint64_t all = bag->size[pocket] >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << bag->size[pocket]) - 1;
+			uint64_t free = ~bag->used[pocket] & all;
+			if(!free) {
+				continue;
+			}
+			slot = __builtin_ctzll(free);
+			gba_journal_record(bag->save, &bag->slots[pocket][slot], sizeof(gba_item_slot_t));
+			bag->slots[pocket][slot].index = change->item;
+			bag->used[pocket] |= (uint64_t)1 << slot;
+			if(change->item < GBA_BAG_ITEM_MAX) {
+				bag->where[pocket][change->item] = slot + 1;
+			}
+		}
+		gba_journal_record(bag->save, &bag->slots[pocket][slot], sizeof(gba_item_slot_t));
+		if(amount) {
+			bag->slots[pocket][slot].amount = amount;
+		} else {
+			gba_bag_empty(bag, pocket, slot);
+		}
+		gba_mark_dirty(bag->save, &bag->slots[pocket][slot], sizeof(gba_item_slot_t));
+		++done;
+	}
+	return done;
+}
+
+/**
+ * Items keep their order within each pocket.
+ * @brief Moves the items of every pocket to its first slots, leaving the empty slots at the end.
+ * @param bag The bag to compact.
+ * @return The number of slots in use, over all pockets.
+ */
+size_t gba_bag_compact(gba_bag_t *bag) {
+	size_t total = 0;
+	for(size_t i = 0; i < GBA_BAG_POCKETS; ++i) {
+		gba_item_slot_t *slots = bag->slots[i];
+		size_t count = 0;
+		for(uint64_t used = bag->used[i]; used; used &= used - 1) {
+			size_t slot = __builtin_ctzll(used);
+			if(slot != count) {
+				uint16_t item = slots[slot].index;
+				gba_journal_record(bag->save, &slots[count], sizeof(gba_item_slot_t));
+				gba_journal_record(bag->save, &slots[slot], sizeof(gba_item_slot_t));
+				slots[count] = slots[slot];
+				slots[slot].index = 0;
+				slots[slot].amount = 0;
+				if(item < GBA_BAG_ITEM_MAX && bag->where[i][item] == slot + 1) {
+					bag->where[i][item] = count + 1;
+				}
+				gba_mark_dirty(bag->save, &slots[count], sizeof(gba_item_slot_t));
+				gba_mark_dirty(bag->save, &slots[slot], sizeof(gba_item_slot_t));
+			}
+			++count;
+		}
+		bag->used[i] = count >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+		total += count;
+	}
+	return total;
+}
@@ -0,0 +1,533 @@
+//Columnar index of the GBA party and PC
+
+#include "types.h"
+#include "game_gba.h"
+#include "gba_pc_index.h"
+#include "stat.h"
+#include <string.h>
+
+static void gba_pc_index_read(gba_pc_index_t *index, size_t row) {
+	pk3_box_t pkm = *index->record[row];
+	if(!index->decrypted) {
+		pk3_decrypt(&pkm);
+	}
+	index->species[row] = pkm.species;
+	index->held_item[row] = pkm.held_item;
+	index->pid[row] = pkm.pid;
+	index->ot_fid[row] = pkm.ot_fid;
+	index->exp[row] = pkm.exp;
+	if(index->box[row] == GBA_PC_INDEX_PARTY) {
+		//the party block follows the box data and is never encrypted
+		index->level[row] = ((pk3_t *)index->record[row])->party.level;
+	} else if(index->growth_rates && pkm.species < index->growth_count) {
+		index->level[row] = stat_get_level(index->growth_rates[pkm.species], pkm.exp);
+	} else {
+		index->level[row] = 0;
+	}
+	index->iv[STAT_HP][row] = pkm.iv.hp;
+	index->iv[STAT_ATTACK][row] = pkm.iv.atk;
+	index->iv[STAT_DEFENSE][row] = pkm.iv.def;
+	index->iv[STAT_SPEED][row] = pkm.iv.spd;
+	index->iv[STAT_SP_ATTACK][row] = pkm.iv.satk;
+	index->iv[STAT_SP_DEFENSE][row] = pkm.iv.sdef;
+}
+
+/**
+ * Every record is copied and decrypted once, in a single pass, and the save is left untouched.
+ * @brief Builds the index of all occupied party and PC slots.
+ * @param index The index to fill.
+ * @param save The save to read.
+ * @param decrypted Non-zero if the records in the save are already decrypted.
+ * @param growth_rates stat_growth_rate_t for each species id, used to fill the level column of
+ * box pokemon. May be NULL.
+ * @param growth_count The number of entries in growth_rates. Box pokemon with a species id past
+ * the end get level 0.
+ */
+void gba_pc_index_build(gba_pc_index_t *index, gba_save_t *save, uint8_t decrypted, const uint8_t *growth_rates, size_t growth_count) {
+	size_t count = 0;
+	index->decrypted = decrypted;
+	index->growth_rates = growth_rates;
+	index->growth_count = growth_count;
+	gba_party_t *party = gba_get_party(save);
+	if(party) {
+		size_t size = party->size < POKEMON_IN_PARTY ? party->size : POKEMON_IN_PARTY;
+		for(size_t i = 0; i < size; ++i) {
+			index->record[count] = &party->pokemon[i].box;
+			index->box[count] = GBA_PC_INDEX_PARTY;
+			index->slot[count] = i;
+			++count;
+		}
+	}
+	gba_pc_t *pc = gba_get_pc(save);
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		for(size_t j = 0; j < GBA_POKEMON_IN_BOX; ++j) {
+			pk3_box_t *pkm = &pc->box[i].pokemon[j];
+			//has_species is in the unencrypted header
+			if(!pkm->has_species) {
+				continue;
+			}
+			index->record[count] = pkm;
+			index->box[count] = i;
+			index->slot[count] = j;
+			++count;
+		}
+	}
+	index->count = count;
+	for(size_t i = 0; i < count; ++i) {
+		gba_pc_index_read(index, i);
+	}
+}
+
+/**
+ * Call this after changing a record through index->record[row] to keep the columns in step.
+ * Moving, adding or removing pokemon changes which rows exist, so rebuild the index instead.
+ * @brief Re-reads one row of the index from its record.
+ * @param index The index to update.
+ * @param row The row to re-read.
+ */
+void gba_pc_index_refresh(gba_pc_index_t *index, size_t row) {
+	if(row < index->count) {
+		gba_pc_index_read(index, row);
+	}
+}
+
+//write every row, then advance only past the matches, so the scan has no data dependent branch
+static size_t gba_pc_index_collect(const uint8_t *match, size_t count, uint16_t *rows, size_t max) {
+	uint16_t all[GBA_PC_INDEX_SIZE];
+	size_t found = 0;
+	for(size_t i = 0; i < count; ++i) {
+		all[found] = i;
+		found += match[i];
+	}
+	memcpy(rows, all, (found < max ? found : max) * sizeof(*rows));
+	return found;
+}
+
+/**
+ * @brief Finds the rows holding a species.
+ * @param index The index to search.
+ * @param species The species id to look for.
+ * @param rows Array that receives the matching row numbers.
+ * @param max The size of the rows array.
+ * @return The number of matching rows, which may be more than max.
+ */
+size_t gba_pc_index_find_species(const gba_pc_index_t *index, uint16_t species, uint16_t *rows, size_t max) {
+	uint8_t match[GBA_PC_INDEX_SIZE];
+	for(size_t i = 0; i < index->count; ++i) {
+		match[i] = index->species[i] == species;
+	}
+	return gba_pc_index_collect(match, index->count, rows, max);
+}
+
+/**
+ * @brief Finds the rows whose six IVs all equal the given genes.
+ * @param index The index to search.
+ * @param genes The IVs to look for.
+ * @param rows Array that receives the matching row numbers.
+ * @param max The size of the rows array.
+ * @return The number of matching rows, which may be more than max.
+ */
+size_t gba_pc_index_find_genes(const gba_pc_index_t *index, const pk3_genes_t *genes, uint16_t *rows, size_t max) {
+	const uint8_t iv[6] = { genes->hp, genes->atk, genes->def, genes->spd, genes->satk, genes->sdef };
+	uint8_t match[GBA_PC_INDEX_SIZE];
+	memset(match, 1, index->count);
+	for(size_t s = 0; s < 6; ++s) {
+		const uint8_t *column = index->iv[s];
+		for(size_t i = 0; i < index->count; ++i) {
+			match[i] &= column[i] == iv[s];
+		}
+	}
+	return gba_pc_index_collect(match, index->count, rows, max);
+}
+
+/**
+ * @brief Counts how many of each species the index holds.
+ * @param index The index to count.
+ * @param counts Array indexed by species id, set to the number of rows with that species.
+ * @param size The size of the counts array, species past the end are not counted.
+ * @return The number of rows counted.
+ */
+size_t gba_pc_index_count_species(const gba_pc_index_t *index, uint16_t *counts, size_t size) {
+	size_t total = 0;
+	memset(counts, 0, size * sizeof(*counts));
+	for(size_t i = 0; i < index->count; ++i) {
+		if(index->species[i] < size) {
+			++counts[index->species[i]];
+			++total;
+		}
+	}
+	return total;
+}
+
+/**
+ * @brief Starts an empty query.
+ * @param query The query to initialize.
+ */
+void gba_pc_query_init(gba_pc_query_t *query) {
+	memset(query, 0, sizeof(*query));
+}
+
+//add a step that pops pop results and pushes one
+static gba_pc_query_step_t *gba_pc_query_push(gba_pc_query_t *query, gba_pc_query_op_t op, size_t pop) {
+	if(query->invalid || query->count >= GBA_PC_QUERY_MAX_OPS || query->depth < pop
+			|| query->depth - pop + 1 > GBA_PC_QUERY_MAX_DEPTH) {
+		query->invalid = 1;
+		return NULL;
+	}
+	gba_pc_query_step_t *step = &query->step[query->count++];
+	memset(step, 0, sizeof(*step));
+	step->op = op;
+	query->depth = query->depth - pop + 1;
+	return step;
+}
+
+/**
+ * Box pokemon only have a level if the index was built with growth rates. Matches nothing if
+ * min is greater than max.
+ * @brief Matches levels from min to max.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_level(gba_pc_query_t *query, uint8_t min, uint8_t max) {
+	gba_pc_query_step_t *step = gba_pc_query_push(query, GBA_PC_QUERY_LEVEL, 0);
+	if(!step) {
+		return -1;
+	}
+	step->range.min = min;
+	step->range.max = max;
+	return 0;
+}
+
+/**
+ * Matches nothing if min is greater than max.
+ * @brief Matches pokemon whose six IVs add up to between min and max.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_iv_total(gba_pc_query_t *query, uint8_t min, uint8_t max) {
+	gba_pc_query_step_t *step = gba_pc_query_push(query, GBA_PC_QUERY_IV_TOTAL, 0);
+	if(!step) {
+		return -1;
+	}
+	step->range.min = min;
+	step->range.max = max;
+	return 0;
+}
+
+/**
+ * @brief Matches shiny pokemon.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_shiny(gba_pc_query_t *query) {
+	return gba_pc_query_push(query, GBA_PC_QUERY_SHINY, 0) ? 0 : -1;
+}
+
+/**
+ * @brief Matches pokemon with any of a set of natures.
+ * @param natures Bit n set to match stat_nature_t n.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_nature(gba_pc_query_t *query, uint32_t natures) {
+	gba_pc_query_step_t *step = gba_pc_query_push(query, GBA_PC_QUERY_NATURE, 0);
+	if(!step) {
+		return -1;
+	}
+	step->natures = natures;
+	return 0;
+}
+
+/**
+ * @brief Matches pokemon of any of a set of species.
+ * @param species The species ids, ids past GBA_PC_QUERY_SPECIES_MAX are ignored.
+ * @param count The number of ids.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_species(gba_pc_query_t *query, const uint16_t *species, size_t count) {
+	gba_pc_query_step_t *step = gba_pc_query_push(query, GBA_PC_QUERY_SPECIES, 0);
+	if(!step) {
+		return -1;
+	}
+	for(size_t i = 0; i < count; ++i) {
+		if(species[i] < GBA_PC_QUERY_SPECIES_MAX) {
+			step->species[species[i] >> 6] |= (uint64_t)1 << (species[i] & 63);
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Matches pokemon from an original trainer, by full (public and secret) id.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_ot_id(gba_pc_query_t *query, uint32_t ot_fid) {
+	gba_pc_query_step_t *step = gba_pc_query_push(query, GBA_PC_QUERY_OT_ID, 0);
+	if(!step) {
+		return -1;
+	}
+	step->ot_fid = ot_fid;
+	return 0;
+}
+
+/**
+ * The name isn't one of the index columns, so this reads the record of every row and is much
+ * slower than the other predicates.
+ * @brief Matches pokemon whose original trainer name matches a text query.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_ot_name(gba_pc_query_t *query, const gba_text_query_t *name) {
+	gba_pc_query_step_t *step = gba_pc_query_push(query, GBA_PC_QUERY_OT_NAME, 0);
+	if(!step) {
+		return -1;
+	}
+	step->ot_name = *name;
+	return 0;
+}
+
+/**
+ * @brief Matches pokemon holding an item, 0 for no item.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_held_item(gba_pc_query_t *query, uint16_t item) {
+	gba_pc_query_step_t *step = gba_pc_query_push(query, GBA_PC_QUERY_HELD_ITEM, 0);
+	if(!step) {
+		return -1;
+	}
+	step->held_item = item;
+	return 0;
+}
+
+/**
+ * @brief Matches pokemon in a box, or GBA_PC_INDEX_PARTY for the party.
+ * @return 0 on success, -1 if the query is full.
+ */
+int gba_pc_query_box(gba_pc_query_t *query, uint8_t box) {
+	gba_pc_query_step_t *step = gba_pc_query_push(query, GBA_PC_QUERY_BOX, 0);
+	if(!step) {
+		return -1;
+	}
+	step->box = box;
+	return 0;
+}
+
+/**
+ * @brief Replaces the top two results with rows matching both.
+ * @return 0 on success, -1 if there are fewer than two results or the query is full.
+ */
+int gba_pc_query_and(gba_pc_query_t *query) {
+	return gba_pc_query_push(query, GBA_PC_QUERY_AND, 2) ? 0 : -1;
+}
+
+/**
+ * @brief Replaces the top two results with rows matching either.
+ * @return 0 on success, -1 if there are fewer than two results or the query is full.
+ */
+int gba_pc_query_or(gba_pc_query_t *query) {
+	return gba_pc_query_push(query, GBA_PC_QUERY_OR, 2) ? 0 : -1;
+}
+
+/**
+ * @brief Replaces the top result with the rows it doesn't match.
+ * @return 0 on success, -1 if there is no result or the query is full.
+ */
+int gba_pc_query_not(gba_pc_query_t *query) {
+	return gba_pc_query_push(query, GBA_PC_QUERY_NOT, 1) ? 0 : -1;
+}
+
+//evaluate one predicate for rows [start, start + n), bit i of the result is row start + i
+static uint64_t gba_pc_query_eval(const gba_pc_query_step_t *step, const gba_pc_index_t *index, size_t start, size_t n, uint64_t all) {
+	uint64_t mask = 0;
+	switch(step->op) {
+		case GBA_PC_QUERY_LEVEL: {
+			//an empty range matches nothing, the span below would wrap around and match everything
+			if(step->range.min > step->range.max) {
+				break;
+			}
+			const uint8_t *level = index->level + start;
+			uint32_t min = step->range.min, span = step->range.max - step->range.min;
+			for(size_t i = 0; i < n; ++i) {
+				mask |= (uint64_t)((uint32_t)(level[i] - min) <= span) << i;
+			}
+			break;
+		}
+		case GBA_PC_QUERY_IV_TOTAL: {
+			if(step->range.min > step->range.max) {
+				break;
+			}
+			uint32_t min = step->range.min, span = step->range.max - step->range.min;
+			for(size_t i = 0; i < n; ++i) {
+				uint32_t total = index->iv[0][start + i] + index->iv[1][start + i] + index->iv[2][start + i]
+						+ index->iv[3][start + i] + index->iv[4][start + i] + index->iv[5][start + i];
+				mask |= (uint64_t)(total - min <= span) << i;
+			}
+			break;
+		}
+		case GBA_PC_QUERY_SHINY: {
+			const uint32_t *pid = index->pid + start, *ot = index->ot_fid + start;
+			for(size_t i = 0; i < n; ++i) {
+				uint32_t x = pid[i] ^ ot[i];
+				mask |= (uint64_t)(((x >> 16) ^ (x & 0xFFFF)) < 8) << i;
+			}
+			break;
+		}
+		case GBA_PC_QUERY_NATURE: {
+			const uint32_t *pid = index->pid + start;
+			for(size_t i = 0; i < n; ++i) {
+				mask |= (uint64_t)((step->natures >> (pid[i] % 25)) & 1) << i;
+			}
+			break;
+		}
+		case GBA_PC_QUERY_SPECIES: {
+			const uint16_t *species = index->species + start;
+			for(size_t i = 0; i < n; ++i) {
+				uint16_t s = species[i] & (GBA_PC_QUERY_SPECIES_MAX - 1);
+				uint64_t in = (step->species[s >> 6] >> (s & 63)) & (species[i] < GBA_PC_QUERY_SPECIES_MAX);
+				mask |= in << i;
+			}
+			break;
+		}
+		case GBA_PC_QUERY_OT_ID: {
+			const uint32_t *ot = index->ot_fid + start;
+			for(size_t i = 0; i < n; ++i) {
+				mask |= (uint64_t)(ot[i] == step->ot_fid) << i;
+			}
+			break;
+		}
+		case GBA_PC_QUERY_OT_NAME:
+			for(uint64_t todo = all; todo; todo &= todo - 1) {
+				size_t i = __builtin_ctzll(todo);
+				const pk3_box_t *pkm = index->record[start + i];
+				mask |= (uint64_t)gba_text_query_match(&step->ot_name, pkm->ot_name, PK3_OT_NAME_LENGTH) << i;
+			}
+			break;
+		case GBA_PC_QUERY_HELD_ITEM: {
+			const uint16_t *item = index->held_item + start;
+			for(size_t i = 0; i < n; ++i) {
+				mask |= (uint64_t)(item[i] == step->held_item) << i;
+			}
+			break;
+		}
+		case GBA_PC_QUERY_BOX: {
+			const uint8_t *box = index->box + start;
+			for(size_t i = 0; i < n; ++i) {
+				mask |= (uint64_t)(box[i] == step->box) << i;
+			}
+			break;
+		}
+		default:
+			break;
+	}
+	return mask;
+}
+
+/**
+ * Rows are handled 64 at a time: every step turns a column into a 64 bit mask and AND, OR and
+ * NOT combine masks, so there is no per-row branching. The scan stops as soon as limit rows
+ * have been found.
+ * @brief Runs a query over an index.
+ * @param query A complete query, one result left on its stack.
+ * @param index The index to search.
+ * @param rows Array that receives the matching row numbers, in row order.
+ * @param limit The size of the rows array, the most rows to find.
+ * @return The number of rows written. Incomplete or invalid queries match nothing.
+ */
+size_t gba_pc_query_run(const gba_pc_query_t *query, const gba_pc_index_t *index, uint16_t *rows, size_t limit) {
+	size_t found = 0;
+	if(query->invalid || query->depth != 1) {
+		return 0;
+	}
+	for(size_t start = 0; start < index->count && found < limit; start += 64) {
+		size_t n = index->count - start < 64 ? index->count - start : 64;
+		uint64_t all = n == 64 ? ~(uint64_t)0 : ((uint64_t)1 << n) - 1;
+		uint64_t stack[GBA_PC_QUERY_MAX_DEPTH];
+		size_t depth = 0;
+		for(size_t i = 0; i < query->count; ++i) {
+			const gba_pc_query_step_t *step = &query->step[i];
+			switch(step->op) {
+				case GBA_PC_QUERY_AND:
+					--depth;
+					stack[depth - 1] &= stack[depth];
+					break;
+				case GBA_PC_QUERY_OR:
+					--depth;
+					stack[depth - 1] |= stack[depth];
+					break;
+				case GBA_PC_QUERY_NOT:
+					stack[depth - 1] = ~stack[depth - 1] & all;
+					break;
+				default:
+					stack[depth++] = gba_pc_query_eval(step, index, start, n, all);
+					break;
+			}
+		}
+		for(uint64_t match = stack[0] & all; match && found < limit; match &= match - 1) {
+			rows[found++] = start + __builtin_ctzll(match);
+		}
+	}
+	return found;
+}
+
+/**
+ * The keys come from the index columns, so no record is decrypted to sort. Records are moved
+ * as they are, each one at most once, and only the sections holding moved records are marked
+ * dirty. The party is not touched. Afterwards the occupancy bitmap and the index are rebuilt.
+ * @brief Sorts the PC, packing the pokemon into the first slots.
+ * @param index An index of the save, from gba_pc_index_build().
+ * @param save The save to sort.
+ * @param key The value to sort by. PC_SORT_LEVEL needs an index built with growth rates.
+ * @param descending Non-zero to put the largest value first.
+ * @param top If not 0, only the top pokemon are sorted to the front of the PC and the rest
+ * follow in their old order.
+ * @return The number of slots written.
+ */
+size_t gba_pc_index_sort(gba_pc_index_t *index, gba_save_t *save, pc_sort_key_t key, uint8_t descending, size_t top) {
+	enum { TOTAL = GBA_BOX_COUNT * GBA_POKEMON_IN_BOX };
+	void *slots[TOTAL];
+	uint16_t used[TOTAL];
+	uint32_t keys[TOTAL];
+	uint16_t from[TOTAL];
+	size_t count = 0;
+	gba_pc_t *pc = gba_get_pc(save);
+	for(size_t i = 0; i < TOTAL; ++i) {
+		slots[i] = &pc->box[i / GBA_POKEMON_IN_BOX].pokemon[i % GBA_POKEMON_IN_BOX];
+	}
+	for(size_t i = 0; i < index->count; ++i) {
+		if(index->box[i] == GBA_PC_INDEX_PARTY) {
+			continue;
+		}
+		uint32_t value = 0;
+		switch(key) {
+			case PC_SORT_SPECIES:
+				value = index->species[i];
+				break;
+			case PC_SORT_LEVEL:
+				value = index->level[i];
+				break;
+			case PC_SORT_IV_TOTAL:
+				for(size_t s = 0; s < 6; ++s) {
+					value += index->iv[s][i];
+				}
+				break;
+			case PC_SORT_EXP:
+				value = index->exp[i];
+				break;
+			case PC_SORT_HELD_ITEM:
+				value = index->held_item[i];
+				break;
+		}
+		used[count] = index->box[i] * GBA_POKEMON_IN_BOX + index->slot[i];
+		keys[count] = value;
+		++count;
+	}
+	//the journal keeps only the bytes that end up changed
+	gba_journal_record(save, gba_get_pc(save)->box, sizeof(gba_get_pc(save)->box));
+	size_t moved = pc_sort_slots(slots, sizeof(pk3_box_t), TOTAL, used, keys, count, descending, top, from);
+	if(!moved) {
+		return 0;
+	}
+	for(size_t i = 0; i < TOTAL; ++i) {
+		if(from[i] != i) {
+			gba_mark_dirty(save, slots[i], sizeof(pk3_box_t));
+		}
+	}
+	gba_pc_refresh_occupancy(save);
+	gba_pc_index_build(index, save, index->decrypted, index->growth_rates, index->growth_count);
+	return moved;
+}
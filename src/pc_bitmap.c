@@ -0,0 +1,76 @@
+//Free slot bitmap for PC boxes
+
+#include "types.h"
+#include "pc_bitmap.h"
+
+/**
+ * @brief Counts the occupied slots in the PC.
+ * @param occupied One word per box.
+ * @param boxes The number of boxes.
+ * @return The number of occupied slots.
+ */
+size_t pc_bitmap_count(const uint32_t *occupied, size_t boxes) {
+	size_t count = 0;
+	for(size_t i = 0; i < boxes; ++i) {
+		count += __builtin_popcount(occupied[i] & PC_BITMAP_FULL);
+	}
+	return count;
+}
+
+static size_t pc_bitmap_emptiest(const uint32_t *occupied, size_t boxes) {
+	size_t best = 0;
+	int most = -1;
+	for(size_t i = 0; i < boxes; ++i) {
+		int free = PC_BITMAP_SLOTS - __builtin_popcount(occupied[i] & PC_BITMAP_FULL);
+		if(free > most) {
+			most = free;
+			best = i;
+		}
+	}
+	return best;
+}
+
+/**
+ * Reserved slots are marked occupied straight away, so the caller must fill them (or clear
+ * the bits again) before anything else looks at the bitmap.
+ * @brief Finds and reserves free slots.
+ * @param occupied One word per box, updated with the reserved slots.
+ * @param boxes The number of boxes.
+ * @param current The current box, used by PC_FILL_CURRENT.
+ * @param fill The order to hand out slots in.
+ * @param count The number of slots wanted.
+ * @param slots Array that receives count slot numbers, each box * PC_BITMAP_SLOTS + slot.
+ * @return The number of slots reserved, less than count if the PC is full.
+ */
+size_t pc_bitmap_reserve(uint32_t *occupied, size_t boxes, size_t current, pc_fill_t fill, size_t count, uint16_t *slots) {
+	size_t reserved = 0;
+	if(boxes == 0) {
+		return 0;
+	}
+	if(fill == PC_FILL_EMPTIEST) {
+		while(reserved < count) {
+			size_t box = pc_bitmap_emptiest(occupied, boxes);
+			uint32_t free = ~occupied[box] & PC_BITMAP_FULL;
+			if(!free) {
+				break;
+			}
+			uint32_t slot = __builtin_ctz(free);
+			occupied[box] |= 1u << slot;
+			slots[reserved++] = box * PC_BITMAP_SLOTS + slot;
+		}
+		return reserved;
+	}
+	size_t start = fill == PC_FILL_CURRENT ? current % boxes : 0;
+	for(size_t i = 0; i < boxes && reserved < count; ++i) {
+		size_t box = (start + i) % boxes;
+		uint32_t free = ~occupied[box] & PC_BITMAP_FULL;
+		//take the lowest free slot until the box is full or we have enough
+		while(free && reserved < count) {
+			uint32_t slot = __builtin_ctz(free);
+			free &= free - 1;
+			occupied[box] |= 1u << slot;
+			slots[reserved++] = box * PC_BITMAP_SLOTS + slot;
+		}
+	}
+	return reserved;
+}
@@ -0,0 +1,227 @@
+//Sorting and reordering PC boxes
+
+#include "types.h"
+#include "pc_sort.h"
+#include <string.h>
+
+enum {
+	//marks a from entry whose slot has been written, slot numbers stay below this
+	PC_SORT_DONE = 0x8000
+};
+
+/**
+ * This is a radix sort, a byte of the key at a time, and bytes that are the same for every key
+ * are skipped, so small keys like species ids only take one or two passes.
+ * @brief Works out the order that sorts a set of keys. Pokemon with equal keys keep their order.
+ * @param order Array that receives count indexes into keys, smallest key first.
+ * @param keys The key of each pokemon.
+ * @param count The number of keys, at most PC_SORT_MAX.
+ * @param descending Non-zero to put the largest key first instead.
+ */
+void pc_sort_order(uint16_t *order, const uint32_t *keys, size_t count, uint8_t descending) {
+	uint16_t other[PC_SORT_MAX];
+	uint32_t flip = descending ? 0xFFFFFFFF : 0;
+	for(size_t i = 0; i < count; ++i) {
+		order[i] = i;
+	}
+	if(count == 0 || count > PC_SORT_MAX) {
+		return;
+	}
+	uint16_t *src = order, *dst = other;
+	for(size_t shift = 0; shift < 32; shift += 8) {
+		size_t bucket[256] = { 0 };
+		for(size_t i = 0; i < count; ++i) {
+			++bucket[((keys[i] ^ flip) >> shift) & 0xFF];
+		}
+		//every key has the same byte here, this pass would not change anything
+		if(bucket[((keys[0] ^ flip) >> shift) & 0xFF] == count) {
+			continue;
+		}
+		size_t start = 0;
+		for(size_t b = 0; b < 256; ++b) {
+			size_t n = bucket[b];
+			bucket[b] = start;
+			start += n;
+		}
+		for(size_t i = 0; i < count; ++i) {
+			dst[bucket[((keys[src[i]] ^ flip) >> shift) & 0xFF]++] = src[i];
+		}
+		uint16_t *swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if(src != order) {
+		memcpy(order, src, count * sizeof(*order));
+	}
+}
+
+//whether pokemon a goes before pokemon b, equal keys keep their order
+static inline uint8_t pc_sort_before(const uint32_t *keys, uint16_t a, uint16_t b, uint8_t descending) {
+	if(keys[a] != keys[b]) {
+		return descending ? keys[a] > keys[b] : keys[a] < keys[b];
+	}
+	return a < b;
+}
+
+//restore the heap below i, the root of the heap is the pokemon that goes last
+static void pc_sort_sift(uint16_t *heap, size_t size, size_t i, const uint32_t *keys, uint8_t descending) {
+	for(;;) {
+		size_t last = i, left = 2 * i + 1, right = left + 1;
+		if(left < size && pc_sort_before(keys, heap[last], heap[left], descending)) {
+			last = left;
+		}
+		if(right < size && pc_sort_before(keys, heap[last], heap[right], descending)) {
+			last = right;
+		}
+		if(last == i) {
+			return;
+		}
+		uint16_t swap = heap[i];
+		heap[i] = heap[last];
+		heap[last] = swap;
+		i = last;
+	}
+}
+
+/**
+ * Only the first top pokemon are sorted, using a heap of top entries, which is much less work
+ * than a full sort when top is small.
+ * @brief Works out the order that puts the top pokemon first, sorted, and leaves the rest after
+ * them in their original order.
+ * @param order Array that receives count indexes into keys.
+ * @param keys The key of each pokemon.
+ * @param count The number of keys, at most PC_SORT_MAX.
+ * @param top The number of pokemon to pick.
+ * @param descending Non-zero to pick the largest keys instead of the smallest.
+ */
+void pc_sort_top(uint16_t *order, const uint32_t *keys, size_t count, size_t top, uint8_t descending) {
+	if(top >= count || count > PC_SORT_MAX) {
+		pc_sort_order(order, keys, count, descending);
+		return;
+	}
+	uint8_t picked[PC_SORT_MAX] = { 0 };
+	size_t size = 0;
+	for(size_t i = 0; i < count && top; ++i) {
+		if(size < top) {
+			//grow the heap, moving the new entry up past anything it goes after
+			size_t j = size++;
+			order[j] = i;
+			while(j && pc_sort_before(keys, order[(j - 1) / 2], order[j], descending)) {
+				uint16_t swap = order[j];
+				order[j] = order[(j - 1) / 2];
+				order[(j - 1) / 2] = swap;
+				j = (j - 1) / 2;
+			}
+		} else if(pc_sort_before(keys, i, order[0], descending)) {
+			order[0] = i;
+			pc_sort_sift(order, size, 0, keys, descending);
+		}
+	}
+	//take the last pokemon off the heap each time, filling the top from the back
+	for(size_t n = size; n > 0; --n) {
+		uint16_t last = order[0];
+		order[0] = order[n - 1];
+		pc_sort_sift(order, n - 1, 0, keys, descending);
+		order[n - 1] = last;
+		picked[last] = 1;
+	}
+	for(size_t i = 0; i < count; ++i) {
+		if(!picked[i]) {
+			order[size++] = i;
+		}
+	}
+}
+
+/**
+ * Each cycle of the permutation is followed from one slot: that slot's record is put aside,
+ * every other record in the cycle is copied once, straight to its new slot, and the record put
+ * aside goes in last. Slots that keep their record are not touched.
+ * @brief Moves records into a new order.
+ * @param slots Pointer to each slot, the slots don't need to be next to each other.
+ * @param size The size of one record, at most PC_SORT_RECORD_MAX.
+ * @param from For each slot, the slot whose record should end up in it. Must be a permutation,
+ * it is left as it was.
+ * @param count The number of slots, at most PC_SORT_MAX.
+ * @return The number of slots written, 0 if from isn't a permutation.
+ */
+size_t pc_sort_apply(void *const *slots, size_t size, uint16_t *from, size_t count) {
+	uint8_t record[PC_SORT_RECORD_MAX];
+	uint8_t seen[PC_SORT_MAX] = { 0 };
+	size_t moved = 0;
+	if(size > PC_SORT_RECORD_MAX || count > PC_SORT_MAX) {
+		return 0;
+	}
+	for(size_t i = 0; i < count; ++i) {
+		if(from[i] >= count || seen[from[i]]) {
+			return 0;
+		}
+		seen[from[i]] = 1;
+	}
+	for(size_t i = 0; i < count; ++i) {
+		if(from[i] & PC_SORT_DONE) {
+			continue;
+		}
+		if(from[i] == i) {
+			from[i] |= PC_SORT_DONE;
+			continue;
+		}
+		memcpy(record, slots[i], size);
+		size_t j = i;
+		while(from[j] != i) {
+			size_t next = from[j];
+			memcpy(slots[j], slots[next], size);
+			from[j] |= PC_SORT_DONE;
+			++moved;
+			j = next;
+		}
+		memcpy(slots[j], record, size);
+		from[j] |= PC_SORT_DONE;
+		++moved;
+	}
+	for(size_t i = 0; i < count; ++i) {
+		from[i] &= ~PC_SORT_DONE;
+	}
+	return moved;
+}
+
+/**
+ * The sorted pokemon fill the first count slots and the empty slots follow, in their old order.
+ * @brief Sorts the pokemon in a set of slots.
+ * @param slots Pointer to each slot.
+ * @param size The size of one record.
+ * @param total The number of slots, at most PC_SORT_MAX.
+ * @param used The slot number of each pokemon, in slot order, no slot listed twice.
+ * @param keys The key of each pokemon.
+ * @param count The number of pokemon.
+ * @param descending Non-zero to put the largest key first.
+ * @param top If not 0, only this many pokemon are sorted to the front, see pc_sort_top().
+ * @param from Array of total entries that receives, for each slot, the slot its record came
+ * from. Slots where from[i] != i were written.
+ * @return The number of slots written, 0 if nothing moved or the arguments don't fit.
+ */
+size_t pc_sort_slots(void *const *slots, size_t size, size_t total, const uint16_t *used, const uint32_t *keys, size_t count, uint8_t descending, size_t top, uint16_t *from) {
+	uint16_t order[PC_SORT_MAX];
+	uint8_t taken[PC_SORT_MAX] = { 0 };
+	if(total > PC_SORT_MAX || count > total) {
+		return 0;
+	}
+	if(top) {
+		pc_sort_top(order, keys, count, top, descending);
+	} else {
+		pc_sort_order(order, keys, count, descending);
+	}
+	for(size_t i = 0; i < count; ++i) {
+		from[i] = used[order[i]];
+		if(from[i] >= total || taken[from[i]]) {
+			return 0;
+		}
+		taken[from[i]] = 1;
+	}
+	size_t n = count;
+	for(size_t i = 0; i < total; ++i) {
+		if(!taken[i]) {
+			from[n++] = i;
+		}
+	}
+	return pc_sort_apply(slots, size, from, total);
+}
@@ -0,0 +1,417 @@
+//Content addressed pokemon store
+
+//open, mmap and ftruncate are POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+
+#include "types.h"
+#include "pkm_store.h"
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum {
+	PKM_STORE_VERSION = 1,
+	PKM_STORE_HEADER_SIZE = 64,
+	//a record that lost the race to be added, it is never returned
+	PKM_STORE_DEAD = 0xFF,
+	//index entries hold the ref + 1 in these bits and the top of the hash above them
+	PKM_STORE_REF_BITS = 24
+};
+
+static const char PKM_STORE_MAGIC[8] = { 'L', 'S', 'P', 'K', 'M', 'S', 'T', 'R' };
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t capacity;
+	//records handed out, it passes capacity once the store is full
+	atomic_uint_least64_t tail;
+} pkm_store_header_t;
+
+typedef struct {
+	uint64_t hash;
+	//0 while the record is written, then a pkm_store_kind_t or PKM_STORE_DEAD
+	atomic_uint state;
+	uint32_t size;
+	uint8_t data[sizeof(pkm_box_t)];
+} pkm_store_record_t;
+
+struct pkm_store {
+	int fd;
+	uint8_t *map;
+	size_t length;
+	pkm_store_header_t *header;
+	pkm_store_record_t *records;
+	size_t capacity;
+	//0 for an empty entry
+	atomic_uint_least64_t *index;
+	size_t mask;
+};
+
+static uint64_t pkm_store_hash(const uint8_t *head, size_t head_size, const uint8_t *body, size_t body_size) {
+	//FNV-1a, then a finalizer so the low bits used for the index slot are well mixed
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for(size_t i = 0; i < head_size; ++i) {
+		hash = (hash ^ head[i]) * 0x100000001B3ULL;
+	}
+	for(size_t i = 0; i < body_size; ++i) {
+		hash = (hash ^ body[i]) * 0x100000001B3ULL;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/**
+ * @brief Hashes the key of a GBA pokemon: the PID, the OT ids and the data blocks.
+ * @param pkm The pokemon, decrypted.
+ * @return The hash.
+ */
+uint64_t pkm_store_hash_pk3(const pk3_box_t *pkm) {
+	return pkm_store_hash((const uint8_t *)pkm, offsetof(pk3_box_t, nickname), (const uint8_t *)pkm->block, sizeof(pkm->block));
+}
+
+/**
+ * The OT ids are in the first data block.
+ * @brief Hashes the key of an NDS pokemon: the PID and the data blocks.
+ * @param pkm The pokemon, decrypted.
+ * @return The hash.
+ */
+uint64_t pkm_store_hash_pkm(const pkm_box_t *pkm) {
+	return pkm_store_hash((const uint8_t *)&pkm->header.pid, sizeof(pkm->header.pid), (const uint8_t *)pkm->block, sizeof(pkm->block));
+}
+
+//whether two decrypted pokemon have the same key
+static uint8_t pkm_store_same(pkm_store_kind_t kind, const uint8_t *a, const uint8_t *b) {
+	if(kind == PKM_STORE_PK3) {
+		return !memcmp(a, b, offsetof(pk3_box_t, nickname))
+				&& !memcmp(a + offsetof(pk3_box_t, block), b + offsetof(pk3_box_t, block), PK3_BLOCK_SIZE * 4);
+	}
+	return !memcmp(a, b, sizeof(uint32_t))
+			&& !memcmp(a + offsetof(pkm_box_t, block), b + offsetof(pkm_box_t, block), PKM_BLOCK_SIZE * 4);
+}
+
+static inline uint64_t pkm_store_entry(uint64_t hash, pkm_store_ref_t ref) {
+	return (hash & ~(((uint64_t)1 << PKM_STORE_REF_BITS) - 1)) | (ref + 1);
+}
+
+//checks an index entry against a pokemon, giving its ref if it holds the same one
+static pkm_store_ref_t pkm_store_match(const pkm_store_t *store, uint64_t entry, uint64_t hash, pkm_store_kind_t kind, const uint8_t *data) {
+	if((entry ^ hash) >> PKM_STORE_REF_BITS) {
+		return PKM_STORE_NONE;
+	}
+	pkm_store_ref_t ref = (entry & (((uint64_t)1 << PKM_STORE_REF_BITS) - 1)) - 1;
+	const pkm_store_record_t *record = &store->records[ref];
+	if(atomic_load_explicit(&record->state, memory_order_acquire) != kind || !pkm_store_same(kind, record->data, data)) {
+		return PKM_STORE_NONE;
+	}
+	return ref;
+}
+
+static pkm_store_ref_t pkm_store_lookup(const pkm_store_t *store, uint64_t hash, pkm_store_kind_t kind, const uint8_t *data) {
+	for(size_t i = hash & store->mask, n = 0; n <= store->mask; i = (i + 1) & store->mask, ++n) {
+		uint64_t entry = atomic_load_explicit(&store->index[i], memory_order_acquire);
+		if(!entry) {
+			return PKM_STORE_NONE;
+		}
+		pkm_store_ref_t ref = pkm_store_match(store, entry, hash, kind, data);
+		if(ref != PKM_STORE_NONE) {
+			return ref;
+		}
+	}
+	return PKM_STORE_NONE;
+}
+
+//adds a written record to the index, or finds the record another thread added first
+static pkm_store_ref_t pkm_store_publish(pkm_store_t *store, pkm_store_ref_t ref) {
+	pkm_store_record_t *record = &store->records[ref];
+	pkm_store_kind_t kind = atomic_load_explicit(&record->state, memory_order_relaxed);
+	uint64_t want = pkm_store_entry(record->hash, ref);
+	for(size_t i = record->hash & store->mask, n = 0; n <= store->mask; i = (i + 1) & store->mask, ++n) {
+		uint64_t entry = atomic_load_explicit(&store->index[i], memory_order_acquire);
+		if(!entry) {
+			if(atomic_compare_exchange_strong(&store->index[i], &entry, want)) {
+				return ref;
+			}
+			//entry now holds what beat us to the slot
+		}
+		pkm_store_ref_t found = pkm_store_match(store, entry, record->hash, kind, record->data);
+		if(found != PKM_STORE_NONE) {
+			return found;
+		}
+	}
+	return PKM_STORE_NONE;
+}
+
+static pkm_store_ref_t pkm_store_put(pkm_store_t *store, pkm_store_kind_t kind, const void *data, size_t size, uint64_t hash) {
+	pkm_store_ref_t ref = pkm_store_lookup(store, hash, kind, data);
+	if(ref != PKM_STORE_NONE) {
+		return ref;
+	}
+	uint64_t slot = atomic_fetch_add(&store->header->tail, 1);
+	if(slot >= store->capacity) {
+		return PKM_STORE_NONE;
+	}
+	pkm_store_record_t *record = &store->records[slot];
+	record->hash = hash;
+	record->size = size;
+	memcpy(record->data, data, size);
+	atomic_store_explicit(&record->state, kind, memory_order_release);
+	ref = pkm_store_publish(store, slot);
+	if(ref != slot) {
+		atomic_store_explicit(&record->state, PKM_STORE_DEAD, memory_order_release);
+	}
+	return ref;
+}
+
+static int pkm_store_map(pkm_store_t *store, size_t length) {
+	uint8_t *map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+	if(map == MAP_FAILED) {
+		return -1;
+	}
+	store->map = map;
+	store->length = length;
+	store->header = (pkm_store_header_t *)map;
+	store->records = (pkm_store_record_t *)(map + PKM_STORE_HEADER_SIZE);
+	return 0;
+}
+
+/**
+ * A new file is made if there is none at the path. An existing store smaller than capacity is
+ * grown, records already in it keep their refs.
+ * @brief Opens a store, building its index from the records in the file.
+ * @param path The store file.
+ * @param capacity The most records the store can hold, at most PKM_STORE_MAX.
+ * @return The store, or NULL if the file couldn't be opened or isn't a store.
+ */
+pkm_store_t *pkm_store_open(const char *path, size_t capacity) {
+	if(capacity > PKM_STORE_MAX) {
+		capacity = PKM_STORE_MAX;
+	}
+	if(!capacity) {
+		capacity = 1;
+	}
+	pkm_store_t *store = calloc(1, sizeof(pkm_store_t));
+	if(!store) {
+		return NULL;
+	}
+	store->fd = open(path, O_RDWR | O_CREAT, 0644);
+	struct stat st;
+	if(store->fd < 0 || fstat(store->fd, &st)) {
+		goto fail;
+	}
+	size_t tail = 0;
+	if(st.st_size >= PKM_STORE_HEADER_SIZE) {
+		pkm_store_header_t header;
+		if(pread(store->fd, &header, sizeof(header), 0) != sizeof(header)
+				|| memcmp(header.magic, PKM_STORE_MAGIC, sizeof(PKM_STORE_MAGIC))
+				|| header.version != PKM_STORE_VERSION || header.record_size != sizeof(pkm_store_record_t)
+				//index entries only have room for refs below PKM_STORE_MAX
+				|| !header.capacity || header.capacity > PKM_STORE_MAX
+				|| (size_t)st.st_size < PKM_STORE_HEADER_SIZE + header.capacity * sizeof(pkm_store_record_t)) {
+			goto fail;
+		}
+		//slots handed out past the end were never written
+		tail = header.tail < header.capacity ? header.tail : header.capacity;
+		if(capacity < header.capacity) {
+			capacity = header.capacity;
+		}
+	} else if(st.st_size) {
+		goto fail;
+	}
+	size_t length = PKM_STORE_HEADER_SIZE + capacity * sizeof(pkm_store_record_t);
+	if((size_t)st.st_size < length && ftruncate(store->fd, length)) {
+		goto fail;
+	}
+	if(pkm_store_map(store, length)) {
+		goto fail;
+	}
+	memcpy(store->header->magic, PKM_STORE_MAGIC, sizeof(PKM_STORE_MAGIC));
+	store->header->version = PKM_STORE_VERSION;
+	store->header->record_size = sizeof(pkm_store_record_t);
+	store->header->capacity = capacity;
+	atomic_store(&store->header->tail, tail);
+	store->capacity = capacity;
+	//at most half full, so probe runs stay short
+	size_t size = 2;
+	while(size < capacity * 2) {
+		size <<= 1;
+	}
+	store->index = calloc(size, sizeof(*store->index));
+	if(!store->index) {
+		goto fail;
+	}
+	store->mask = size - 1;
+	for(size_t i = 0; i < tail; ++i) {
+		unsigned state = atomic_load(&store->records[i].state);
+		if(state != PKM_STORE_PK3 && state != PKM_STORE_PKM) {
+			//dead, or cut off by a crash while being written
+			atomic_store(&store->records[i].state, PKM_STORE_DEAD);
+			continue;
+		}
+		if(pkm_store_publish(store, i) != i) {
+			atomic_store(&store->records[i].state, PKM_STORE_DEAD);
+		}
+	}
+	return store;
+fail:
+	pkm_store_close(store);
+	return NULL;
+}
+
+/**
+ * @brief Closes a store, writing it out.
+ * @param store The store to close.
+ */
+void pkm_store_close(pkm_store_t *store) {
+	if(store->map) {
+		msync(store->map, store->length, MS_SYNC);
+		munmap(store->map, store->length);
+	}
+	if(store->fd >= 0) {
+		close(store->fd);
+	}
+	free(store->index);
+	free(store);
+}
+
+/**
+ * Dead records are counted, so this is an upper bound while other threads are adding.
+ * @brief Gets the number of records in a store.
+ * @param store The store.
+ * @return The number of records.
+ */
+size_t pkm_store_count(const pkm_store_t *store) {
+	uint64_t tail = atomic_load(&((pkm_store_t *)store)->header->tail);
+	return tail < store->capacity ? tail : store->capacity;
+}
+
+/**
+ * @brief Adds a GBA pokemon, unless the store already has it.
+ * @param store The store to add to.
+ * @param pkm The pokemon, encrypted as it is in a save.
+ * @return The ref of the pokemon in the store, or PKM_STORE_NONE if the store is full.
+ */
+pkm_store_ref_t pkm_store_put_pk3(pkm_store_t *store, const pk3_box_t *pkm) {
+	pk3_box_t copy = *pkm;
+	pk3_decrypt(&copy);
+	return pkm_store_put(store, PKM_STORE_PK3, &copy, sizeof(copy), pkm_store_hash_pk3(&copy));
+}
+
+/**
+ * @brief Adds an NDS pokemon, unless the store already has it.
+ * @param store The store to add to.
+ * @param pkm The pokemon, encrypted as it is in a save.
+ * @return The ref of the pokemon in the store, or PKM_STORE_NONE if the store is full.
+ */
+pkm_store_ref_t pkm_store_put_pkm(pkm_store_t *store, const pkm_box_t *pkm) {
+	pkm_box_t copy = *pkm;
+	pkm_decrypt(&copy);
+	return pkm_store_put(store, PKM_STORE_PKM, &copy, sizeof(copy), pkm_store_hash_pkm(&copy));
+}
+
+/**
+ * @brief Finds a GBA pokemon in a store.
+ * @param store The store to search.
+ * @param pkm The pokemon, encrypted as it is in a save.
+ * @return The ref of the pokemon, or PKM_STORE_NONE if the store doesn't have it.
+ */
+pkm_store_ref_t pkm_store_find_pk3(const pkm_store_t *store, const pk3_box_t *pkm) {
+	pk3_box_t copy = *pkm;
+	pk3_decrypt(&copy);
+	return pkm_store_lookup(store, pkm_store_hash_pk3(&copy), PKM_STORE_PK3, (const uint8_t *)&copy);
+}
+
+/**
+ * @brief Finds an NDS pokemon in a store.
+ * @param store The store to search.
+ * @param pkm The pokemon, encrypted as it is in a save.
+ * @return The ref of the pokemon, or PKM_STORE_NONE if the store doesn't have it.
+ */
+pkm_store_ref_t pkm_store_find_pkm(const pkm_store_t *store, const pkm_box_t *pkm) {
+	pkm_box_t copy = *pkm;
+	pkm_decrypt(&copy);
+	return pkm_store_lookup(store, pkm_store_hash_pkm(&copy), PKM_STORE_PKM, (const uint8_t *)&copy);
+}
+
+static const void *pkm_store_get(const pkm_store_t *store, pkm_store_ref_t ref, pkm_store_kind_t kind) {
+	if(ref >= pkm_store_count(store)) {
+		return NULL;
+	}
+	const pkm_store_record_t *record = &store->records[ref];
+	if(atomic_load_explicit(&record->state, memory_order_acquire) != kind) {
+		return NULL;
+	}
+	return record->data;
+}
+
+/**
+ * @brief Gets a GBA pokemon from a store.
+ * @param store The store.
+ * @param ref The ref of the pokemon.
+ * @return The pokemon, decrypted, or NULL if ref isn't a GBA pokemon. Don't change it.
+ */
+const pk3_box_t *pkm_store_get_pk3(const pkm_store_t *store, pkm_store_ref_t ref) {
+	return pkm_store_get(store, ref, PKM_STORE_PK3);
+}
+
+/**
+ * @brief Gets an NDS pokemon from a store.
+ * @param store The store.
+ * @param ref The ref of the pokemon.
+ * @return The pokemon, decrypted, or NULL if ref isn't an NDS pokemon. Don't change it.
+ */
+const pkm_box_t *pkm_store_get_pkm(const pkm_store_t *store, pkm_store_ref_t ref) {
+	return pkm_store_get(store, ref, PKM_STORE_PKM);
+}
+
+/**
+ * @brief Adds every pokemon in a GBA PC to a store.
+ * @param store The store to add to.
+ * @param save The save to read, its occupancy bitmap must be current.
+ * @param refs Receives the ref of every PC slot, box * GBA_POKEMON_IN_BOX + slot, PKM_STORE_NONE
+ * for empty slots.
+ * @return The number of pokemon stored or found in the store.
+ */
+size_t pkm_store_put_gba_pc(pkm_store_t *store, gba_save_t *save, pkm_store_ref_t refs[GBA_BOX_COUNT * GBA_POKEMON_IN_BOX]) {
+	gba_pc_t *pc = gba_get_pc(save);
+	size_t count = 0;
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		for(size_t j = 0; j < GBA_POKEMON_IN_BOX; ++j) {
+			pkm_store_ref_t *ref = &refs[i * GBA_POKEMON_IN_BOX + j];
+			*ref = gba_pc_is_occupied(save, i, j) ? pkm_store_put_pk3(store, &pc->box[i].pokemon[j]) : PKM_STORE_NONE;
+			count += *ref != PKM_STORE_NONE;
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief Adds every pokemon in an NDS PC to a store.
+ * @param store The store to add to.
+ * @param save The save to read, its occupancy bitmap must be current.
+ * @param refs Receives the ref of every PC slot, box * NDS_POKEMON_IN_BOX + slot, PKM_STORE_NONE
+ * for empty slots.
+ * @return The number of pokemon stored or found in the store.
+ */
+size_t pkm_store_put_nds_pc(pkm_store_t *store, nds_save_t *save, pkm_store_ref_t refs[NDS_BOX_COUNT * NDS_POKEMON_IN_BOX]) {
+	size_t count = 0;
+	for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+		nds_box_t *box = nds_get_box(save, i);
+		for(size_t j = 0; j < NDS_POKEMON_IN_BOX; ++j) {
+			pkm_store_ref_t *ref = &refs[i * NDS_POKEMON_IN_BOX + j];
+			*ref = nds_pc_is_occupied(save, i, j) ? pkm_store_put_pkm(store, &box->pokemon[j]) : PKM_STORE_NONE;
+			count += *ref != PKM_STORE_NONE;
+		}
+	}
+	return count;
+}
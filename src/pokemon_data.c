@@ -0,0 +1,288 @@
+// Extraction code copyright 2023 Ben Trask. MIT licensed.
+// The actual data is either copyrighted by Game Freak or public domain.
+
+#include "pokemon_data.h"
+#include <stddef.h>
+#include <string.h>
+
+// The tables are stored column by column rather than as arrays of structs, so a loop over one
+// field (e.g. base attack for every species) walks a single dense array. All names live in one
+// string pool built from a struct of exactly-sized char arrays, and each table refers to its
+// names by 16-bit offset into the pool instead of by pointer.
+
+typedef struct {
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) char species_##token[sizeof(name)]; char species_caps_##token[sizeof(nameCaps)];
+SPECIES(XX)
+#undef XX
+	char move_none[sizeof("--")];
+#define XX(id, token, name, pp) char move_##token[sizeof(name)];
+MOVES(XX)
+#undef XX
+#define XX(id, token) char nature_##token[sizeof(#token)];
+NATURES(XX)
+#undef XX
+#define XX(id, token, name) char item_##token[sizeof(name)];
+ITEMS(XX)
+#undef XX
+#define XX(id, token, name) char location_##token[sizeof(name)];
+LOCATIONS(XX)
+#undef XX
+#define XX(id, token, label) char pocket_##token[sizeof(label)];
+POCKETS(XX)
+#undef XX
+} pokemon_data_pool_t;
+
+static pokemon_data_pool_t const pool = {
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) name, nameCaps,
+SPECIES(XX)
+#undef XX
+	"--",
+#define XX(id, token, name, pp) name,
+MOVES(XX)
+#undef XX
+#define XX(id, token) #token,
+NATURES(XX)
+#undef XX
+#define XX(id, token, name) name,
+ITEMS(XX)
+#undef XX
+#define XX(id, token, name) name,
+LOCATIONS(XX)
+#undef XX
+#define XX(id, token, label) label,
+POCKETS(XX)
+#undef XX
+};
+_Static_assert(sizeof(pokemon_data_pool_t) <= UINT16_MAX, "string pool too large for 16-bit offsets");
+
+// Offset 0 is the first species name, so a zero offset can't double as "no name". Species 0 has
+// no name at all and is handled in the accessors instead.
+#define NAME(field) (uint16_t)offsetof(pokemon_data_pool_t, field)
+
+static uint16_t const species_names[] = {
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) [id] = NAME(species_##token),
+SPECIES(XX)
+#undef XX
+};
+static uint16_t const species_names_caps[] = {
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) [id] = NAME(species_caps_##token),
+SPECIES(XX)
+#undef XX
+};
+static uint8_t const species_stats[6][SPECIES_COUNT] = {
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) [id] = hp,
+	[STAT_HP] = { SPECIES(XX) },
+#undef XX
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) [id] = atk,
+	[STAT_ATTACK] = { SPECIES(XX) },
+#undef XX
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) [id] = def,
+	[STAT_DEFENSE] = { SPECIES(XX) },
+#undef XX
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) [id] = spd,
+	[STAT_SPEED] = { SPECIES(XX) },
+#undef XX
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) [id] = satk,
+	[STAT_SP_ATTACK] = { SPECIES(XX) },
+#undef XX
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) [id] = sdef,
+	[STAT_SP_DEFENSE] = { SPECIES(XX) },
+#undef XX
+};
+
+static uint16_t const move_names[] = {
+	[0] = NAME(move_none),
+#define XX(id, token, name, pp) [id] = NAME(move_##token),
+MOVES(XX)
+#undef XX
+};
+static int8_t const move_pps[] = {
+#define XX(id, token, name, pp) [id] = pp,
+MOVES(XX)
+#undef XX
+};
+
+static uint16_t const nature_names[] = {
+#define XX(id, token) [id] = NAME(nature_##token),
+NATURES(XX)
+#undef XX
+};
+
+static uint16_t const item_names[] = {
+#define XX(id, token, name) [id] = NAME(item_##token),
+ITEMS(XX)
+#undef XX
+};
+
+static uint16_t const location_names[] = {
+#define XX(id, token, name) [id] = NAME(location_##token),
+LOCATIONS(XX)
+#undef XX
+};
+
+static uint16_t const pocket_labels[] = {
+#define XX(id, token, label) [id] = NAME(pocket_##token),
+POCKETS(XX)
+#undef XX
+};
+
+#undef NAME
+
+// Designated initializers size each array by its largest id, so these catch gaps in the ids.
+_Static_assert(sizeof(species_names)/sizeof(*species_names) == SPECIES_COUNT, "species ids must be contiguous");
+_Static_assert(sizeof(move_names)/sizeof(*move_names) == MOVES_COUNT, "move ids must be contiguous");
+_Static_assert(sizeof(nature_names)/sizeof(*nature_names) == NATURES_COUNT, "nature ids must be contiguous");
+_Static_assert(sizeof(item_names)/sizeof(*item_names) == ITEMS_COUNT, "item ids must be contiguous");
+_Static_assert(sizeof(location_names)/sizeof(*location_names) == LOCATIONS_COUNT, "location ids must be contiguous");
+_Static_assert(sizeof(pocket_labels)/sizeof(*pocket_labels) == POCKETS_COUNT, "pocket ids must be contiguous");
+
+static char const *pool_string(uint16_t const offset) {
+	return (char const *)&pool + offset;
+}
+
+char const *species_name(uint16_t const id) {
+	if(0 == id || id >= SPECIES_COUNT) return NULL;
+	return pool_string(species_names[id]);
+}
+char const *species_name_caps(uint16_t const id) {
+	if(0 == id || id >= SPECIES_COUNT) return NULL;
+	return pool_string(species_names_caps[id]);
+}
+uint8_t species_base_stat(uint16_t const id, stat_stat_t const stat) {
+	if(id >= SPECIES_COUNT || (unsigned)stat > STAT_SP_DEFENSE) return 0;
+	return species_stats[stat][id];
+}
+pk3_effort_t species_base_stats(uint16_t const id) {
+	pk3_effort_t stats = { 0, 0, 0, 0, 0, 0 };
+	if(id >= SPECIES_COUNT) return stats;
+	stats.hp = species_stats[STAT_HP][id];
+	stats.atk = species_stats[STAT_ATTACK][id];
+	stats.def = species_stats[STAT_DEFENSE][id];
+	stats.spd = species_stats[STAT_SPEED][id];
+	stats.satk = species_stats[STAT_SP_ATTACK][id];
+	stats.sdef = species_stats[STAT_SP_DEFENSE][id];
+	return stats;
+}
+uint8_t const *species_base_stat_column(stat_stat_t const stat) {
+	if((unsigned)stat > STAT_SP_DEFENSE) return NULL;
+	return species_stats[stat];
+}
+
+char const *move_name(uint16_t const id) {
+	if(id >= MOVES_COUNT) return NULL;
+	return pool_string(move_names[id]);
+}
+int8_t move_pp(uint16_t const id) {
+	if(id >= MOVES_COUNT) return 0;
+	return move_pps[id];
+}
+
+char const *nature_name(uint32_t const id) {
+	if(id >= NATURES_COUNT) return NULL;
+	return pool_string(nature_names[id]);
+}
+
+char const *item_name(uint16_t const id) {
+	if(id >= ITEMS_COUNT) return NULL;
+	return pool_string(item_names[id]);
+}
+
+char const *location_name(uint16_t const id) {
+	if(id >= LOCATIONS_COUNT) return NULL;
+	return pool_string(location_names[id]);
+}
+
+char const *pocket_label(uint8_t const id) {
+	if(id >= POCKETS_COUNT) return NULL;
+	return pool_string(pocket_labels[id]);
+}
+
+// https://bulbapedia.bulbagarden.net/wiki/In-game_trade
+gba_trainer_t const elyssa[1] = {{
+	.name = { 0xbf, 0xc6, 0xd3, 0xcd, 0xcd, 0xbb, 0xff }, // "ELYSSA"
+	.is_female = 1,
+	.id = 8810,
+	.sid = 0, // TODO
+}};
+gba_trainer_t const reyley[1] = {{
+	.name = { 0xcc, 0xbf, 0xd3, 0xc6, 0xbf, 0xd3, 0xff }, // "REYLEY"
+	.is_female = 0,
+	.id = 1985,
+	.sid = 0, // TODO
+}};
+gba_trainer_t const saige[1] = {{
+	.name = { 0xcd, 0xbb, 0xc3, 0xc1, 0xbf, 0xff, 0x00 }, // "SAIGE"
+	.is_female = 1,
+	.id = 63184,
+	.sid = 0, // TODO
+}};
+
+// Name lookup. The helpers below are shared with tools/pokemon-data-hash.c, which includes this
+// file with POKEMON_DATA_HASH_GENERATOR defined to build the tables before the library exists.
+enum {
+	POKEMON_DATA_KEY_MAX = 32,
+};
+static size_t pokemon_data_normalize(char *const dst, size_t const size, char const *const name) {
+	size_t len = 0;
+	uint8_t sep = 0; // separators become one '_', and only between other characters
+	for(unsigned char const *c = (unsigned char const *)name; *c; c++) {
+		char out = 0;
+		if(c[0] >= 'a' && c[0] <= 'z') out = c[0] - 'a' + 'A';
+		else if((c[0] >= 'A' && c[0] <= 'Z') || (c[0] >= '0' && c[0] <= '9')) out = c[0];
+		else if(' ' == c[0] || '.' == c[0] || '-' == c[0] || '_' == c[0] || '/' == c[0]) { sep = len > 0; }
+		else if('\'' == c[0]) {}
+		else if(0xe2 == c[0] && 0x80 == c[1] && 0x99 == c[2]) { c += 2; } // ’
+		else if(0xe2 == c[0] && 0x99 == c[1] && 0x80 == c[2]) { out = 'F'; c += 2; } // ♀
+		else if(0xe2 == c[0] && 0x99 == c[1] && 0x82 == c[2]) { out = 'M'; c += 2; } // ♂
+		else if(0xc3 == c[0] && (0x89 == c[1] || 0xa9 == c[1])) { out = 'E'; c += 1; } // É é
+		else out = (char)c[0];
+		if(!out) continue;
+		if(len+1+sep >= size) return 0;
+		if(sep) dst[len++] = '_';
+		sep = 0;
+		dst[len++] = out;
+	}
+	dst[len] = '\0';
+	return len;
+}
+static uint64_t pokemon_data_hash(char const *const key, size_t const len) {
+	uint64_t h = 0xcbf29ce484222325; // FNV-1a
+	for(size_t i = 0; i < len; i++) { h ^= (unsigned char)key[i]; h *= 0x100000001b3; }
+	return h;
+}
+static uint32_t pokemon_data_hash_slot(uint64_t const hash, uint32_t const seed, uint32_t const size) {
+	uint64_t x = hash + seed * 0x9e3779b97f4a7c15; // splitmix64 finalizer
+	x ^= x >> 30; x *= 0xbf58476d1ce4e5b9;
+	x ^= x >> 27; x *= 0x94d049bb133111eb;
+	x ^= x >> 31;
+	return (uint32_t)(x % size);
+}
+
+#ifndef POKEMON_DATA_HASH_GENERATOR
+#include "pokemon_data_hash.h"
+typedef struct {
+	uint32_t buckets;
+	uint32_t size;
+	uint16_t const *seed;
+	uint16_t const *id;
+	uint16_t const *key;
+	char const *keys;
+} pokemon_data_hash_t;
+static int pokemon_data_lookup(pokemon_data_hash_t const *const table, char const *const name) {
+	char key[POKEMON_DATA_KEY_MAX];
+	size_t const len = pokemon_data_normalize(key, sizeof(key), name);
+	if(!len) return -1;
+	uint64_t const hash = pokemon_data_hash(key, len);
+	uint32_t const slot = pokemon_data_hash_slot(hash, table->seed[(hash >> 32) % table->buckets], table->size);
+	if(0 != strcmp(key, table->keys + table->key[slot])) return -1;
+	return table->id[slot];
+}
+#define XX(name, buckets, size) \
+	static pokemon_data_hash_t const name##_hash[1] = {{ buckets, size, name##_hash_seed, name##_hash_id, name##_hash_key, name##_hash_keys }};
+POKEMON_DATA_HASHES(XX)
+#undef XX
+int species_lookup(char const *const name) { return pokemon_data_lookup(species_hash, name); }
+int move_lookup(char const *const name) { return pokemon_data_lookup(moves_hash, name); }
+int item_lookup(char const *const name) { return pokemon_data_lookup(items_hash, name); }
+int location_lookup(char const *const name) { return pokemon_data_lookup(locations_hash, name); }
+#endif
@@ -0,0 +1,45 @@
+//Save object allocation
+
+#include "types.h"
+#include "save_alloc.h"
+#include <stdlib.h>
+
+static void *save_alloc_malloc(size_t size, void *user) {
+	(void)user;
+	return malloc(size);
+}
+
+static void save_alloc_free_malloc(void *ptr, size_t size, void *user) {
+	(void)size;
+	(void)user;
+	free(ptr);
+}
+
+static const save_allocator_t save_alloc_default = { save_alloc_malloc, save_alloc_free_malloc, NULL };
+
+/**
+ * @brief Allocates a save object block.
+ * @param owner Receives how to free the block, kept in the object.
+ * @param allocator The allocator, NULL for malloc().
+ * @param size The size of the block.
+ * @return The block, or NULL if out of memory.
+ */
+void *save_alloc(save_allocator_t *owner, const save_allocator_t *allocator, size_t size) {
+	if(!allocator) {
+		allocator = &save_alloc_default;
+	}
+	*owner = *allocator;
+	return allocator->alloc(size, allocator->user);
+}
+
+/**
+ * @brief Frees a save object block.
+ * @param owner How the block was allocated, the block is the caller's if it has no free.
+ * @param ptr The block.
+ * @param size The size of the block.
+ */
+void save_alloc_free(const save_allocator_t *owner, void *ptr, size_t size) {
+	if(owner->free) {
+		owner->free(ptr, size, owner->user);
+	}
+}
@@ -0,0 +1,566 @@
+//Deduplicating save archive
+
+//open, pread and pwrite are POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+
+#include "types.h"
+#include "save_archive.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum {
+	SAVE_ARCHIVE_VERSION = 1,
+	//runs shorter than this are cheaper as literals
+	SAVE_ARCHIVE_MIN_RUN = 3,
+	SAVE_ARCHIVE_MAX_RUN = 0x82,
+	SAVE_ARCHIVE_MAX_LITERALS = 0x80
+};
+
+static const char SAVE_ARCHIVE_MAGIC[8] = { 'L', 'S', 'A', 'R', 'C', 'H', 'V', 0 };
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t chunk_size;
+	uint64_t index_offset;
+	uint32_t save_count;
+	uint32_t chunk_count;
+	uint32_t ref_count;
+	uint32_t reserved;
+} save_archive_header_t;
+
+//the index holds these for every chunk, then every save, then the chunk numbers of every save
+typedef struct {
+	uint64_t offset;
+	uint64_t hash;
+	//the stored size, SAVE_ARCHIVE_CHUNK_SIZE for a chunk that didn't compress
+	uint32_t size;
+	uint32_t reserved;
+	uint8_t trailer[SAVE_ARCHIVE_TRAILER_SIZE];
+} save_archive_chunk_t;
+
+typedef struct {
+	uint32_t size;
+	//where the chunk numbers of the save start
+	uint32_t first;
+} save_archive_save_t;
+
+struct save_archive_writer {
+	int fd;
+	//where the next chunk is written
+	uint64_t tail;
+	save_archive_chunk_t *chunks;
+	size_t chunk_count;
+	size_t chunk_capacity;
+	save_archive_save_t *saves;
+	size_t save_count;
+	size_t save_capacity;
+	uint32_t *refs;
+	size_t ref_count;
+	size_t ref_capacity;
+	//chunk number + 1 by hash, 0 for empty
+	uint32_t *table;
+	size_t table_mask;
+};
+
+struct save_archive {
+	int fd;
+	save_archive_header_t header;
+	save_archive_chunk_t *chunks;
+	save_archive_save_t *saves;
+	uint32_t *refs;
+};
+
+static uint64_t save_archive_hash(const uint8_t *chunk) {
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for(size_t i = 0; i < SAVE_ARCHIVE_CHUNK_SIZE; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, chunk + i, sizeof(word));
+		hash = (hash ^ word) * 0x100000001B3ULL;
+		hash ^= hash >> 29;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/**
+ * A control byte below 0x80 is followed by that many + 1 bytes to copy, from 0x80 it is followed
+ * by one byte to repeat control - 0x7D times.
+ * @brief Run length encodes a chunk.
+ * @param out Receives the encoded chunk, SAVE_ARCHIVE_CHUNK_SIZE bytes.
+ * @param in The chunk.
+ * @return The encoded size, SAVE_ARCHIVE_CHUNK_SIZE if encoding didn't make it smaller.
+ */
+static size_t save_archive_pack(uint8_t *out, const uint8_t *in) {
+	const size_t size = SAVE_ARCHIVE_CHUNK_SIZE;
+	size_t o = 0;
+	for(size_t i = 0; i < size;) {
+		size_t run = 1;
+		while(i + run < size && run < SAVE_ARCHIVE_MAX_RUN && in[i + run] == in[i]) {
+			++run;
+		}
+		if(run >= SAVE_ARCHIVE_MIN_RUN) {
+			if(o + 2 >= size) {
+				return size;
+			}
+			out[o++] = 0x7D + run;
+			out[o++] = in[i];
+			i += run;
+			continue;
+		}
+		size_t start = i;
+		while(i < size && i - start < SAVE_ARCHIVE_MAX_LITERALS) {
+			if(i + 2 < size && in[i] == in[i + 1] && in[i] == in[i + 2]) {
+				break;
+			}
+			++i;
+		}
+		if(o + 1 + i - start >= size) {
+			return size;
+		}
+		out[o++] = i - start - 1;
+		memcpy(out + o, in + start, i - start);
+		o += i - start;
+	}
+	return o;
+}
+
+static int save_archive_unpack(uint8_t *out, const uint8_t *in, size_t in_size) {
+	size_t o = 0;
+	for(size_t i = 0; i < in_size;) {
+		uint8_t control = in[i++];
+		if(control < 0x80) {
+			size_t count = control + 1;
+			if(i + count > in_size || o + count > SAVE_ARCHIVE_CHUNK_SIZE) {
+				return -1;
+			}
+			memcpy(out + o, in + i, count);
+			i += count;
+			o += count;
+		} else {
+			size_t count = control - 0x7D;
+			if(i >= in_size || o + count > SAVE_ARCHIVE_CHUNK_SIZE) {
+				return -1;
+			}
+			memset(out + o, in[i++], count);
+			o += count;
+		}
+	}
+	return o == SAVE_ARCHIVE_CHUNK_SIZE ? 0 : -1;
+}
+
+static int save_archive_pread(int fd, void *buf, size_t size, uint64_t offset) {
+	uint8_t *ptr = buf;
+	while(size) {
+		ssize_t got = pread(fd, ptr, size, offset);
+		if(got <= 0) {
+			return -1;
+		}
+		ptr += got;
+		size -= got;
+		offset += got;
+	}
+	return 0;
+}
+
+static int save_archive_pwrite(int fd, const void *buf, size_t size, uint64_t offset) {
+	const uint8_t *ptr = buf;
+	while(size) {
+		ssize_t put = pwrite(fd, ptr, size, offset);
+		if(put <= 0) {
+			return -1;
+		}
+		ptr += put;
+		size -= put;
+		offset += put;
+	}
+	return 0;
+}
+
+//makes room for needed items in a growing array
+static int save_archive_reserve(void **array, size_t *capacity, size_t needed, size_t item) {
+	if(needed <= *capacity) {
+		return 0;
+	}
+	size_t grown = *capacity ? *capacity * 2 : 64;
+	while(grown < needed) {
+		grown *= 2;
+	}
+	void *ptr = realloc(*array, grown * item);
+	if(!ptr) {
+		return -1;
+	}
+	*array = ptr;
+	*capacity = grown;
+	return 0;
+}
+
+/**
+ * @brief Creates an archive to add saves to. It isn't readable until save_archive_finish().
+ * @param path The archive file, replaced if it exists.
+ * @return The writer, or NULL if the file couldn't be created.
+ */
+save_archive_writer_t *save_archive_create(const char *path) {
+	save_archive_writer_t *writer = calloc(1, sizeof(save_archive_writer_t));
+	if(!writer) {
+		return NULL;
+	}
+	writer->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	writer->table_mask = 0xFF;
+	writer->table = calloc(writer->table_mask + 1, sizeof(uint32_t));
+	if(writer->fd < 0 || !writer->table) {
+		if(writer->fd >= 0) {
+			close(writer->fd);
+		}
+		free(writer->table);
+		free(writer);
+		return NULL;
+	}
+	writer->tail = sizeof(save_archive_header_t);
+	return writer;
+}
+
+static int save_archive_same(const save_archive_writer_t *writer, const save_archive_chunk_t *chunk, const uint8_t *stored) {
+	uint8_t buf[SAVE_ARCHIVE_CHUNK_SIZE];
+	if(save_archive_pread(writer->fd, buf, chunk->size, chunk->offset)) {
+		return 0;
+	}
+	return !memcmp(buf, stored, chunk->size);
+}
+
+static int save_archive_rehash(save_archive_writer_t *writer) {
+	size_t mask = writer->table_mask * 2 + 1;
+	uint32_t *table = calloc(mask + 1, sizeof(uint32_t));
+	if(!table) {
+		return -1;
+	}
+	for(size_t i = 0; i < writer->chunk_count; ++i) {
+		size_t slot = writer->chunks[i].hash & mask;
+		while(table[slot]) {
+			slot = (slot + 1) & mask;
+		}
+		table[slot] = i + 1;
+	}
+	free(writer->table);
+	writer->table = table;
+	writer->table_mask = mask;
+	return 0;
+}
+
+//finds or writes a chunk, giving its number
+static int64_t save_archive_put_chunk(save_archive_writer_t *writer, const uint8_t *chunk) {
+	uint8_t packed[SAVE_ARCHIVE_CHUNK_SIZE];
+	uint64_t hash = save_archive_hash(chunk);
+	size_t size = save_archive_pack(packed, chunk);
+	const uint8_t *stored = size < SAVE_ARCHIVE_CHUNK_SIZE ? packed : chunk;
+	//at most half full
+	if((writer->chunk_count + 1) * 2 > writer->table_mask + 1 && save_archive_rehash(writer)) {
+		return -1;
+	}
+	size_t slot = hash & writer->table_mask;
+	for(; writer->table[slot]; slot = (slot + 1) & writer->table_mask) {
+		size_t id = writer->table[slot] - 1;
+		if(writer->chunks[id].hash == hash && writer->chunks[id].size == size && save_archive_same(writer, &writer->chunks[id], stored)) {
+			return id;
+		}
+	}
+	if(writer->chunk_count >= UINT32_MAX - 1
+			|| save_archive_reserve((void **)&writer->chunks, &writer->chunk_capacity, writer->chunk_count + 1, sizeof(save_archive_chunk_t))) {
+		return -1;
+	}
+	if(save_archive_pwrite(writer->fd, stored, size, writer->tail)) {
+		return -1;
+	}
+	size_t id = writer->chunk_count++;
+	save_archive_chunk_t *entry = &writer->chunks[id];
+	entry->offset = writer->tail;
+	entry->hash = hash;
+	entry->size = size;
+	entry->reserved = 0;
+	memcpy(entry->trailer, chunk + SAVE_ARCHIVE_CHUNK_SIZE - SAVE_ARCHIVE_TRAILER_SIZE, SAVE_ARCHIVE_TRAILER_SIZE);
+	writer->table[slot] = id + 1;
+	writer->tail += size;
+	return id;
+}
+
+/**
+ * @brief Adds a save to an archive.
+ * @param writer The archive being written.
+ * @param data The save file.
+ * @param size The size of the save file.
+ * @return The number of the save in the archive, or -1 if it couldn't be written.
+ */
+int save_archive_add(save_archive_writer_t *writer, const uint8_t *data, size_t size) {
+	size_t count = (size + SAVE_ARCHIVE_CHUNK_SIZE - 1) / SAVE_ARCHIVE_CHUNK_SIZE;
+	if(size > UINT32_MAX || writer->save_count >= INT32_MAX || writer->ref_count + count > UINT32_MAX
+			|| save_archive_reserve((void **)&writer->saves, &writer->save_capacity, writer->save_count + 1, sizeof(save_archive_save_t))
+			|| save_archive_reserve((void **)&writer->refs, &writer->ref_capacity, writer->ref_count + count, sizeof(uint32_t))) {
+		return -1;
+	}
+	uint8_t chunk[SAVE_ARCHIVE_CHUNK_SIZE];
+	for(size_t i = 0; i < count; ++i) {
+		size_t offset = i * SAVE_ARCHIVE_CHUNK_SIZE;
+		size_t length = size - offset < SAVE_ARCHIVE_CHUNK_SIZE ? size - offset : SAVE_ARCHIVE_CHUNK_SIZE;
+		memcpy(chunk, data + offset, length);
+		memset(chunk + length, 0, SAVE_ARCHIVE_CHUNK_SIZE - length);
+		int64_t id = save_archive_put_chunk(writer, chunk);
+		if(id < 0) {
+			return -1;
+		}
+		writer->refs[writer->ref_count + i] = id;
+	}
+	writer->saves[writer->save_count].size = size;
+	writer->saves[writer->save_count].first = writer->ref_count;
+	writer->ref_count += count;
+	return writer->save_count++;
+}
+
+/**
+ * Any of the results may be NULL.
+ * @brief Gets how much an archive has saved so far.
+ * @param writer The archive being written.
+ * @param chunks Receives the number of chunks in the saves added.
+ * @param unique Receives the number of different chunks, the ones stored.
+ * @param bytes Receives the size of the stored chunks, after encoding.
+ */
+void save_archive_writer_stats(const save_archive_writer_t *writer, size_t *chunks, size_t *unique, uint64_t *bytes) {
+	if(chunks) {
+		*chunks = writer->ref_count;
+	}
+	if(unique) {
+		*unique = writer->chunk_count;
+	}
+	if(bytes) {
+		*bytes = writer->tail - sizeof(save_archive_header_t);
+	}
+}
+
+/**
+ * The writer is freed even if writing fails.
+ * @brief Writes the index of an archive and closes it.
+ * @param writer The archive being written.
+ * @return 0 on success, -1 if the index couldn't be written.
+ */
+int save_archive_finish(save_archive_writer_t *writer) {
+	save_archive_header_t header = { 0 };
+	memcpy(header.magic, SAVE_ARCHIVE_MAGIC, sizeof(SAVE_ARCHIVE_MAGIC));
+	header.version = SAVE_ARCHIVE_VERSION;
+	header.chunk_size = SAVE_ARCHIVE_CHUNK_SIZE;
+	header.index_offset = writer->tail;
+	header.save_count = writer->save_count;
+	header.chunk_count = writer->chunk_count;
+	header.ref_count = writer->ref_count;
+	uint64_t offset = writer->tail;
+	size_t chunks = writer->chunk_count * sizeof(save_archive_chunk_t);
+	size_t saves = writer->save_count * sizeof(save_archive_save_t);
+	int result = 0;
+	//the header goes last, so an archive cut short is never mistaken for a whole one
+	if((chunks && save_archive_pwrite(writer->fd, writer->chunks, chunks, offset))
+			|| (saves && save_archive_pwrite(writer->fd, writer->saves, saves, offset + chunks))
+			|| (writer->ref_count && save_archive_pwrite(writer->fd, writer->refs, writer->ref_count * sizeof(uint32_t), offset + chunks + saves))
+			|| save_archive_pwrite(writer->fd, &header, sizeof(header), 0)) {
+		result = -1;
+	}
+	if(close(writer->fd)) {
+		result = -1;
+	}
+	free(writer->chunks);
+	free(writer->saves);
+	free(writer->refs);
+	free(writer->table);
+	free(writer);
+	return result;
+}
+
+/**
+ * The index is read into memory, the chunks are read as they are needed.
+ * @brief Opens an archive for reading.
+ * @param path The archive file.
+ * @return The archive, or NULL if the file couldn't be read or isn't a whole archive.
+ */
+save_archive_t *save_archive_open(const char *path) {
+	save_archive_t *archive = calloc(1, sizeof(save_archive_t));
+	if(!archive) {
+		return NULL;
+	}
+	archive->fd = open(path, O_RDONLY);
+	struct stat st;
+	save_archive_header_t *header = &archive->header;
+	if(archive->fd < 0 || fstat(archive->fd, &st) || save_archive_pread(archive->fd, header, sizeof(*header), 0)
+			|| memcmp(header->magic, SAVE_ARCHIVE_MAGIC, sizeof(SAVE_ARCHIVE_MAGIC))
+			|| header->version != SAVE_ARCHIVE_VERSION || header->chunk_size != SAVE_ARCHIVE_CHUNK_SIZE) {
+		goto fail;
+	}
+	uint64_t chunks = (uint64_t)header->chunk_count * sizeof(save_archive_chunk_t);
+	uint64_t saves = (uint64_t)header->save_count * sizeof(save_archive_save_t);
+	uint64_t refs = (uint64_t)header->ref_count * sizeof(uint32_t);
+	if(header->index_offset + chunks + saves + refs > (uint64_t)st.st_size) {
+		goto fail;
+	}
+	//one allocation for the whole index, chunks first so it is aligned
+	uint8_t *index = malloc(chunks + saves + refs + 1);
+	if(!index) {
+		goto fail;
+	}
+	archive->chunks = (save_archive_chunk_t *)index;
+	archive->saves = (save_archive_save_t *)(index + chunks);
+	archive->refs = (uint32_t *)(index + chunks + saves);
+	if(save_archive_pread(archive->fd, index, chunks + saves + refs, header->index_offset)) {
+		goto fail;
+	}
+	for(size_t i = 0; i < header->chunk_count; ++i) {
+		const save_archive_chunk_t *chunk = &archive->chunks[i];
+		if(chunk->size > SAVE_ARCHIVE_CHUNK_SIZE || chunk->offset + chunk->size > header->index_offset) {
+			goto fail;
+		}
+	}
+	for(size_t i = 0; i < header->ref_count; ++i) {
+		if(archive->refs[i] >= header->chunk_count) {
+			goto fail;
+		}
+	}
+	for(size_t i = 0; i < header->save_count; ++i) {
+		const save_archive_save_t *save = &archive->saves[i];
+		uint64_t count = ((uint64_t)save->size + SAVE_ARCHIVE_CHUNK_SIZE - 1) / SAVE_ARCHIVE_CHUNK_SIZE;
+		if(save->first + count > header->ref_count) {
+			goto fail;
+		}
+	}
+	return archive;
+fail:
+	save_archive_close(archive);
+	return NULL;
+}
+
+/**
+ * @brief Closes an archive.
+ * @param archive The archive to close.
+ */
+void save_archive_close(save_archive_t *archive) {
+	if(archive->fd >= 0) {
+		close(archive->fd);
+	}
+	free(archive->chunks);
+	free(archive);
+}
+
+/**
+ * @brief Gets the number of saves in an archive.
+ * @param archive The archive.
+ * @return The number of saves.
+ */
+size_t save_archive_count(const save_archive_t *archive) {
+	return archive->header.save_count;
+}
+
+/**
+ * @brief Gets the size of a save in an archive.
+ * @param archive The archive.
+ * @param save The number of the save.
+ * @return The size of the save file, 0 if there is no such save.
+ */
+size_t save_archive_size(const save_archive_t *archive, size_t save) {
+	if(save >= archive->header.save_count) {
+		return 0;
+	}
+	return archive->saves[save].size;
+}
+
+//gets the chunk entry of a chunk of a save
+static const save_archive_chunk_t *save_archive_chunk(const save_archive_t *archive, size_t save, size_t chunk) {
+	if(save >= archive->header.save_count) {
+		return NULL;
+	}
+	const save_archive_save_t *entry = &archive->saves[save];
+	if(chunk >= ((size_t)entry->size + SAVE_ARCHIVE_CHUNK_SIZE - 1) / SAVE_ARCHIVE_CHUNK_SIZE) {
+		return NULL;
+	}
+	return &archive->chunks[archive->refs[entry->first + chunk]];
+}
+
+/**
+ * @brief Reads one chunk of a save from an archive, decoding only that chunk.
+ * @param archive The archive.
+ * @param save The number of the save.
+ * @param chunk The chunk of the save, the one at byte chunk * SAVE_ARCHIVE_CHUNK_SIZE.
+ * @param out Receives the chunk, SAVE_ARCHIVE_CHUNK_SIZE bytes.
+ * @return 0 on success, -1 if there is no such chunk or it couldn't be read.
+ */
+int save_archive_read_chunk(const save_archive_t *archive, size_t save, size_t chunk, uint8_t *out) {
+	const save_archive_chunk_t *entry = save_archive_chunk(archive, save, chunk);
+	if(!entry) {
+		return -1;
+	}
+	if(entry->size == SAVE_ARCHIVE_CHUNK_SIZE) {
+		return save_archive_pread(archive->fd, out, SAVE_ARCHIVE_CHUNK_SIZE, entry->offset);
+	}
+	uint8_t packed[SAVE_ARCHIVE_CHUNK_SIZE];
+	if(save_archive_pread(archive->fd, packed, entry->size, entry->offset)) {
+		return -1;
+	}
+	return save_archive_unpack(out, packed, entry->size);
+}
+
+/**
+ * @brief Reads part of a save from an archive, decoding only the chunks it covers.
+ * @param archive The archive.
+ * @param save The number of the save.
+ * @param offset The first byte to read.
+ * @param size The number of bytes to read.
+ * @param out Receives the bytes.
+ * @return 0 on success, -1 if the range is outside the save or couldn't be read.
+ */
+int save_archive_read_range(const save_archive_t *archive, size_t save, size_t offset, size_t size, uint8_t *out) {
+	size_t total = save_archive_size(archive, save);
+	if(save >= archive->header.save_count || offset > total || size > total - offset) {
+		return -1;
+	}
+	uint8_t chunk[SAVE_ARCHIVE_CHUNK_SIZE];
+	while(size) {
+		size_t index = offset / SAVE_ARCHIVE_CHUNK_SIZE;
+		size_t skip = offset % SAVE_ARCHIVE_CHUNK_SIZE;
+		size_t length = SAVE_ARCHIVE_CHUNK_SIZE - skip < size ? SAVE_ARCHIVE_CHUNK_SIZE - skip : size;
+		if(length == SAVE_ARCHIVE_CHUNK_SIZE) {
+			if(save_archive_read_chunk(archive, save, index, out)) {
+				return -1;
+			}
+		} else {
+			if(save_archive_read_chunk(archive, save, index, chunk)) {
+				return -1;
+			}
+			memcpy(out, chunk + skip, length);
+		}
+		out += length;
+		offset += length;
+		size -= length;
+	}
+	return 0;
+}
+
+/**
+ * @brief Reads a whole save from an archive.
+ * @param archive The archive.
+ * @param save The number of the save.
+ * @param out Receives the save, save_archive_size() bytes.
+ * @return 0 on success, -1 if there is no such save or it couldn't be read.
+ */
+int save_archive_read(const save_archive_t *archive, size_t save, uint8_t *out) {
+	return save_archive_read_range(archive, save, 0, save_archive_size(archive, save), out);
+}
+
+/**
+ * @brief Gets the end of a chunk of a save from the archive index, without reading the chunk.
+ * @param archive The archive.
+ * @param save The number of the save.
+ * @param chunk The chunk of the save.
+ * @return The last SAVE_ARCHIVE_TRAILER_SIZE bytes of the chunk, or NULL if there is no such chunk.
+ */
+const uint8_t *save_archive_trailer(const save_archive_t *archive, size_t save, size_t chunk) {
+	const save_archive_chunk_t *entry = save_archive_chunk(archive, save, chunk);
+	return entry ? entry->trailer : NULL;
+}
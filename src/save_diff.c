@@ -0,0 +1,43 @@
+//Field by field comparison for the save diffs
+
+#include "types.h"
+#include "save_diff.h"
+#include <string.h>
+
+static uint32_t save_diff_value(const uint8_t *ptr, size_t size) {
+	uint32_t value = 0;
+	for(size_t i = size > 4 ? 4 : size; i-- > 0;) {
+		value = value << 8 | ptr[i];
+	}
+	return value;
+}
+
+/**
+ * @brief Compares the fields of two copies of a structure and reports the ones that differ.
+ * @param fields The fields to compare.
+ * @param count The number of fields.
+ * @param diff The area, group and index to report, the rest is filled in for each field.
+ * @param a The old structure.
+ * @param b The new structure.
+ * @param fn Called with each field that differs.
+ * @param user Passed to fn.
+ * @return The number of fields that differ.
+ */
+size_t save_diff_fields(const save_diff_field_t *fields, size_t count, save_diff_t *diff, const uint8_t *a, const uint8_t *b, save_diff_fn_t fn, void *user) {
+	size_t found = 0;
+	for(size_t i = 0; i < count; ++i) {
+		const save_diff_field_t *field = &fields[i];
+		if(!memcmp(a + field->offset, b + field->offset, field->size)) {
+			continue;
+		}
+		diff->field = field->name;
+		diff->old_data = a + field->offset;
+		diff->new_data = b + field->offset;
+		diff->size = field->size;
+		diff->old_value = save_diff_value(diff->old_data, field->size);
+		diff->new_value = save_diff_value(diff->new_data, field->size);
+		fn(diff, user);
+		++found;
+	}
+	return found;
+}
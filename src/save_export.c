@@ -0,0 +1,346 @@
+//Party and PC record exporter
+
+#include "types.h"
+#include "save_export.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	//the output buffer, flushed with one fwrite when a record might not fit
+	SAVE_EXPORT_BUFFER = 1 << 20,
+	//more than the longest CSV or JSON record, every name escaped at 6 bytes a character
+	SAVE_EXPORT_RECORD_MAX = 2048
+};
+
+typedef struct {
+	const char *name;
+	uint16_t offset;
+	uint8_t size;
+	uint8_t kind;
+} save_export_column_t;
+
+#define SAVE_EXPORT_FIELD(name, member, kind) { name, offsetof(save_export_record_t, member), sizeof(((save_export_record_t *)0)->member), kind }
+
+static const save_export_column_t SAVE_EXPORT_FIELDS[] = {
+	SAVE_EXPORT_FIELD("save", save, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("generation", generation, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("box", box, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("slot", slot, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("level", level, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("pid", pid, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("ot_id", ot_id, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("ot_sid", ot_sid, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("species", species, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("held_item", held_item, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("exp", exp, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("friendship", friendship, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("is_egg", is_egg, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("checksum_ok", checksum_ok, SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("move1", move[0], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("move2", move[1], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("move3", move[2], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("move4", move[3], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("iv_hp", iv[0], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("iv_atk", iv[1], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("iv_def", iv[2], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("iv_spd", iv[3], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("iv_satk", iv[4], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("iv_sdef", iv[5], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("ev_hp", ev[0], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("ev_atk", ev[1], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("ev_def", ev[2], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("ev_spd", ev[3], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("ev_satk", ev[4], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("ev_sdef", ev[5], SAVE_EXPORT_UINT),
+	SAVE_EXPORT_FIELD("nickname", nickname, SAVE_EXPORT_TEXT),
+	SAVE_EXPORT_FIELD("ot_name", ot_name, SAVE_EXPORT_TEXT)
+};
+
+enum {
+	SAVE_EXPORT_COLUMN_COUNT = sizeof(SAVE_EXPORT_FIELDS) / sizeof(*SAVE_EXPORT_FIELDS)
+};
+
+//every number from 00 to 99, so integers are written two digits at a time
+static const char SAVE_EXPORT_DIGITS[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+struct save_export {
+	FILE *out;
+	save_export_format_t format;
+	uint8_t *buffer;
+	size_t used;
+	//the column file's current group, SAVE_EXPORT_GROUP values of each column in turn
+	uint8_t *group;
+	size_t rows;
+	uint64_t count;
+	int failed;
+};
+
+static void save_export_flush(save_export_t *exporter) {
+	if(exporter->used && fwrite(exporter->buffer, 1, exporter->used, exporter->out) != exporter->used) {
+		exporter->failed = 1;
+	}
+	exporter->used = 0;
+}
+
+static void save_export_write(save_export_t *exporter, const void *data, size_t size) {
+	if(exporter->used + size > SAVE_EXPORT_BUFFER) {
+		save_export_flush(exporter);
+		if(size > SAVE_EXPORT_BUFFER) {
+			if(fwrite(data, 1, size, exporter->out) != size) {
+				exporter->failed = 1;
+			}
+			return;
+		}
+	}
+	memcpy(exporter->buffer + exporter->used, data, size);
+	exporter->used += size;
+}
+
+static char *save_export_u32(char *dst, uint32_t value) {
+	char digits[10];
+	char *ptr = digits + sizeof(digits);
+	while(value >= 100) {
+		ptr -= 2;
+		memcpy(ptr, &SAVE_EXPORT_DIGITS[value % 100 * 2], 2);
+		value /= 100;
+	}
+	if(value >= 10) {
+		ptr -= 2;
+		memcpy(ptr, &SAVE_EXPORT_DIGITS[value * 2], 2);
+	} else {
+		*--ptr = '0' + value;
+	}
+	size_t size = digits + sizeof(digits) - ptr;
+	memcpy(dst, ptr, size);
+	return dst + size;
+}
+
+static uint32_t save_export_value(const uint8_t *ptr, size_t size) {
+	if(size == 1) {
+		return *ptr;
+	}
+	if(size == 2) {
+		uint16_t value;
+		memcpy(&value, ptr, 2);
+		return value;
+	}
+	uint32_t value;
+	memcpy(&value, ptr, 4);
+	return value;
+}
+
+//stores the low size bytes of the value little endian, whatever the host order
+static void save_export_store(uint8_t *dst, uint32_t value, size_t size) {
+	for(size_t i = 0; i < size; ++i) {
+		dst[i] = value >> 8 * i;
+	}
+}
+
+//writes the text as UTF-8, escaped for the format, characters the game can't show become U+FFFD
+static char *save_export_text(char *dst, const char16_t *text, size_t length, save_export_format_t format) {
+	static const char HEX[] = "0123456789abcdef";
+	for(size_t i = 0; i < length && text[i]; ++i) {
+		uint32_t c = text[i];
+		if(c == 0xFFFF || (c >= 0xD800 && c < 0xE000)) {
+			c = 0xFFFD;
+		}
+		if(c == '"') {
+			*dst++ = format == SAVE_EXPORT_CSV ? '"' : '\\';
+			*dst++ = '"';
+		} else if(format == SAVE_EXPORT_JSONL && c == '\\') {
+			*dst++ = '\\';
+			*dst++ = '\\';
+		} else if(format == SAVE_EXPORT_JSONL && c < 0x20) {
+			memcpy(dst, "\\u00", 4);
+			dst[4] = HEX[c >> 4];
+			dst[5] = HEX[c & 0xF];
+			dst += 6;
+		} else if(c < 0x80) {
+			*dst++ = c;
+		} else if(c < 0x800) {
+			*dst++ = 0xC0 | c >> 6;
+			*dst++ = 0x80 | (c & 0x3F);
+		} else {
+			*dst++ = 0xE0 | c >> 12;
+			*dst++ = 0x80 | (c >> 6 & 0x3F);
+			*dst++ = 0x80 | (c & 0x3F);
+		}
+	}
+	return dst;
+}
+
+static void save_export_line(save_export_t *exporter, const save_export_record_t *record) {
+	if(exporter->used + SAVE_EXPORT_RECORD_MAX > SAVE_EXPORT_BUFFER) {
+		save_export_flush(exporter);
+	}
+	char *start = (char *)exporter->buffer + exporter->used;
+	char *dst = start;
+	uint8_t json = exporter->format == SAVE_EXPORT_JSONL;
+	if(json) {
+		*dst++ = '{';
+	}
+	for(size_t i = 0; i < SAVE_EXPORT_COLUMN_COUNT; ++i) {
+		const save_export_column_t *column = &SAVE_EXPORT_FIELDS[i];
+		const uint8_t *field = (const uint8_t *)record + column->offset;
+		if(i) {
+			*dst++ = ',';
+		}
+		if(json) {
+			size_t size = strlen(column->name);
+			*dst++ = '"';
+			memcpy(dst, column->name, size);
+			dst += size;
+			*dst++ = '"';
+			*dst++ = ':';
+		}
+		if(column->kind == SAVE_EXPORT_TEXT) {
+			*dst++ = '"';
+			dst = save_export_text(dst, (const char16_t *)field, column->size / sizeof(char16_t), exporter->format);
+			*dst++ = '"';
+		} else {
+			dst = save_export_u32(dst, save_export_value(field, column->size));
+		}
+	}
+	if(json) {
+		*dst++ = '}';
+	}
+	*dst++ = '\n';
+	exporter->used += dst - start;
+}
+
+static void save_export_group(save_export_t *exporter) {
+	size_t rows = exporter->rows;
+	uint8_t count[4];
+	save_export_store(count, rows, sizeof(count));
+	save_export_write(exporter, count, sizeof(count));
+	const uint8_t *values = exporter->group;
+	for(size_t i = 0; i < SAVE_EXPORT_COLUMN_COUNT; ++i) {
+		size_t size = SAVE_EXPORT_FIELDS[i].size;
+		save_export_write(exporter, values, rows * size);
+		values += SAVE_EXPORT_GROUP * size;
+	}
+	exporter->rows = 0;
+}
+
+static void save_export_header(save_export_t *exporter) {
+	if(exporter->format == SAVE_EXPORT_CSV) {
+		for(size_t i = 0; i < SAVE_EXPORT_COLUMN_COUNT; ++i) {
+			const char *name = SAVE_EXPORT_FIELDS[i].name;
+			if(i) {
+				save_export_write(exporter, ",", 1);
+			}
+			save_export_write(exporter, name, strlen(name));
+		}
+		save_export_write(exporter, "\n", 1);
+	} else if(exporter->format == SAVE_EXPORT_COLUMNS) {
+		uint8_t head[8];
+		save_export_store(head, 1, 4);
+		save_export_store(head + 4, SAVE_EXPORT_COLUMN_COUNT, 4);
+		save_export_write(exporter, "LSPKCOLS", 8);
+		save_export_write(exporter, head, sizeof(head));
+		for(size_t i = 0; i < SAVE_EXPORT_COLUMN_COUNT; ++i) {
+			const save_export_column_t *column = &SAVE_EXPORT_FIELDS[i];
+			uint8_t info[3] = { column->kind, column->size, strlen(column->name) };
+			save_export_write(exporter, info, sizeof(info));
+			save_export_write(exporter, column->name, info[2]);
+		}
+	}
+}
+
+/**
+ * @brief Starts an export, writing the CSV header or column file header.
+ * @param out The file to write to, left open by save_export_finish().
+ * @param format The format to write.
+ * @return The exporter, or NULL if out of memory.
+ */
+save_export_t *save_export_create(FILE *out, save_export_format_t format) {
+	save_export_t *exporter = calloc(1, sizeof(save_export_t));
+	if(!exporter) {
+		return NULL;
+	}
+	exporter->out = out;
+	exporter->format = format;
+	exporter->buffer = malloc(SAVE_EXPORT_BUFFER);
+	if(format == SAVE_EXPORT_COLUMNS) {
+		exporter->group = malloc(SAVE_EXPORT_GROUP * sizeof(save_export_record_t));
+	}
+	if(!exporter->buffer || (format == SAVE_EXPORT_COLUMNS && !exporter->group)) {
+		free(exporter->buffer);
+		free(exporter->group);
+		free(exporter);
+		return NULL;
+	}
+	save_export_header(exporter);
+	return exporter;
+}
+
+/**
+ * @brief Writes a record.
+ * @param exporter The exporter.
+ * @param record The record.
+ * @return 0 on success, -1 if writing to the file failed.
+ */
+int save_export_record(save_export_t *exporter, const save_export_record_t *record) {
+	if(exporter->format != SAVE_EXPORT_COLUMNS) {
+		save_export_line(exporter, record);
+	} else {
+		uint8_t *values = exporter->group;
+		for(size_t i = 0; i < SAVE_EXPORT_COLUMN_COUNT; ++i) {
+			const save_export_column_t *column = &SAVE_EXPORT_FIELDS[i];
+			const uint8_t *field = (const uint8_t *)record + column->offset;
+			uint8_t *dst = values + exporter->rows * column->size;
+			if(column->kind == SAVE_EXPORT_TEXT) {
+				//names are stored one char16_t at a time
+				for(size_t j = 0; j < column->size; j += sizeof(char16_t)) {
+					save_export_store(dst + j, save_export_value(field + j, sizeof(char16_t)), sizeof(char16_t));
+				}
+			} else {
+				save_export_store(dst, save_export_value(field, column->size), column->size);
+			}
+			values += SAVE_EXPORT_GROUP * column->size;
+		}
+		if(++exporter->rows == SAVE_EXPORT_GROUP) {
+			save_export_group(exporter);
+		}
+	}
+	++exporter->count;
+	return exporter->failed ? -1 : 0;
+}
+
+/**
+ * @brief Gets the number of records written.
+ * @param exporter The exporter.
+ * @return The number of records.
+ */
+uint64_t save_export_count(const save_export_t *exporter) {
+	return exporter->count;
+}
+
+/**
+ * @brief Writes what is buffered and frees the exporter.
+ * @param exporter The exporter.
+ * @return 0 on success, -1 if writing to the file failed at any point.
+ */
+int save_export_finish(save_export_t *exporter) {
+	if(exporter->format == SAVE_EXPORT_COLUMNS) {
+		if(exporter->rows) {
+			save_export_group(exporter);
+		}
+		save_export_group(exporter);
+	}
+	save_export_flush(exporter);
+	if(fflush(exporter->out)) {
+		exporter->failed = 1;
+	}
+	int failed = exporter->failed;
+	free(exporter->buffer);
+	free(exporter->group);
+	free(exporter);
+	return failed ? -1 : 0;
+}
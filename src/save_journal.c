@@ -0,0 +1,323 @@
+//Undo and redo journal for save edits
+
+#include "types.h"
+#include "save_journal.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+	//unchanged bytes between two changes shorter than this are kept in one entry, as they cost
+	//less than the entry
+	SAVE_JOURNAL_GAP = 16,
+	//a pending buffer grown past this by a large record, such as a whole PC, is let go once sealed
+	SAVE_JOURNAL_PENDING_KEEP = 0x1000
+};
+
+typedef struct {
+	uint32_t offset;
+	uint32_t size;
+	//the step the entry belongs to
+	uint32_t group;
+	//where the old bytes are in the pool, the new bytes follow them
+	size_t data;
+} save_journal_entry_t;
+
+//a recorded range not compared yet, its bytes from before the change are at data in pending
+typedef struct {
+	size_t offset;
+	size_t size;
+	size_t data;
+} save_journal_range_t;
+
+struct save_journal {
+	save_journal_entry_t *entries;
+	size_t count;
+	size_t capacity;
+	//entries before this one are applied, the ones from it on can be redone
+	size_t position;
+	uint8_t *pool;
+	size_t pool_size;
+	size_t pool_capacity;
+	//the step new entries go in
+	uint32_t group;
+	save_journal_range_t *ranges;
+	size_t range_count;
+	size_t range_capacity;
+	uint8_t *pending;
+	size_t pending_size;
+	size_t pending_capacity;
+};
+
+static int save_journal_grow(void **array, size_t *capacity, size_t needed, size_t item) {
+	if(needed <= *capacity) {
+		return 0;
+	}
+	size_t grown = *capacity ? *capacity * 2 : 64;
+	while(grown < needed) {
+		grown *= 2;
+	}
+	void *ptr = realloc(*array, grown * item);
+	if(!ptr) {
+		return -1;
+	}
+	*array = ptr;
+	*capacity = grown;
+	return 0;
+}
+
+//forgets everything, so a failed allocation never leaves a step half recorded
+static void save_journal_reset(save_journal_t *journal) {
+	journal->count = 0;
+	journal->position = 0;
+	journal->pool_size = 0;
+	journal->group = 0;
+	journal->range_count = 0;
+	journal->pending_size = 0;
+}
+
+static int save_journal_add(save_journal_t *journal, const uint8_t *old, const uint8_t *data, size_t offset, size_t size) {
+	if(save_journal_grow((void **)&journal->entries, &journal->capacity, journal->count + 1, sizeof(save_journal_entry_t))
+			|| save_journal_grow((void **)&journal->pool, &journal->pool_capacity, journal->pool_size + size * 2, 1)) {
+		return -1;
+	}
+	save_journal_entry_t *entry = &journal->entries[journal->count++];
+	entry->offset = offset;
+	entry->size = size;
+	entry->group = journal->group;
+	entry->data = journal->pool_size;
+	memcpy(journal->pool + journal->pool_size, old, size);
+	memcpy(journal->pool + journal->pool_size + size, data + offset, size);
+	journal->pool_size += size * 2;
+	journal->position = journal->count;
+	return 0;
+}
+
+//turns a recorded range into entries holding only the bytes that changed
+static int save_journal_seal_range(save_journal_t *journal, const uint8_t *data, const save_journal_range_t *range) {
+	const uint8_t *old = journal->pending + range->data;
+	const uint8_t *now = data + range->offset;
+	size_t size = range->size;
+	for(size_t i = 0; i < size;) {
+		if(old[i] == now[i]) {
+			++i;
+			continue;
+		}
+		size_t start = i, end = i + 1;
+		for(size_t j = end; j < size && j - end < SAVE_JOURNAL_GAP; ++j) {
+			if(old[j] != now[j]) {
+				end = j + 1;
+			}
+		}
+		if(save_journal_add(journal, old + start, data, range->offset + start, end - start)) {
+			return -1;
+		}
+		i = end;
+	}
+	return 0;
+}
+
+//turns every recorded range into entries
+static int save_journal_seal(save_journal_t *journal, const uint8_t *data) {
+	for(size_t i = 0; i < journal->range_count; ++i) {
+		if(save_journal_seal_range(journal, data, &journal->ranges[i])) {
+			save_journal_reset(journal);
+			return -1;
+		}
+	}
+	journal->range_count = 0;
+	journal->pending_size = 0;
+	if(journal->pending_capacity > SAVE_JOURNAL_PENDING_KEEP) {
+		free(journal->pending);
+		journal->pending = NULL;
+		journal->pending_capacity = 0;
+	}
+	return 0;
+}
+
+/**
+ * @brief Creates an empty journal.
+ * @return The journal, or NULL if out of memory.
+ */
+save_journal_t *save_journal_create(void) {
+	return calloc(1, sizeof(save_journal_t));
+}
+
+/**
+ * @brief Frees a journal.
+ * @param journal The journal to free.
+ */
+void save_journal_free(save_journal_t *journal) {
+	free(journal->entries);
+	free(journal->pool);
+	free(journal->ranges);
+	free(journal->pending);
+	free(journal);
+}
+
+//keeps the old bytes of a range that overlaps no recorded range
+static int save_journal_keep(save_journal_t *journal, const uint8_t *data, size_t offset, size_t size) {
+	save_journal_range_t *last = journal->range_count ? &journal->ranges[journal->range_count - 1] : NULL;
+	if(save_journal_grow((void **)&journal->pending, &journal->pending_capacity, journal->pending_size + size, 1)) {
+		return -1;
+	}
+	//the last range's bytes are at the end of pending, so a range next to it joins it
+	if(last && offset == last->offset + last->size) {
+		memcpy(journal->pending + journal->pending_size, data + offset, size);
+	} else if(last && offset + size == last->offset) {
+		memmove(journal->pending + last->data + size, journal->pending + last->data, last->size);
+		memcpy(journal->pending + last->data, data + offset, size);
+		last->offset = offset;
+	} else {
+		if(save_journal_grow((void **)&journal->ranges, &journal->range_capacity, journal->range_count + 1, sizeof(save_journal_range_t))) {
+			return -1;
+		}
+		last = &journal->ranges[journal->range_count++];
+		last->offset = offset;
+		last->size = 0;
+		last->data = journal->pending_size;
+		memcpy(journal->pending + last->data, data + offset, size);
+	}
+	last->size += size;
+	journal->pending_size += size;
+	return 0;
+}
+
+/**
+ * Recording a range that isn't changed, or more than is changed, is harmless.
+ * @brief Records a range of the data that is about to change.
+ * @param journal The journal.
+ * @param data The data, before the change.
+ * @param offset The first byte that may change.
+ * @param size The number of bytes that may change.
+ * @return 0 on success, -1 if out of memory, in which case the journal is emptied.
+ */
+int save_journal_record(save_journal_t *journal, const uint8_t *data, size_t offset, size_t size) {
+	if(journal->position < journal->count) {
+		//a new change, the undone steps can't be redone any more
+		journal->pool_size = journal->entries[journal->position].data;
+		journal->count = journal->position;
+	}
+	//bytes already recorded may have changed since, so only the rest of the range is kept
+	for(size_t at = offset, end = offset + size; at < end;) {
+		size_t next = end;
+		for(size_t i = 0; i < journal->range_count; ++i) {
+			const save_journal_range_t *range = &journal->ranges[i];
+			if(range->offset <= at && at < range->offset + range->size) {
+				next = at;
+				at = range->offset + range->size;
+				break;
+			}
+			if(range->offset > at && range->offset < next) {
+				next = range->offset;
+			}
+		}
+		if(next > at) {
+			if(save_journal_keep(journal, data, at, next - at)) {
+				save_journal_reset(journal);
+				return -1;
+			}
+			at = next;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Ends the current step, so the changes recorded next are undone separately.
+ * @param journal The journal.
+ * @param data The data.
+ * @return 0 on success, -1 if out of memory, in which case the journal is emptied.
+ */
+int save_journal_checkpoint(save_journal_t *journal, const uint8_t *data) {
+	if(save_journal_seal(journal, data)) {
+		return -1;
+	}
+	if(journal->position && journal->entries[journal->position - 1].group == journal->group) {
+		++journal->group;
+	}
+	return 0;
+}
+
+/**
+ * @brief Undoes the last step.
+ * @param journal The journal.
+ * @param data The data to change back.
+ * @param fn Called with every range written, may be NULL.
+ * @param user Passed to fn.
+ * @return 0 on success, -1 if there is nothing to undo.
+ */
+int save_journal_undo(save_journal_t *journal, uint8_t *data, save_journal_fn_t fn, void *user) {
+	if(save_journal_seal(journal, data) || !journal->position) {
+		return -1;
+	}
+	uint32_t group = journal->entries[journal->position - 1].group;
+	while(journal->position && journal->entries[journal->position - 1].group == group) {
+		const save_journal_entry_t *entry = &journal->entries[--journal->position];
+		memcpy(data + entry->offset, journal->pool + entry->data, entry->size);
+		if(fn) {
+			fn(entry->offset, entry->size, user);
+		}
+	}
+	journal->group = group;
+	return 0;
+}
+
+/**
+ * @brief Redoes the last step undone.
+ * @param journal The journal.
+ * @param data The data to change again.
+ * @param fn Called with every range written, may be NULL.
+ * @param user Passed to fn.
+ * @return 0 on success, -1 if there is nothing to redo.
+ */
+int save_journal_redo(save_journal_t *journal, uint8_t *data, save_journal_fn_t fn, void *user) {
+	if(save_journal_seal(journal, data) || journal->position == journal->count) {
+		return -1;
+	}
+	uint32_t group = journal->entries[journal->position].group;
+	while(journal->position < journal->count && journal->entries[journal->position].group == group) {
+		const save_journal_entry_t *entry = &journal->entries[journal->position++];
+		memcpy(data + entry->offset, journal->pool + entry->data + entry->size, entry->size);
+		if(fn) {
+			fn(entry->offset, entry->size, user);
+		}
+	}
+	journal->group = group + 1;
+	return 0;
+}
+
+/**
+ * Changes recorded since the last checkpoint count as a step, even if they turn out to change
+ * nothing.
+ * @brief Counts the steps that can be undone and redone.
+ * @param journal The journal.
+ * @param undo Receives the number of steps that can be undone, may be NULL.
+ * @param redo Receives the number of steps that can be redone, may be NULL.
+ */
+void save_journal_steps(const save_journal_t *journal, size_t *undo, size_t *redo) {
+	size_t steps[2] = { 0, 0 };
+	for(size_t i = 0; i < journal->count; ++i) {
+		if(!i || journal->entries[i].group != journal->entries[i - 1].group || i == journal->position) {
+			++steps[i >= journal->position];
+		}
+	}
+	if(journal->range_count && (!journal->position || journal->entries[journal->position - 1].group != journal->group)) {
+		++steps[0];
+	}
+	if(undo) {
+		*undo = steps[0];
+	}
+	if(redo) {
+		*redo = steps[1];
+	}
+}
+
+/**
+ * @brief Gets the memory held by a journal.
+ * @param journal The journal.
+ * @return The size in bytes.
+ */
+size_t save_journal_memory(const save_journal_t *journal) {
+	return sizeof(save_journal_t) + journal->capacity * sizeof(save_journal_entry_t) + journal->pool_capacity
+			+ journal->range_capacity * sizeof(save_journal_range_t) + journal->pending_capacity;
+}
@@ -0,0 +1,266 @@
+//Multi stage pipeline on the thread pool
+
+//pthreads and clock_gettime are POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+
+#include "types.h"
+#include "save_pipeline.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+	const char *name;
+	save_pipeline_fn_t fn;
+	void *user;
+	//items queued for the stage that haven't started it yet
+	atomic_size_t waiting;
+	atomic_uint_least64_t items;
+	atomic_uint_least64_t stopped;
+	atomic_uint_least64_t inline_runs;
+	atomic_uint_least64_t busy_ns;
+	atomic_uint_least64_t max_ns;
+} save_pipeline_stage_t;
+
+struct save_pipeline {
+	thread_pool_t *pool;
+	size_t capacity;
+	save_pipeline_stage_t *stages;
+	size_t count;
+	//stages can't be added once an item was pushed
+	atomic_int started;
+	//items pushed and not finished
+	atomic_size_t active;
+	//producers blocked in save_pipeline_push(), the first stage only wakes them if there are any
+	atomic_size_t blocked;
+	atomic_uint_least64_t push_wait_ns;
+	pthread_mutex_t lock;
+	pthread_cond_t space;
+	pthread_cond_t idle;
+};
+
+//an item on its way through the stages, this is what goes on the pool
+typedef struct {
+	save_pipeline_t *pipeline;
+	void *item;
+	size_t stage;
+} save_pipeline_ticket_t;
+
+static uint64_t save_pipeline_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void save_pipeline_task(void *arg, size_t worker);
+
+static void save_pipeline_done(save_pipeline_t *pipeline) {
+	if(atomic_fetch_sub(&pipeline->active, 1) == 1) {
+		pthread_mutex_lock(&pipeline->lock);
+		pthread_cond_broadcast(&pipeline->idle);
+		pthread_mutex_unlock(&pipeline->lock);
+	}
+}
+
+//runs stages on the ticket until one is queued on the pool, stops the item or it is finished
+static void save_pipeline_run(save_pipeline_ticket_t *ticket, size_t worker) {
+	save_pipeline_t *pipeline = ticket->pipeline;
+	for(;;) {
+		save_pipeline_stage_t *stage = &pipeline->stages[ticket->stage];
+		uint64_t start = save_pipeline_now_ns();
+		int result = stage->fn(ticket->item, worker, stage->user);
+		uint64_t elapsed = save_pipeline_now_ns() - start;
+		atomic_fetch_add(&stage->items, 1);
+		atomic_fetch_add(&stage->busy_ns, elapsed);
+		uint64_t max = atomic_load(&stage->max_ns);
+		while(elapsed > max && !atomic_compare_exchange_weak(&stage->max_ns, &max, elapsed));
+		if(result) {
+			atomic_fetch_add(&stage->stopped, 1);
+			break;
+		}
+		if(++ticket->stage == pipeline->count) {
+			break;
+		}
+		save_pipeline_stage_t *next = &pipeline->stages[ticket->stage];
+		if(atomic_fetch_add(&next->waiting, 1) < pipeline->capacity
+				&& !thread_pool_submit(pipeline->pool, save_pipeline_task, ticket)) {
+			return;
+		}
+		//the next stage is full, so this worker runs it rather than queue more
+		atomic_fetch_sub(&next->waiting, 1);
+		atomic_fetch_add(&next->inline_runs, 1);
+	}
+	free(ticket);
+	save_pipeline_done(pipeline);
+}
+
+static void save_pipeline_task(void *arg, size_t worker) {
+	save_pipeline_ticket_t *ticket = arg;
+	save_pipeline_t *pipeline = ticket->pipeline;
+	atomic_fetch_sub(&pipeline->stages[ticket->stage].waiting, 1);
+	if(!ticket->stage && atomic_load(&pipeline->blocked)) {
+		pthread_mutex_lock(&pipeline->lock);
+		pthread_cond_broadcast(&pipeline->space);
+		pthread_mutex_unlock(&pipeline->lock);
+	}
+	save_pipeline_run(ticket, worker);
+}
+
+/**
+ * @brief Creates a pipeline with no stages.
+ * @param pool The pool to run the stages on, which may run other tasks too.
+ * @param capacity The most items waiting for each stage, 0 for four per worker.
+ * @return The pipeline, or NULL if out of memory.
+ */
+save_pipeline_t *save_pipeline_create(thread_pool_t *pool, size_t capacity) {
+	save_pipeline_t *pipeline = calloc(1, sizeof(save_pipeline_t));
+	if(!pipeline) {
+		return NULL;
+	}
+	pipeline->pool = pool;
+	pipeline->capacity = capacity ? capacity : thread_pool_threads(pool) * 4;
+	atomic_init(&pipeline->started, 0);
+	atomic_init(&pipeline->active, 0);
+	atomic_init(&pipeline->blocked, 0);
+	atomic_init(&pipeline->push_wait_ns, 0);
+	pthread_mutex_init(&pipeline->lock, NULL);
+	pthread_cond_init(&pipeline->space, NULL);
+	pthread_cond_init(&pipeline->idle, NULL);
+	return pipeline;
+}
+
+/**
+ * @brief Adds a stage after the last one, before any item is pushed.
+ * @param pipeline The pipeline.
+ * @param name The stage's name for save_pipeline_stats(), not copied.
+ * @param fn The stage.
+ * @param user Passed to fn.
+ * @return The number of the stage, or -1 if items were pushed already or out of memory.
+ */
+int save_pipeline_stage(save_pipeline_t *pipeline, const char *name, save_pipeline_fn_t fn, void *user) {
+	if(atomic_load(&pipeline->started)) {
+		return -1;
+	}
+	save_pipeline_stage_t *stages = realloc(pipeline->stages, (pipeline->count + 1) * sizeof(save_pipeline_stage_t));
+	if(!stages) {
+		return -1;
+	}
+	pipeline->stages = stages;
+	save_pipeline_stage_t *stage = &stages[pipeline->count];
+	stage->name = name;
+	stage->fn = fn;
+	stage->user = user;
+	atomic_init(&stage->waiting, 0);
+	atomic_init(&stage->items, 0);
+	atomic_init(&stage->stopped, 0);
+	atomic_init(&stage->inline_runs, 0);
+	atomic_init(&stage->busy_ns, 0);
+	atomic_init(&stage->max_ns, 0);
+	return pipeline->count++;
+}
+
+/**
+ * Don't call this from a task on the pipeline's pool, it may wait for that task's worker.
+ * @brief Sends an item through the stages, waiting while the first stage is full.
+ * @param pipeline The pipeline.
+ * @param item The item, passed to every stage.
+ * @return 0 on success, -1 if there are no stages or the item could not be queued.
+ */
+int save_pipeline_push(save_pipeline_t *pipeline, void *item) {
+	if(!pipeline->count) {
+		return -1;
+	}
+	save_pipeline_ticket_t *ticket = malloc(sizeof(save_pipeline_ticket_t));
+	if(!ticket) {
+		return -1;
+	}
+	ticket->pipeline = pipeline;
+	ticket->item = item;
+	ticket->stage = 0;
+	atomic_store(&pipeline->started, 1);
+	save_pipeline_stage_t *first = &pipeline->stages[0];
+	if(atomic_load(&first->waiting) >= pipeline->capacity) {
+		uint64_t start = save_pipeline_now_ns();
+		pthread_mutex_lock(&pipeline->lock);
+		atomic_fetch_add(&pipeline->blocked, 1);
+		while(atomic_load(&first->waiting) >= pipeline->capacity) {
+			pthread_cond_wait(&pipeline->space, &pipeline->lock);
+		}
+		atomic_fetch_sub(&pipeline->blocked, 1);
+		pthread_mutex_unlock(&pipeline->lock);
+		atomic_fetch_add(&pipeline->push_wait_ns, save_pipeline_now_ns() - start);
+	}
+	//several producers may pass the check at once, the first stage may go over by that many
+	atomic_fetch_add(&first->waiting, 1);
+	atomic_fetch_add(&pipeline->active, 1);
+	if(thread_pool_submit(pipeline->pool, save_pipeline_task, ticket)) {
+		atomic_fetch_sub(&first->waiting, 1);
+		free(ticket);
+		save_pipeline_done(pipeline);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Don't call this from a task on the pipeline's pool.
+ * @brief Waits until every item pushed has been through the stages.
+ * @param pipeline The pipeline.
+ */
+void save_pipeline_wait(save_pipeline_t *pipeline) {
+	pthread_mutex_lock(&pipeline->lock);
+	while(atomic_load(&pipeline->active)) {
+		pthread_cond_wait(&pipeline->idle, &pipeline->lock);
+	}
+	pthread_mutex_unlock(&pipeline->lock);
+}
+
+/**
+ * @brief Gets the number of stages.
+ * @param pipeline The pipeline.
+ * @return The number of stages.
+ */
+size_t save_pipeline_stages(const save_pipeline_t *pipeline) {
+	return pipeline->count;
+}
+
+/**
+ * The counters keep changing while items run, call save_pipeline_wait() first for final ones.
+ * @brief Gets the counters of a stage.
+ * @param pipeline The pipeline.
+ * @param stage The number of the stage.
+ * @param stats Receives the counters.
+ */
+void save_pipeline_stats(const save_pipeline_t *pipeline, size_t stage, save_pipeline_stats_t *stats) {
+	save_pipeline_stage_t *s = &pipeline->stages[stage];
+	stats->name = s->name;
+	stats->items = atomic_load(&s->items);
+	stats->stopped = atomic_load(&s->stopped);
+	stats->inline_runs = atomic_load(&s->inline_runs);
+	stats->busy_ns = atomic_load(&s->busy_ns);
+	stats->max_ns = atomic_load(&s->max_ns);
+}
+
+/**
+ * @brief Gets the time producers spent blocked in save_pipeline_push() because the first stage was full.
+ * @param pipeline The pipeline.
+ * @return The time in nanoseconds, over all producers.
+ */
+uint64_t save_pipeline_push_wait_ns(const save_pipeline_t *pipeline) {
+	return atomic_load(&((save_pipeline_t *)pipeline)->push_wait_ns);
+}
+
+/**
+ * Items still running are waited for first, the pool is left running.
+ * @brief Frees a pipeline.
+ * @param pipeline The pipeline.
+ */
+void save_pipeline_free(save_pipeline_t *pipeline) {
+	save_pipeline_wait(pipeline);
+	pthread_mutex_destroy(&pipeline->lock);
+	pthread_cond_destroy(&pipeline->space);
+	pthread_cond_destroy(&pipeline->idle);
+	free(pipeline->stages);
+	free(pipeline);
+}
@@ -0,0 +1,114 @@
+//Thread local pool of save object blocks
+
+#include "types.h"
+#include "save_pool.h"
+#include <stdlib.h>
+
+enum {
+	//one size for each generation's save object, more are freed rather than kept
+	SAVE_POOL_SIZES = 4
+};
+
+//a pooled block, the link is kept in the block itself
+typedef struct save_pool_block {
+	struct save_pool_block *next;
+} save_pool_block_t;
+
+typedef struct {
+	size_t size;
+	size_t count;
+	save_pool_block_t *head;
+} save_pool_list_t;
+
+typedef struct {
+	save_pool_list_t lists[SAVE_POOL_SIZES];
+	save_pool_stats_t stats;
+} save_pool_t;
+
+static _Thread_local save_pool_t save_pool_local;
+
+//the list for blocks of this size, NULL if every list holds another size
+static save_pool_list_t *save_pool_list(save_pool_t *pool, size_t size) {
+	for(size_t i = 0; i < SAVE_POOL_SIZES; ++i) {
+		save_pool_list_t *list = &pool->lists[i];
+		if(list->size == size) {
+			return list;
+		}
+		if(!list->size) {
+			list->size = size;
+			return list;
+		}
+	}
+	return NULL;
+}
+
+static void *save_pool_alloc(size_t size, void *user) {
+	(void)user;
+	save_pool_t *pool = &save_pool_local;
+	save_pool_list_t *list = save_pool_list(pool, size);
+	if(list && list->head) {
+		save_pool_block_t *block = list->head;
+		list->head = block->next;
+		--list->count;
+		++pool->stats.hits;
+		--pool->stats.kept;
+		pool->stats.bytes -= size;
+		return block;
+	}
+	++pool->stats.misses;
+	return malloc(size < sizeof(save_pool_block_t) ? sizeof(save_pool_block_t) : size);
+}
+
+static void save_pool_free(void *ptr, size_t size, void *user) {
+	(void)user;
+	save_pool_t *pool = &save_pool_local;
+	save_pool_list_t *list = save_pool_list(pool, size);
+	if(!list || list->count == SAVE_POOL_KEEP) {
+		++pool->stats.drops;
+		free(ptr);
+		return;
+	}
+	save_pool_block_t *block = ptr;
+	block->next = list->head;
+	list->head = block;
+	++list->count;
+	++pool->stats.kept;
+	pool->stats.bytes += size;
+}
+
+static const save_allocator_t save_pool_hooks = { save_pool_alloc, save_pool_free, NULL };
+
+/**
+ * @brief Gets the allocator that takes save objects from the calling thread's pool.
+ * @return The allocator.
+ */
+const save_allocator_t *save_pool_allocator(void) {
+	return &save_pool_hooks;
+}
+
+/**
+ * @brief Gets the counters of the calling thread's pool.
+ * @param stats Receives the counters.
+ */
+void save_pool_stats(save_pool_stats_t *stats) {
+	*stats = save_pool_local.stats;
+}
+
+/**
+ * The counters are kept.
+ * @brief Frees every block in the calling thread's pool.
+ */
+void save_pool_trim(void) {
+	save_pool_t *pool = &save_pool_local;
+	for(size_t i = 0; i < SAVE_POOL_SIZES; ++i) {
+		save_pool_list_t *list = &pool->lists[i];
+		while(list->head) {
+			save_pool_block_t *block = list->head;
+			list->head = block->next;
+			free(block);
+		}
+		list->count = 0;
+	}
+	pool->stats.kept = 0;
+	pool->stats.bytes = 0;
+}
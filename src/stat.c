@@ -109,34 +109,61 @@ stat_nature_t stat_get_nature(uint32_t pid) {
 	return pid % 25;
 }
 
+static const uint32_t *const STAT_TOTAL_EXP[] = {
+	[STAT_GROWTH_RATE_ERRATIC] = STAT_TOTAL_EXP_ERRATIC,
+	[STAT_GROWTH_RATE_FAST] = STAT_TOTAL_EXP_FAST,
+	[STAT_GROWTH_RATE_MEDIUM_FAST] = STAT_TOTAL_EXP_MEDIUM_FAST,
+	[STAT_GROWTH_RATE_MEDIUM_SLOW] = STAT_TOTAL_EXP_MEDIUM_SLOW,
+	[STAT_GROWTH_RATE_SLOW] = STAT_TOTAL_EXP_SLOW,
+	[STAT_GROWTH_RATE_FLUCTUATING] = STAT_TOTAL_EXP_FLUCTUATING,
+};
+
+static inline const uint32_t *stat_get_exp_table(stat_growth_rate_t growth_rate) {
+	// Unknown growth rates have always fallen back to the fast table.
+	if((unsigned)growth_rate >= sizeof(STAT_TOTAL_EXP) / sizeof(*STAT_TOTAL_EXP)) {
+		return STAT_TOTAL_EXP_FAST;
+	}
+	return STAT_TOTAL_EXP[growth_rate];
+}
+
+static inline uint8_t stat_level_from_table(const uint32_t *exp_table, uint32_t exp) {
+	// Branchless binary search: the level is the number of table entries <= exp. Each step
+	// halves the range with a conditional move rather than a branch, so it always takes seven
+	// steps and never mispredicts. exp_table[0] is 0, so the result is always at least 1.
+	const uint32_t *base = exp_table;
+	size_t n = 100;
+	while(n > 1) {
+		size_t half = n / 2;
+		base = base[half] <= exp ? base + half : base;
+		n -= half;
+	}
+	return (uint8_t)(base - exp_table) + (*base <= exp);
+}
+
 uint8_t stat_get_level(stat_growth_rate_t growth_rate, uint32_t exp) {
-	const uint32_t *exp_table = STAT_TOTAL_EXP_FAST;
-	switch(growth_rate) {
-		case STAT_GROWTH_RATE_ERRATIC:
-			exp_table = STAT_TOTAL_EXP_ERRATIC;
-			break;
-		case STAT_GROWTH_RATE_FAST:
-			exp_table = STAT_TOTAL_EXP_FAST;
-			break;
-		case STAT_GROWTH_RATE_MEDIUM_FAST:
-			exp_table = STAT_TOTAL_EXP_MEDIUM_FAST;
-			break;
-		case STAT_GROWTH_RATE_MEDIUM_SLOW:
-			exp_table = STAT_TOTAL_EXP_MEDIUM_SLOW;
-			break;
-		case STAT_GROWTH_RATE_SLOW:
-			exp_table = STAT_TOTAL_EXP_SLOW;
-			break;
-		case STAT_GROWTH_RATE_FLUCTUATING:
-			exp_table = STAT_TOTAL_EXP_FLUCTUATING;
-			break;
+	return stat_level_from_table(stat_get_exp_table(growth_rate), exp);
+}
+
+uint32_t stat_get_exp(stat_growth_rate_t growth_rate, uint8_t level) {
+	if(level < 1) {
+		return 0;
 	}
-	for(size_t i = 0; i <= 100; ++i) {
-		if(exp_table[i] > exp) {
-			return i;
-		}
+	if(level > 100) {
+		level = 100;
+	}
+	return stat_get_exp_table(growth_rate)[level - 1];
+}
+
+void stat_get_level_batch(uint8_t *levels, const uint8_t *growth_rates, const uint32_t *exp, size_t count) {
+	for(size_t i = 0; i < count; ++i) {
+		levels[i] = stat_level_from_table(stat_get_exp_table(growth_rates[i]), exp[i]);
+	}
+}
+
+void stat_get_exp_batch(uint32_t *exp, const uint8_t *growth_rates, const uint8_t *levels, size_t count) {
+	for(size_t i = 0; i < count; ++i) {
+		exp[i] = stat_get_exp(growth_rates[i], levels[i]);
 	}
-	return 100;
 }
 
 //calculate GB STATS
@@ -144,10 +171,14 @@ static inline uint8_t gb_calc_ev(uint16_t stat_exp) {
 	if(stat_exp >= 0xfe02) {
 		return 64;
 	}
-	uint8_t b = 0;
-	while(b * b < stat_exp) {
-		++b;
+	// ceil(sqrt(stat_exp)) / 4. The square root is found one bit at a time, eight fixed steps
+	// instead of counting up to it.
+	uint32_t b = 0;
+	for(uint32_t bit = 0x80; bit; bit >>= 1) {
+		uint32_t t = b | bit;
+		b = t * t <= stat_exp ? t : b;
 	}
+	b += b * b < stat_exp;
 	return b >> 2;
 }
 
@@ -268,3 +299,65 @@ uint16_t dsi_calc_stat(uint8_t level, uint8_t base_stat, uint8_t iv, uint8_t ev,
 uint16_t dsi_calc_hp_stat(uint8_t level, uint8_t base_stat, uint8_t iv, uint8_t ev) {
 	return gba_calc_hp_stat(level, base_stat, iv, ev);
 }
+
+/**
+ * x / 100 as x / 4 / 25, with the divide by 25 done as a multiply and shift. Exact for
+ * x < 174760, which covers every intermediate value below (at most 77000).
+ */
+static inline uint32_t stat_div100(uint32_t x) {
+	return ((x >> 2) * 5243) >> 17;
+}
+
+static void gba_calc_hp_column(uint16_t *restrict out, const uint8_t *restrict level,
+		const uint8_t *restrict base, const uint8_t *restrict iv, const uint8_t *restrict ev, size_t count) {
+	for(size_t i = 0; i < count; ++i) {
+		uint32_t stat = (((uint32_t)base[i] << 1) + iv[i] + (ev[i] >> 2)) * level[i];
+		out[i] = stat_div100(stat) + level[i] + 10;
+	}
+}
+
+static void gba_calc_stat_column(uint16_t *restrict out, const uint8_t *restrict level,
+		const uint8_t *restrict base, const uint8_t *restrict iv, const uint8_t *restrict ev,
+		const uint8_t *restrict nature, uint32_t s, size_t count) {
+	for(size_t i = 0; i < count; ++i) {
+		uint32_t stat = (((uint32_t)base[i] << 1) + iv[i] + (ev[i] >> 2)) * level[i];
+		stat = stat_div100(stat) + 5;
+		// The nature multiplier vector: nature / 5 (as * 52 >> 8) picks the raised stat and
+		// nature % 5 the lowered one, +10% and -10%. Neutral natures pick the same stat for
+		// both, which cancels out, so no table lookup or branch is needed.
+		uint32_t up = (nature[i] * 52u) >> 8;
+		uint32_t down = nature[i] - up * 5;
+		uint32_t percent = 100 + 10 * (up + 1 == s) - 10 * (down + 1 == s);
+		out[i] = stat_div100(stat * percent);
+	}
+}
+
+/**
+ * @brief Calculate all six stats for count pokemon from generation 3 onwards.
+ * Each stat is one branch-free loop over plain arrays, which the compiler vectorizes.
+ * @param stats Six output arrays of count values, in stat_stat_t order.
+ * @param in The input arrays, see stat_batch_t. Natures must be 0 to 24.
+ * @param count Number of pokemon.
+ */
+void gba_calc_stats_batch(uint16_t *const stats[6], const stat_batch_t *in, size_t count) {
+	gba_calc_hp_column(stats[STAT_HP], in->level, in->base[STAT_HP], in->iv[STAT_HP], in->ev[STAT_HP], count);
+	for(uint32_t s = STAT_ATTACK; s <= STAT_SP_DEFENSE; ++s) {
+		gba_calc_stat_column(stats[s], in->level, in->base[s], in->iv[s], in->ev[s], in->nature, s, count);
+	}
+}
+
+/**
+ * @brief Calculate all six stats for count pokemon from generation 4.
+ * @see gba_calc_stats_batch
+ */
+void nds_calc_stats_batch(uint16_t *const stats[6], const stat_batch_t *in, size_t count) {
+	gba_calc_stats_batch(stats, in, count);
+}
+
+/**
+ * @brief Calculate all six stats for count pokemon from generation 5.
+ * @see gba_calc_stats_batch
+ */
+void dsi_calc_stats_batch(uint16_t *const stats[6], const stat_batch_t *in, size_t count) {
+	gba_calc_stats_batch(stats, in, count);
+}
@@ -0,0 +1,249 @@
+//Work stealing thread pool
+
+//pthreads and sysconf are POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+
+#include "types.h"
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+	thread_pool_fn_t fn;
+	void *arg;
+} thread_pool_task_t;
+
+//a growable ring buffer, the owner works at the tail and thieves take from the head
+typedef struct {
+	pthread_mutex_t lock;
+	thread_pool_task_t *tasks;
+	size_t capacity;
+	size_t head;
+	size_t count;
+} thread_pool_queue_t;
+
+typedef struct {
+	thread_pool_t *pool;
+	size_t index;
+	pthread_t thread;
+	thread_pool_queue_t queue;
+} thread_pool_worker_t;
+
+struct thread_pool {
+	thread_pool_worker_t *workers;
+	size_t count;
+	//threads actually running, only less than count if creating one failed
+	size_t started;
+	//tasks sitting in a queue, and tasks submitted but not finished
+	atomic_size_t queued;
+	atomic_size_t pending;
+	atomic_size_t next;
+	atomic_int stop;
+	//only used to sleep, when there is nothing to run or to wait for
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t idle;
+};
+
+//the worker running on this thread, so tasks submitted by tasks stay local
+static _Thread_local thread_pool_worker_t *thread_pool_self;
+
+static int thread_pool_push(thread_pool_queue_t *queue, thread_pool_task_t task) {
+	pthread_mutex_lock(&queue->lock);
+	if(queue->count == queue->capacity) {
+		size_t capacity = queue->capacity ? queue->capacity * 2 : 64;
+		thread_pool_task_t *tasks = malloc(capacity * sizeof(*tasks));
+		if(!tasks) {
+			pthread_mutex_unlock(&queue->lock);
+			return -1;
+		}
+		for(size_t i = 0; i < queue->count; ++i) {
+			tasks[i] = queue->tasks[(queue->head + i) % queue->capacity];
+		}
+		free(queue->tasks);
+		queue->tasks = tasks;
+		queue->capacity = capacity;
+		queue->head = 0;
+	}
+	queue->tasks[(queue->head + queue->count) % queue->capacity] = task;
+	++queue->count;
+	pthread_mutex_unlock(&queue->lock);
+	return 0;
+}
+
+static int thread_pool_pop(thread_pool_queue_t *queue, thread_pool_task_t *task, uint8_t steal) {
+	int found = 0;
+	pthread_mutex_lock(&queue->lock);
+	if(queue->count) {
+		if(steal) {
+			*task = queue->tasks[queue->head];
+			queue->head = (queue->head + 1) % queue->capacity;
+		} else {
+			*task = queue->tasks[(queue->head + queue->count - 1) % queue->capacity];
+		}
+		--queue->count;
+		found = 1;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return found;
+}
+
+static int thread_pool_take(thread_pool_worker_t *self, thread_pool_task_t *task) {
+	thread_pool_t *pool = self->pool;
+	if(thread_pool_pop(&self->queue, task, 0)) {
+		return 1;
+	}
+	for(size_t i = 1; i < pool->count; ++i) {
+		if(thread_pool_pop(&pool->workers[(self->index + i) % pool->count].queue, task, 1)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void *thread_pool_main(void *arg) {
+	thread_pool_worker_t *self = arg;
+	thread_pool_t *pool = self->pool;
+	thread_pool_self = self;
+	for(;;) {
+		thread_pool_task_t task;
+		if(thread_pool_take(self, &task)) {
+			atomic_fetch_sub(&pool->queued, 1);
+			task.fn(task.arg, self->index);
+			if(atomic_fetch_sub(&pool->pending, 1) == 1) {
+				pthread_mutex_lock(&pool->lock);
+				pthread_cond_broadcast(&pool->idle);
+				pthread_mutex_unlock(&pool->lock);
+			}
+			continue;
+		}
+		pthread_mutex_lock(&pool->lock);
+		while(!atomic_load(&pool->stop) && !atomic_load(&pool->queued)) {
+			pthread_cond_wait(&pool->work, &pool->lock);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		if(atomic_load(&pool->stop)) {
+			return NULL;
+		}
+	}
+}
+
+/**
+ * @brief Starts a thread pool.
+ * @param threads The number of worker threads, 0 for one per online processor.
+ * @return The pool, or NULL if it could not be started.
+ */
+thread_pool_t *thread_pool_create(size_t threads) {
+	if(!threads) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = online > 0 ? online : 1;
+	}
+	thread_pool_t *pool = calloc(1, sizeof(thread_pool_t));
+	if(!pool) {
+		return NULL;
+	}
+	pool->workers = calloc(threads, sizeof(thread_pool_worker_t));
+	if(!pool->workers) {
+		free(pool);
+		return NULL;
+	}
+	atomic_init(&pool->queued, 0);
+	atomic_init(&pool->pending, 0);
+	atomic_init(&pool->next, 0);
+	atomic_init(&pool->stop, 0);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->idle, NULL);
+	pool->count = threads;
+	for(size_t i = 0; i < threads; ++i) {
+		pool->workers[i].pool = pool;
+		pool->workers[i].index = i;
+		pthread_mutex_init(&pool->workers[i].queue.lock, NULL);
+	}
+	for(size_t i = 0; i < threads; ++i) {
+		if(pthread_create(&pool->workers[i].thread, NULL, thread_pool_main, &pool->workers[i])) {
+			thread_pool_free(pool);
+			return NULL;
+		}
+		pool->started = i + 1;
+	}
+	return pool;
+}
+
+/**
+ * @brief Gets the number of worker threads.
+ * @param pool The pool.
+ * @return The number of workers, worker numbers passed to tasks are below this.
+ */
+size_t thread_pool_threads(const thread_pool_t *pool) {
+	return pool->count;
+}
+
+/**
+ * Tasks submitted from a task go on the queue of the worker running it, other tasks are dealt
+ * out to the workers in turn.
+ * @brief Queues a task.
+ * @param pool The pool to run the task.
+ * @param fn The task.
+ * @param arg The argument for the task.
+ * @return 0 on success, -1 if the task could not be queued.
+ */
+int thread_pool_submit(thread_pool_t *pool, thread_pool_fn_t fn, void *arg) {
+	thread_pool_task_t task = { fn, arg };
+	thread_pool_worker_t *worker = thread_pool_self;
+	if(!worker || worker->pool != pool) {
+		worker = &pool->workers[atomic_fetch_add(&pool->next, 1) % pool->count];
+	}
+	//count the task before it can be taken, so the counts never go below zero
+	atomic_fetch_add(&pool->pending, 1);
+	atomic_fetch_add(&pool->queued, 1);
+	if(thread_pool_push(&worker->queue, task)) {
+		atomic_fetch_sub(&pool->queued, 1);
+		atomic_fetch_sub(&pool->pending, 1);
+		return -1;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_signal(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	return 0;
+}
+
+/**
+ * Don't call this from a task, the task would be waiting for itself.
+ * @brief Waits until every submitted task, and every task they submitted, has finished.
+ * @param pool The pool to wait for.
+ */
+void thread_pool_wait(thread_pool_t *pool) {
+	pthread_mutex_lock(&pool->lock);
+	while(atomic_load(&pool->pending)) {
+		pthread_cond_wait(&pool->idle, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Tasks still queued are run first.
+ * @brief Stops the workers and frees the pool.
+ * @param pool The pool to free.
+ */
+void thread_pool_free(thread_pool_t *pool) {
+	thread_pool_wait(pool);
+	pthread_mutex_lock(&pool->lock);
+	atomic_store(&pool->stop, 1);
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	for(size_t i = 0; i < pool->started; ++i) {
+		pthread_join(pool->workers[i].thread, NULL);
+	}
+	for(size_t i = 0; i < pool->count; ++i) {
+		pthread_mutex_destroy(&pool->workers[i].queue.lock);
+		free(pool->workers[i].queue.tasks);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work);
+	pthread_cond_destroy(&pool->idle);
+	free(pool->workers);
+	free(pool);
+}
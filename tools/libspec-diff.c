@@ -0,0 +1,159 @@
+/*
+// Build and run:
+make tools && ./lib/libspec-diff old.sav new.sav
+
+// Prints every field that differs between the main saves of two GBA or NDS files, one per
+// line, and exits with 1 if there were any. Both files are mapped, not read, and only the
+// sections that differ are decoded.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#define MMAP_OPEN_IMPL
+#include "../mmap_open.h"
+#include "../include/libspec.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char *const DIFF_AREAS[] = { "section", "trainer", "money", "item", "pokedex", "party", "pc" };
+
+typedef struct {
+	//non-zero for NDS saves, their text is 16 bits a character
+	int nds;
+} diff_context_t;
+
+static int diff_is_text(const char *field) {
+	return !strcmp(field, "name") || !strcmp(field, "nickname") || !strcmp(field, "ot_name") || !strcmp(field, "box_name");
+}
+
+static void diff_print_utf8(FILE *out, const char16_t *text, size_t size) {
+	for(size_t i = 0; i < size && text[i]; ++i) {
+		uint16_t c = text[i];
+		if(c < 0x80) {
+			fputc(c, out);
+		} else if(c < 0x800) {
+			fputc(0xC0 | c >> 6, out);
+			fputc(0x80 | (c & 0x3F), out);
+		} else {
+			fputc(0xE0 | c >> 12, out);
+			fputc(0x80 | (c >> 6 & 0x3F), out);
+			fputc(0x80 | (c & 0x3F), out);
+		}
+	}
+}
+
+static void diff_print_value(FILE *out, const diff_context_t *context, const save_diff_t *diff, const uint8_t *data, uint32_t value) {
+	if(!data || diff->size <= 4) {
+		fprintf(out, "%u", value);
+		return;
+	}
+	if(diff_is_text(diff->field)) {
+		char16_t text[16] = { 0 };
+		if(context->nds) {
+			char16_t raw[16];
+			size_t size = diff->size / 2 < 16 ? diff->size / 2 : 16;
+			memcpy(raw, data, size * 2);
+			//0xFFFF ends NDS text and decodes to 0
+			nds_text_to_ucs2(text, raw, size);
+		} else {
+			char8_t raw[16];
+			size_t size = diff->size < 16 ? diff->size : 16;
+			memcpy(raw, data, size);
+			for(size_t i = 0; i < size; ++i) {
+				//0xFF ends GBA text
+				if(raw[i] == 0xFF) {
+					size = i;
+					break;
+				}
+			}
+			gba_text_to_ucs2(text, raw, size);
+		}
+		fputc('"', out);
+		diff_print_utf8(out, text, 16);
+		fputc('"', out);
+		return;
+	}
+	for(size_t i = 0; i < diff->size; ++i) {
+		fprintf(out, "%02x", data[i]);
+	}
+}
+
+static void diff_print(const save_diff_t *diff, void *user) {
+	const diff_context_t *context = user;
+	FILE *out = stdout;
+	fprintf(out, "%s", DIFF_AREAS[diff->area]);
+	switch(diff->area) {
+		case SAVE_DIFF_SECTION:
+		case SAVE_DIFF_PARTY:
+			fprintf(out, " %u", diff->index);
+			break;
+		case SAVE_DIFF_ITEM:
+		case SAVE_DIFF_PC:
+			fprintf(out, " %u:%u", diff->group, diff->index);
+			break;
+		case SAVE_DIFF_POKEDEX:
+			//pokedex numbers start at 1 in game
+			fprintf(out, " %u", diff->index + 1);
+			break;
+		default:
+			break;
+	}
+	if(strcmp(diff->field, DIFF_AREAS[diff->area])) {
+		fprintf(out, " %s", diff->field);
+	}
+	fprintf(out, " ");
+	diff_print_value(out, context, diff, diff->old_data, diff->old_value);
+	fprintf(out, " -> ");
+	diff_print_value(out, context, diff, diff->new_data, diff->new_value);
+	fprintf(out, "\n");
+}
+
+static off_t diff_file_size(const char *path) {
+	struct stat st;
+	if(stat(path, &st)) {
+		return -1;
+	}
+	return st.st_size;
+}
+
+int main(int argc, char *argv[]) {
+	if(argc != 3) {
+		fprintf(stderr, "\n");
+		fprintf(stderr, "  Usage: %s old-save new-save\n", argv[0]);
+		fprintf(stderr, "  Prints the fields that differ between the main saves of two GBA or NDS files.\n");
+		fprintf(stderr, "\n");
+		return -1;
+	}
+	off_t size = diff_file_size(argv[1]);
+	if(size < 0 || size != diff_file_size(argv[2])) {
+		fprintf(stderr, "The files must exist and be the same size\n");
+		return 2;
+	}
+	if(size != GBA_SAVE_SIZE && size != NDS_SAVE_SIZE) {
+		fprintf(stderr, "Only GBA and NDS saves can be compared\n");
+		return 2;
+	}
+	unsigned char *a = mmap_open(argv[1]);
+	unsigned char *b = a ? mmap_open(argv[2]) : NULL;
+	if(!a || !b) {
+		fprintf(stderr, "Could not map the files\n");
+		if(a) {
+			mmap_close(a);
+		}
+		return 2;
+	}
+	diff_context_t context = { size == NDS_SAVE_SIZE };
+	int found = context.nds ? nds_diff(a, b, diff_print, &context) : gba_diff(a, b, diff_print, &context);
+	mmap_close(a);
+	mmap_close(b);
+	if(found < 0) {
+		fprintf(stderr, "The files aren't saves of the same game\n");
+		return 2;
+	}
+	fprintf(stderr, "%d differences\n", found);
+	//like diff, 1 when the files differ and 2 for trouble
+	return found ? 1 : 0;
+}
@@ -0,0 +1,421 @@
+/*
+// Build and run:
+make tools && ./lib/libspec-scan -j 8 ~/saves > summary.tsv
+
+// Scans every file under the given paths, one line per save on stdout:
+// path, generation, game, status, party, pc, corrupt, bytes, microseconds
+// The corpus totals, species counts and timings go to stderr at the end.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/libspec.h"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define numberof(x) (sizeof(x) / sizeof(*x))
+
+enum {
+	//species ids at or past this are counted as out of range
+	SCAN_SPECIES = 1024,
+	SCAN_FILE_MAX = NDS_SAVE_SIZE,
+	SCAN_TOP_SPECIES = 20
+};
+
+typedef enum {
+	SCAN_GEN_UNKNOWN,
+	SCAN_GEN_GB,
+	SCAN_GEN_GBA,
+	SCAN_GEN_NDS,
+	SCAN_GEN_DSI,
+	SCAN_GEN_COUNT
+} scan_gen_t;
+
+static const char *const SCAN_GEN_NAMES[SCAN_GEN_COUNT] = { "unknown", "gb", "gba", "nds", "dsi" };
+
+typedef enum {
+	SCAN_OK,
+	SCAN_BAD_CHECKSUM,
+	SCAN_UNCHECKED,
+	SCAN_UNREADABLE,
+	SCAN_STATUS_COUNT
+} scan_status_t;
+
+static const char *const SCAN_STATUS_NAMES[SCAN_STATUS_COUNT] = { "ok", "bad-checksum", "unchecked", "unreadable" };
+
+//per worker totals, merged at the end so workers never share a counter
+typedef struct {
+	uint64_t saves;
+	uint64_t bytes;
+	uint64_t gen[SCAN_GEN_COUNT];
+	uint64_t status[SCAN_STATUS_COUNT];
+	uint64_t pokemon;
+	uint64_t corrupt;
+	//gen 3 and gen 4 species ids mean different things, so count them apart
+	uint64_t species[2][SCAN_SPECIES];
+	uint64_t species_out_of_range;
+	uint32_t *latency;
+	size_t latency_count;
+	size_t latency_capacity;
+	uint8_t *buffer;
+} scan_stats_t;
+
+typedef struct {
+	const char *game;
+	scan_gen_t gen;
+	scan_status_t status;
+	size_t party;
+	size_t pc;
+	size_t corrupt;
+} scan_result_t;
+
+static thread_pool_t *scan_pool;
+static scan_stats_t *scan_stats;
+static int scan_quiet;
+
+static uint64_t scan_now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void scan_count_species(scan_stats_t *stats, int table, uint16_t species) {
+	if(species < SCAN_SPECIES) {
+		++stats->species[table][species];
+	} else {
+		++stats->species_out_of_range;
+	}
+}
+
+static void scan_gba(scan_stats_t *stats, const uint8_t *data, scan_result_t *result) {
+	static const char *const GAMES[] = { "unknown", "rs", "e", "frlg" };
+	result->gen = SCAN_GEN_GBA;
+	//a block with a bad mark or section id can't be unpacked into a sensible save, and the
+	//pokemon of a block with a bad checksum can't be trusted either, so damaged saves stop here
+	if(gba_check_main_save(data)) {
+		result->status = SCAN_BAD_CHECKSUM;
+		return;
+	}
+	gba_save_t *save = gba_read_main_save(data);
+	if(!save) {
+		result->status = SCAN_UNREADABLE;
+		return;
+	}
+	result->game = GAMES[save->type];
+	result->status = SCAN_OK;
+	gba_party_t *party = gba_get_party(save);
+	if(party) {
+		result->party = party->size < POKEMON_IN_PARTY ? party->size : POKEMON_IN_PARTY;
+	}
+	gba_pc_t *pc = gba_get_pc(save);
+	for(size_t i = 0; i < GBA_BOX_COUNT; ++i) {
+		for(size_t j = 0; j < GBA_POKEMON_IN_BOX; ++j) {
+			//has_species is in the unencrypted header
+			if(!pc->box[i].pokemon[j].has_species) {
+				continue;
+			}
+			pk3_box_t pkm = pc->box[i].pokemon[j];
+			pk3_decrypt(&pkm);
+			++result->pc;
+			if(pkm.checksum != pk3_checksum((uint8_t *)pkm.block, sizeof(pkm.block))) {
+				++result->corrupt;
+				continue;
+			}
+			scan_count_species(stats, 0, pkm.species);
+		}
+	}
+	gba_free_save(save);
+}
+
+static void scan_nds(scan_stats_t *stats, const uint8_t *data, scan_result_t *result) {
+	static const char *const GAMES[] = { "unknown", "dp", "pt", "hgss" };
+	nds_save_t *save = nds_read_main_save(data);
+	result->gen = SCAN_GEN_NDS;
+	if(!save) {
+		result->status = SCAN_UNREADABLE;
+		return;
+	}
+	result->game = GAMES[save->type];
+	//the block checksums aren't handled by the library yet, the pokemon checksums are
+	result->status = SCAN_OK;
+	nds_party_t *party = nds_get_party(save);
+	if(party) {
+		result->party = party->size < POKEMON_IN_PARTY ? party->size : POKEMON_IN_PARTY;
+	}
+	for(size_t i = 0; i < NDS_BOX_COUNT; ++i) {
+		nds_box_t *box = nds_get_box(save, i);
+		for(size_t j = 0; j < NDS_POKEMON_IN_BOX; ++j) {
+			if(!nds_pc_is_occupied(save, i, j)) {
+				continue;
+			}
+			pkm_box_t pkm = box->pokemon[j];
+			pkm_decrypt(&pkm);
+			++result->pc;
+			if(pkm.header.checksum != pkm_checksum((uint8_t *)pkm.block, sizeof(pkm.block))) {
+				++result->corrupt;
+				continue;
+			}
+			scan_count_species(stats, 1, pkm.species);
+		}
+	}
+	if(result->corrupt) {
+		result->status = SCAN_BAD_CHECKSUM;
+	}
+	nds_free_save(save);
+}
+
+static void scan_gb(const uint8_t *data, scan_result_t *result) {
+	static const char *const GAMES[] = { "unknown", "rby", "gs", "c" };
+	gb_save_t *save = gb_read_save(data);
+	result->gen = SCAN_GEN_GB;
+	if(!save) {
+		result->status = SCAN_UNREADABLE;
+		return;
+	}
+	result->game = GAMES[save->type];
+	//the type is found by checking the checksums, so a known type has a good one
+	result->status = save->type == GB_TYPE_UNKNOWN ? SCAN_BAD_CHECKSUM : SCAN_OK;
+	gb_free_save(save);
+}
+
+static size_t scan_read(const char *path, uint8_t *buffer) {
+	FILE *file = fopen(path, "rb");
+	if(!file) {
+		return 0;
+	}
+	size_t size = fread(buffer, 1, SCAN_FILE_MAX + 1, file);
+	fclose(file);
+	return size;
+}
+
+static void scan_record(scan_stats_t *stats, uint32_t latency) {
+	if(stats->latency_count == stats->latency_capacity) {
+		size_t capacity = stats->latency_capacity ? stats->latency_capacity * 2 : 4096;
+		uint32_t *grown = realloc(stats->latency, capacity * sizeof(*grown));
+		if(!grown) {
+			return;
+		}
+		stats->latency = grown;
+		stats->latency_capacity = capacity;
+	}
+	stats->latency[stats->latency_count++] = latency;
+}
+
+static void scan_file(void *arg, size_t worker) {
+	char *path = arg;
+	scan_stats_t *stats = &scan_stats[worker];
+	scan_result_t result = { "-", SCAN_GEN_UNKNOWN, SCAN_UNCHECKED, 0, 0, 0 };
+	uint64_t start = scan_now_us();
+	size_t size = scan_read(path, stats->buffer);
+	if(!size) {
+		result.status = SCAN_UNREADABLE;
+	} else if(size == GB_SAVE_SIZE) {
+		scan_gb(stats->buffer, &result);
+	} else if(size == GBA_SAVE_SIZE && gba_is_gba_save(stats->buffer)) {
+		scan_gba(stats, stats->buffer, &result);
+	} else if(size == NDS_SAVE_SIZE && nds_detect_save_type(stats->buffer) != NDS_TYPE_UNKNOWN) {
+		scan_nds(stats, stats->buffer, &result);
+	} else if(size == DSI_SAVE_SIZE && dsi_detect_save_type(stats->buffer, size) != DSI_TYPE_UNKNOWN) {
+		result.gen = SCAN_GEN_DSI;
+	}
+	uint32_t latency = scan_now_us() - start;
+	++stats->saves;
+	stats->bytes += size;
+	++stats->gen[result.gen];
+	++stats->status[result.status];
+	stats->pokemon += result.pc + result.party;
+	stats->corrupt += result.corrupt;
+	scan_record(stats, latency);
+	if(!scan_quiet) {
+		//one call per line, so lines from different workers don't mix
+		printf("%s\t%s\t%s\t%s\t%zu\t%zu\t%zu\t%zu\t%u\n", path, SCAN_GEN_NAMES[result.gen], result.game,
+				SCAN_STATUS_NAMES[result.status], result.party, result.pc, result.corrupt, size, latency);
+	}
+	free(path);
+}
+
+static void scan_path(const char *path);
+
+static void scan_directory(void *arg, size_t worker) {
+	char *path = arg;
+	DIR *dir = opendir(path);
+	if(dir) {
+		struct dirent *entry;
+		size_t length = strlen(path);
+		while((entry = readdir(dir))) {
+			if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+				continue;
+			}
+			char *child = malloc(length + strlen(entry->d_name) + 2);
+			if(!child) {
+				continue;
+			}
+			sprintf(child, "%s/%s", path, entry->d_name);
+			scan_path(child);
+			free(child);
+		}
+		closedir(dir);
+	}
+	free(path);
+}
+
+//queue a file or directory, symbolic links are not followed
+static void scan_path(const char *path) {
+	struct stat st;
+	if(lstat(path, &st)) {
+		return;
+	}
+	thread_pool_fn_t fn = NULL;
+	if(S_ISDIR(st.st_mode)) {
+		fn = scan_directory;
+	} else if(S_ISREG(st.st_mode)) {
+		fn = scan_file;
+	} else {
+		return;
+	}
+	char *copy = malloc(strlen(path) + 1);
+	if(!copy) {
+		return;
+	}
+	strcpy(copy, path);
+	if(thread_pool_submit(scan_pool, fn, copy)) {
+		free(copy);
+	}
+}
+
+static int scan_compare_u32(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void scan_report(FILE *out, scan_stats_t *total, uint64_t elapsed) {
+	double seconds = elapsed / 1e6;
+	fprintf(out, "saves      %llu in %.2fs, %.0f saves/s, %.1f MB/s\n", (unsigned long long)total->saves, seconds,
+			seconds > 0 ? total->saves / seconds : 0, seconds > 0 ? total->bytes / seconds / 1e6 : 0);
+	for(size_t i = 0; i < SCAN_GEN_COUNT; ++i) {
+		fprintf(out, "%-10s %llu\n", SCAN_GEN_NAMES[i], (unsigned long long)total->gen[i]);
+	}
+	for(size_t i = 0; i < SCAN_STATUS_COUNT; ++i) {
+		fprintf(out, "%-10s %llu\n", SCAN_STATUS_NAMES[i], (unsigned long long)total->status[i]);
+	}
+	fprintf(out, "pokemon    %llu, %llu corrupt slots, %llu species out of range\n", (unsigned long long)total->pokemon,
+			(unsigned long long)total->corrupt, (unsigned long long)total->species_out_of_range);
+	for(size_t t = 0; t < 2; ++t) {
+		fprintf(out, "top %s species ids:", t ? "nds" : "gba");
+		//pick the largest counts without disturbing the table
+		uint8_t shown[SCAN_SPECIES] = { 0 };
+		for(size_t n = 0; n < SCAN_TOP_SPECIES; ++n) {
+			size_t best = 0;
+			for(size_t i = 1; i < SCAN_SPECIES; ++i) {
+				if(!shown[i] && total->species[t][i] > total->species[t][best]) {
+					best = i;
+				}
+			}
+			if(!total->species[t][best]) {
+				break;
+			}
+			shown[best] = 1;
+			fprintf(out, " %zu:%llu", best, (unsigned long long)total->species[t][best]);
+		}
+		fprintf(out, "\n");
+	}
+	if(total->latency_count) {
+		qsort(total->latency, total->latency_count, sizeof(*total->latency), scan_compare_u32);
+		size_t n = total->latency_count;
+		fprintf(out, "latency us p50 %u p90 %u p99 %u max %u\n", total->latency[n / 2],
+				total->latency[n * 9 / 10], total->latency[n * 99 / 100], total->latency[n - 1]);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	size_t threads = 0;
+	int opt;
+	while((opt = getopt(argc, argv, "j:q")) != -1) {
+		if(opt == 'j') {
+			threads = strtoul(optarg, NULL, 10);
+		} else if(opt == 'q') {
+			scan_quiet = 1;
+		} else {
+			optind = argc + 1;
+			break;
+		}
+	}
+	if(optind >= argc) {
+		fprintf(stderr, "\n");
+		fprintf(stderr, "  Usage: %s [-j threads] [-q] path...\n", argv[0]);
+		fprintf(stderr, "  Scans every save under the paths, printing one line per save and corpus totals.\n");
+		fprintf(stderr, "  -j  worker threads, one per processor by default\n");
+		fprintf(stderr, "  -q  only print the totals\n");
+		fprintf(stderr, "\n");
+		return -1;
+	}
+	scan_pool = thread_pool_create(threads);
+	if(!scan_pool) {
+		fprintf(stderr, "Could not start the worker threads\n");
+		return 1;
+	}
+	threads = thread_pool_threads(scan_pool);
+	scan_stats = calloc(threads, sizeof(scan_stats_t));
+	uint8_t ready = scan_stats != NULL;
+	for(size_t i = 0; ready && i < threads; ++i) {
+		scan_stats[i].buffer = malloc(SCAN_FILE_MAX + 1);
+		ready = scan_stats[i].buffer != NULL;
+	}
+	if(!ready) {
+		fprintf(stderr, "Could not allocate the scan buffers\n");
+		thread_pool_free(scan_pool);
+		if(scan_stats) {
+			for(size_t i = 0; i < threads; ++i) {
+				free(scan_stats[i].buffer);
+			}
+			free(scan_stats);
+		}
+		return 1;
+	}
+	uint64_t start = scan_now_us();
+	for(int i = optind; i < argc; ++i) {
+		scan_path(argv[i]);
+	}
+	thread_pool_wait(scan_pool);
+	uint64_t elapsed = scan_now_us() - start;
+	thread_pool_free(scan_pool);
+
+	fflush(stdout);
+	scan_stats_t *total = &scan_stats[0];
+	for(size_t i = 1; i < threads; ++i) {
+		scan_stats_t *stats = &scan_stats[i];
+		total->saves += stats->saves;
+		total->bytes += stats->bytes;
+		for(size_t j = 0; j < SCAN_GEN_COUNT; ++j) {
+			total->gen[j] += stats->gen[j];
+		}
+		for(size_t j = 0; j < SCAN_STATUS_COUNT; ++j) {
+			total->status[j] += stats->status[j];
+		}
+		total->pokemon += stats->pokemon;
+		total->corrupt += stats->corrupt;
+		for(size_t t = 0; t < 2; ++t) {
+			for(size_t j = 0; j < SCAN_SPECIES; ++j) {
+				total->species[t][j] += stats->species[t][j];
+			}
+		}
+		total->species_out_of_range += stats->species_out_of_range;
+		for(size_t j = 0; j < stats->latency_count; ++j) {
+			scan_record(total, stats->latency[j]);
+		}
+	}
+	scan_report(stderr, total, elapsed);
+	for(size_t i = 0; i < threads; ++i) {
+		free(scan_stats[i].latency);
+		free(scan_stats[i].buffer);
+	}
+	free(scan_stats);
+	return 0;
+}
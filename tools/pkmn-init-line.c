@@ -21,6 +21,11 @@ int main(int argc, char *argv[]) {
 	char const *specie = argv[1];
 	char const *nickname = specie;
 	uint16_t level = strtol(argv[2], NULL, 10);
+	int const sid = species_lookup(specie);
+	if(sid < 0) {
+		fprintf(stderr, "Unknown species: %s\n", specie);
+		return 1;
+	}
 	int rc = 0;
 	rc = getentropy(&pid, sizeof(pid));
 	assert(0 == rc);
@@ -32,6 +37,6 @@ int main(int argc, char *argv[]) {
 	gba_trainer_t ot[1];
 	trainer_init(ot, "TEST", 'M', 0, 0);
 	pk3_box_t p[1];
-	pokemon_init_v2(p, ot, pid, iv, 1, nickname, level); // TODO: Look up species ID...
+	pokemon_init_v2(p, ot, pid, iv, (uint16_t)sid, nickname, level);
 	fprint_pokemon_summary(stdout, NULL, p);
 }
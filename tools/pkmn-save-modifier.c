@@ -8,14 +8,15 @@ cling -l ./lib/libspec.so -l ./pkmn-save-modifier.c
 
 // Example interactive usage via Cling:
 $ cling -l ./lib/libspec.so -l ./pkmn-save-modifier.c
-[cling]$ save_open("/home/user/.config/retroarch/saves/Pokemon - FireRed Version (USA).srm")
+[cling]$ save_session s = {0}
+[cling]$ save_open(&s, "/home/user/.config/retroarch/saves/Pokemon - FireRed Version (USA).srm")
 (int) 0
-[cling]$ pokemon_list x = list_init(_save)
+[cling]$ pokemon_list x = list_init(s.save)
 (pokemon_list &) @0x7ffaff61e020
 [cling]$ list_filter_by_species(&x, KADABRA)
 (unsigned long) 1
 [cling]$ pokemon_moveset(x.pokemon[0], CONFUSION, TELEPORT, FLASH, PSYBEAM)
-[cling]$ save_store();
+[cling]$ save_store(&s);
 [cling]$ .q
 */
 
@@ -113,9 +114,9 @@ void pokemon_set_move(pk3_box_t *p, uint8_t index, uint16_t move) {
 	assert(p);
 	assert(index >= 1);
 	assert(index <= numberof(p->move));
-	assert(move < numberof(moves));
+	assert(move < MOVES_COUNT);
 	// TODO: Take into account the pp_up field?
-	p->move[index-1] = move; p->move_pp[index-1] = moves[move].pp;
+	p->move[index-1] = move; p->move_pp[index-1] = move_pp(move);
 }
 void pokemon_moveset(pk3_box_t *p, uint16_t m1, uint16_t m2, uint16_t m3, uint16_t m4) {
 	assert(p);
@@ -171,7 +172,7 @@ void pokemon_init_v2(pk3_box_t *p, gba_trainer_t const *ot, uint32_t pid, uint32
 	p->ot_sid = ot->sid;
 
 	char16_t tmp[sizeof(p->nickname)] = {};
-	ucs2_from_utf8(tmp, name ? name : species[sid].nameCaps, sizeof(p->nickname));
+	ucs2_from_utf8(tmp, name ? name : species_name_caps(sid), sizeof(p->nickname));
 	ucs2_to_gba_text(p->nickname, tmp, sizeof(p->nickname));
 	p->language = ENGLISH;
 
@@ -185,7 +186,7 @@ void pokemon_init_v2(pk3_box_t *p, gba_trainer_t const *ot, uint32_t pid, uint32
 
 	p->species = sid;
 	p->held_item = 0;
-	p->exp = (level*level*level)+50; // TODO: Expose API for this. Handle growth rates.
+	p->exp = stat_get_exp(STAT_GROWTH_RATE_MEDIUM_FAST, level); // TODO: Growth rate?
 	p->pp_up = (pk3_pp_up_t){0, 0, 0, 0};
 	p->friendship = 1;
 
@@ -215,14 +216,15 @@ void pokemon_clear(pk3_box_t *p) {
 uint16_t pokemon_calc_stat(pk3_box_t const *p, uint8_t level, stat_stat_t stat) {
 	pk3_genes_t const *const iv = &p->iv;
 	pk3_effort_t const *const ev = &p->ev;
-	uint8_t i, e, b;
+	uint8_t const b = species_base_stat(p->species, stat);
+	uint8_t i, e;
 	switch(stat) {
-	case STAT_HP:         i = iv->hp; e = ev->hp; b = species[p->species].stats.hp; break;
-	case STAT_ATTACK:     i = iv->atk; e = ev->atk; b = species[p->species].stats.atk; break;
-	case STAT_DEFENSE:    i = iv->def; e = ev->def; b = species[p->species].stats.def; break;
-	case STAT_SPEED:      i = iv->spd; e = ev->spd; b = species[p->species].stats.spd; break;
-	case STAT_SP_ATTACK:  i = iv->satk; e = ev->satk; b = species[p->species].stats.satk; break;
-	case STAT_SP_DEFENSE: i = iv->sdef; e = ev->sdef; b = species[p->species].stats.sdef; break;
+	case STAT_HP:         i = iv->hp; e = ev->hp; break;
+	case STAT_ATTACK:     i = iv->atk; e = ev->atk; break;
+	case STAT_DEFENSE:    i = iv->def; e = ev->def; break;
+	case STAT_SPEED:      i = iv->spd; e = ev->spd; break;
+	case STAT_SP_ATTACK:  i = iv->satk; e = ev->satk; break;
+	case STAT_SP_DEFENSE: i = iv->sdef; e = ev->sdef; break;
 	// TODO: STAT_ATTACK is spelled wrong.
 	}
 	if(STAT_HP == stat) return gba_calc_hp_stat(level, b, i, e);
@@ -260,7 +262,15 @@ typedef struct {
 	gba_save_t *save; // For use by filters.
 	size_t size;
 	pk3_box_t *pokemon[6+(GBA_BOX_COUNT*GBA_POKEMON_IN_BOX)];
+	// Where each entry lives: box is GBA_PC_INDEX_PARTY for the party.
+	uint8_t box[6+(GBA_BOX_COUNT*GBA_POKEMON_IN_BOX)];
+	uint8_t slot[6+(GBA_BOX_COUNT*GBA_POKEMON_IN_BOX)];
 } pokemon_list;
+static inline void list_keep(pokemon_list *const list, size_t const dst, size_t const src) {
+	list->pokemon[dst] = list->pokemon[src];
+	list->box[dst] = list->box[src];
+	list->slot[dst] = list->slot[src];
+}
 void list_clear_remainder(pokemon_list *list) {
 	for(size_t i = list->size; i < numberof(list->pokemon); i++) {
 		list->pokemon[i] = NULL;
@@ -274,12 +284,16 @@ pokemon_list list_init(gba_save_t *const save) {
 	gba_pc_t *pc = gba_get_pc(save);
 	size_t n = 0;
 	for(size_t i = 0; i < party->size; i++) {
+		list->box[n] = GBA_PC_INDEX_PARTY;
+		list->slot[n] = i;
 		list->pokemon[n++] = &party->pokemon[i].box;
 	}
 	for(size_t i = 0; i < numberof(pc->box); i++) {
 		for(size_t j = 0; j < numberof(pc->box[i].pokemon); j++) {
 			pk3_box_t *const p = &pc->box[i].pokemon[j];
 			if(pokemon_slot_empty(p)) continue;
+			list->box[n] = i;
+			list->slot[n] = j;
 			list->pokemon[n++] = p;
 		}
 	}
@@ -292,7 +306,7 @@ size_t list_filter_by_genes(pokemon_list *const list, pk3_genes_t const genes) {
 	size_t n = 0;
 	for(size_t i = 0; i < list->size; i++) {
 		if(!genes_equal(list->pokemon[i]->iv, genes)) continue;
-		list->pokemon[n++] = list->pokemon[i];
+		list_keep(list, n++, i);
 	}
 	list->size = n;
 	list_clear_remainder(list);
@@ -300,19 +314,21 @@ size_t list_filter_by_genes(pokemon_list *const list, pk3_genes_t const genes) {
 }
 size_t list_filter_by_box(pokemon_list *const list, uint8_t box) {
 	assert(list);
-	gba_pc_t *pc = gba_get_pc(list->save);
 	size_t n = 0;
 	for(size_t i = 0; i < list->size; i++) {
-		for(size_t j = 0; j < numberof(pc->box[box].pokemon); j++) {
-			if(list->pokemon[i] != &pc->box[box].pokemon[j]) continue;
-			list->pokemon[n++] = list->pokemon[i];
-		}
-
-		// TODO: Somehow this misses valid results. WTF?
-//		pk3_box_t *const start = &pc->box[box].pokemon[0];
-//		pk3_box_t *const end = &pc->box[box].pokemon[GBA_BOX_COUNT-1];
-//		if(list->pokemon[i] < start || list->pokemon[i] > end) continue;
-//		list->pokemon[n++] = list->pokemon[i];
+		if(box != list->box[i]) continue;
+		list_keep(list, n++, i);
+	}
+	list->size = n;
+	list_clear_remainder(list);
+	return list->size;
+}
+size_t list_filter_by_slot(pokemon_list *const list, uint8_t box, uint8_t slot) {
+	assert(list);
+	size_t n = 0;
+	for(size_t i = 0; i < list->size; i++) {
+		if(box != list->box[i] || slot != list->slot[i]) continue;
+		list_keep(list, n++, i);
 	}
 	list->size = n;
 	list_clear_remainder(list);
@@ -323,15 +339,47 @@ size_t list_filter_by_species(pokemon_list *const list, uint16_t const id) {
 	size_t n = 0;
 	for(size_t i = 0; i < list->size; i++) {
 		if(id != list->pokemon[i]->species) continue;
-		list->pokemon[n++] = list->pokemon[i];
+		list_keep(list, n++, i);
+	}
+	list->size = n;
+	list_clear_remainder(list);
+	return list->size;
+}
+gba_text_query_t text_query_from_utf8(char const *const str, gba_text_match_t const match) {
+	assert(str);
+	size_t len = 0; // Count code points, not bytes.
+	for(char const *c = str; *c; c++) if(0x80 != (*c & 0xc0)) len++;
+	char16_t tmp[GBA_TEXT_QUERY_LENGTH+1] = {};
+	ucs2_from_utf8(tmp, str, MIN(len, GBA_TEXT_QUERY_LENGTH));
+	gba_text_query_t query;
+	gba_text_query_init(&query, tmp, numberof(tmp), match);
+	return query;
+}
+size_t list_filter_by_name(pokemon_list *const list, char const *const name, gba_text_match_t const match) {
+	assert(list);
+	gba_text_query_t const query = text_query_from_utf8(name, match);
+	size_t n = 0;
+	for(size_t i = 0; i < list->size; i++) {
+		if(!gba_text_query_match(&query, list->pokemon[i]->nickname, sizeof(list->pokemon[i]->nickname))) continue;
+		list_keep(list, n++, i);
+	}
+	list->size = n;
+	list_clear_remainder(list);
+	return list->size;
+}
+size_t list_filter_by_ot(pokemon_list *const list, char const *const name, gba_text_match_t const match) {
+	assert(list);
+	gba_text_query_t const query = text_query_from_utf8(name, match);
+	size_t n = 0;
+	for(size_t i = 0; i < list->size; i++) {
+		if(!gba_text_query_match(&query, list->pokemon[i]->ot_name, sizeof(list->pokemon[i]->ot_name))) continue;
+		list_keep(list, n++, i);
 	}
 	list->size = n;
 	list_clear_remainder(list);
 	return list->size;
 }
 #ifdef NOTYET // TODO
-void list_filter_by_name() {}
-void list_filter_by_ot() {}
 void list_filter_by_gender() {}
 void list_filter_by_level() {}
 void list_filter_by_type() {}
@@ -356,35 +404,141 @@ typedef enum {
 	DUP_OVERWRITE = 3,
 	DUP_DONTCHECK = 4,
 } dup_action; // TODO ???
-int save_add_pokemon(gba_save_t *const save, pk3_box_t *const pokemon, dup_action ondup) {
+// Duplicate detection. A pokemon is identified by its pid, OT id and IVs, and every pokemon in
+// the party and PC is kept in an open addressing hash table on that key, so each insert is one
+// probe instead of a scan of the whole save. The table must be told about every move into or
+// out of the save (pokemon_index_move), and rebuilt if the save is edited some other way.
+enum {
+	POKEMON_INDEX_SIZE = 1024, // Power of two, at most 426 entries.
+	POKEMON_INDEX_IV_MASK = 0x3fffffff, // The IV word without is_egg and ability.
+};
+typedef struct {
+	uint32_t pid;
+	uint32_t ot_fid;
+	uint32_t iv;
+	pk3_box_t *pokemon; // NULL if empty.
+	bool removed;
+} pokemon_index_entry;
+typedef struct {
+	gba_save_t *save;
+	size_t count;
+	pokemon_index_entry entries[POKEMON_INDEX_SIZE];
+} pokemon_index;
+static uint32_t pokemon_index_iv(pk3_box_t const *const p) {
+	uint32_t iv;
+	memcpy(&iv, &p->iv, sizeof(iv));
+	return iv & POKEMON_INDEX_IV_MASK;
+}
+static size_t pokemon_index_hash(uint32_t const pid, uint32_t const ot_fid, uint32_t const iv) {
+	uint32_t h = pid * 0x9e3779b1 ^ ot_fid * 0x85ebca77 ^ iv * 0xc2b2ae3d;
+	h ^= h >> 15;
+	return h & (POKEMON_INDEX_SIZE-1);
+}
+pk3_box_t *pokemon_index_find(pokemon_index const *const index, pk3_box_t const *const p) {
+	assert(index); assert(p);
+	uint32_t const iv = pokemon_index_iv(p);
+	size_t i = pokemon_index_hash(p->pid, p->ot_fid, iv);
+	for(size_t n = 0; n < POKEMON_INDEX_SIZE; n++, i = (i+1) & (POKEMON_INDEX_SIZE-1)) {
+		pokemon_index_entry const *const e = &index->entries[i];
+		if(!e->pokemon && !e->removed) break;
+		if(e->pokemon && e->pid == p->pid && e->ot_fid == p->ot_fid && e->iv == iv) return e->pokemon;
+	}
+	return NULL;
+}
+static void pokemon_index_insert(pokemon_index *const index, pk3_box_t *const p) {
+	assert(index->count < POKEMON_INDEX_SIZE/2);
+	uint32_t const iv = pokemon_index_iv(p);
+	size_t i = pokemon_index_hash(p->pid, p->ot_fid, iv);
+	while(index->entries[i].pokemon) i = (i+1) & (POKEMON_INDEX_SIZE-1);
+	index->entries[i] = (pokemon_index_entry){ p->pid, p->ot_fid, iv, p, false };
+	index->count++;
+}
+static void pokemon_index_remove(pokemon_index *const index, pk3_box_t const *const p) {
+	uint32_t const iv = pokemon_index_iv(p);
+	size_t i = pokemon_index_hash(p->pid, p->ot_fid, iv);
+	for(size_t n = 0; n < POKEMON_INDEX_SIZE; n++, i = (i+1) & (POKEMON_INDEX_SIZE-1)) {
+		pokemon_index_entry *const e = &index->entries[i];
+		if(!e->pokemon && !e->removed) return;
+		if(e->pokemon != p) continue;
+		*e = (pokemon_index_entry){ .removed = true };
+		index->count--;
+		return;
+	}
+}
+pokemon_index *pokemon_index_create(gba_save_t *const save) {
+	assert(save);
+	pokemon_index *const index = calloc(1, sizeof(pokemon_index));
+	if(!index) return NULL;
+	index->save = save;
+	gba_pc_refresh_occupancy(save);
+	pokemon_list const list = list_init(save);
+	for(size_t i = 0; i < list.size; i++) pokemon_index_insert(index, list.pokemon[i]);
+	return index;
+}
+void pokemon_index_free(pokemon_index *const index) {
+	free(index);
+}
+// Returns box * GBA_POKEMON_IN_BOX + slot if p is a PC slot of the save, otherwise -1.
+static int pc_slot_of(gba_save_t *const save, pk3_box_t const *const p) {
+	gba_pc_t *const pc = gba_get_pc(save);
+	uintptr_t const start = (uintptr_t)&pc->box[0].pokemon[0];
+	uintptr_t const end = (uintptr_t)&pc->box[GBA_BOX_COUNT-1].pokemon[GBA_POKEMON_IN_BOX];
+	if((uintptr_t)p < start || (uintptr_t)p >= end) return -1;
+	return (int)(((uintptr_t)p - start) / sizeof(pk3_box_t));
+}
+// Like pokemon_move, for moves into, out of or within the indexed save.
+void pokemon_index_move(pokemon_index *const index, pk3_box_t *const dst, pk3_box_t *const src) {
+	assert(index);
+	if(src == dst) return;
+	if(!pokemon_slot_empty(dst)) pokemon_index_remove(index, dst);
+	pokemon_index_remove(index, src);
+	pokemon_move(dst, src);
+	pokemon_index_insert(index, dst);
+	int const from = pc_slot_of(index->save, src), to = pc_slot_of(index->save, dst);
+	if(from >= 0) gba_pc_set_occupied(index->save, from / GBA_POKEMON_IN_BOX, from % GBA_POKEMON_IN_BOX, 0);
+	if(to >= 0) gba_pc_set_occupied(index->save, to / GBA_POKEMON_IN_BOX, to % GBA_POKEMON_IN_BOX, 1);
+}
+int pokemon_index_add(pokemon_index *const index, pk3_box_t *const pokemon, dup_action ondup) {
+	assert(index);
 	assert(DUP_UPGRADE != ondup);
 	if(DUP_DONTCHECK != ondup) {
-		pokemon_list list = list_init(save);
-		list_filter_by_genes(&list, pokemon->iv);
-		if(list.size > 0) {
+		pk3_box_t *const dup = pokemon_index_find(index, pokemon);
+		if(dup) {
 			if(DUP_ABORT == ondup) return -1;
-			if(DUP_OVERWRITE == ondup) pokemon_move(list.pokemon[0], pokemon);
+			if(DUP_OVERWRITE == ondup) pokemon_move(dup, pokemon); // Same key, same slot.
 			return 0;
 		}
 	}
 
-	gba_party_t *party = gba_get_party(save);
+	gba_party_t *party = gba_get_party(index->save);
 	if(party->size < 6) {
-		pokemon_move(&party->pokemon[party->size].box, pokemon);
+		pokemon_index_move(index, &party->pokemon[party->size].box, pokemon);
 		pokemon_in_party_init(&party->pokemon[party->size]);
 		party->size++;
 		return 0;
 	}
 
-	gba_pc_t *pc = gba_get_pc(save);
-	for(uint32_t i = 0; i < numberof(pc->box); i++) {
-		uint32_t j = (pc->current_box+i) % numberof(pc->box);
-		pk3_box_t *slot = box_first_empty_slot(&pc->box[j]);
-		if(!slot) continue;
-		pokemon_move(slot, pokemon);
-		return 0;
+	gba_pc_t *pc = gba_get_pc(index->save);
+	uint16_t slot;
+	if(!gba_pc_reserve(index->save, PC_FILL_CURRENT, 1, &slot)) return -1;
+	pokemon_index_move(index, &pc->box[slot / GBA_POKEMON_IN_BOX].pokemon[slot % GBA_POKEMON_IN_BOX], pokemon);
+	return 0;
+}
+// Adds count pokemon with one index build for the whole batch. Returns how many were handled
+// (added, skipped or overwritten); fewer than count means pokemon[result] was a duplicate under
+// DUP_ABORT or there was no room left.
+size_t save_add_pokemon_bulk(gba_save_t *const save, pk3_box_t *const pokemon, size_t const count, dup_action ondup) {
+	pokemon_index *const index = pokemon_index_create(save);
+	if(!index) return 0;
+	size_t i = 0;
+	for(; i < count; i++) {
+		if(pokemon_index_add(index, &pokemon[i], ondup) < 0) break;
 	}
-	return -1;
+	pokemon_index_free(index);
+	return i;
+}
+int save_add_pokemon(gba_save_t *const save, pk3_box_t *const pokemon, dup_action ondup) {
+	return 1 == save_add_pokemon_bulk(save, pokemon, 1, ondup) ? 0 : -1;
 }
 
 #ifdef NOTYET // TODO
@@ -413,29 +567,21 @@ void pokedex_set_owned(gba_save_t *save, uint16_t id, bool owned) {
 	gba_pokedex_set_owned(save, id-1, owned);
 }
 uint16_t pokedex_count(gba_save_t *save, char type) {
-	uint16_t count = 0;
-	for(uint16_t i = 0; i < numberof(species); i++) { // TODO: Number of Pokemon entries???
-		if(('O' == type ? gba_pokedex_get_owned : gba_pokedex_get_seen)(save, i)) count++;
-	}
-	return count;
+	// TODO: Number of Pokemon entries???
+	return gba_pokedex_count(save, 'O' == type ? GBA_POKEDEX_LIST_OWNED : GBA_POKEDEX_LIST_SEEN, 0, SPECIES_COUNT);
 }
 
 gba_item_slot_t *item_slot(gba_save_t *save, gba_item_pocket_t pocket, uint16_t item) {
-	uint16_t const max = gba_get_pocket_size(save, pocket);
-	gba_item_slot_t *out = NULL;
-	for(uint16_t i = 0; i < max; i++) {
-		gba_item_slot_t *slot = gba_get_pocket_item(save, pocket, i);
-		if(slot->index == item && slot->amount) {
-			out = slot;
-			break;
-		}
-		if((!slot->index || !slot->amount) && !out) {
-			slot->index = item;
-			slot->amount = 0;
-			out = slot;
-			// Don't break, try to find the existing slot for this item.
-		}
-	}
+	gba_bag_t bag;
+	if(gba_bag_build(&bag, save) || (size_t)pocket >= GBA_BAG_POCKETS) return NULL;
+	gba_item_slot_t *out = gba_bag_find(&bag, pocket, item);
+	if(out) return out;
+	// Not in the pocket yet, claim the first free slot.
+	uint64_t free = ~bag.used[pocket] & ((bag.size[pocket] >= 64 ? 0 : (uint64_t)1 << bag.size[pocket]) - 1);
+	if(!free) return NULL;
+	out = &bag.slots[pocket][__builtin_ctzll(free)];
+	out->index = item;
+	out->amount = 0;
 	return out;
 }
 
@@ -468,6 +614,15 @@ void fprint_stats(FILE *out, gba_save_t *save) {
 	fprintf(out, "  (not implemented)\n"); // TODO
 	(void)save;
 }
+// item_name() and move_name() have no name for ids past their tables, which a corrupt save can hold
+static char const *item_label(uint16_t const id) {
+	char const *const name = item_name(id);
+	return name ? name : "?";
+}
+static char const *move_label(uint16_t const id) {
+	char const *const name = move_name(id);
+	return name ? name : "?";
+}
 void fprint_party(FILE *out, gba_party_t *party) {
 	assert(party);
 	fprintf(out, "Party\n");
@@ -480,25 +635,23 @@ void fprint_party(FILE *out, gba_party_t *party) {
 		fprintf(out, "  %d: %-10s (%c) lv.%d HP:%d/%d %s\n",
 			i+1, name, pokemon_is_female(&p->box) ? 'F' : 'M', p->party.level,
 			p->party.stats.hp, p->party.stats.max_hp,
-			p->box.held_item ? items[p->box.held_item].name : "");
+			p->box.held_item ? item_label(p->box.held_item) : "");
 	}
 }
 void fprint_boxes(FILE *out, gba_save_t *save) {
 	assert(save);
 	fprintf(out, "Pokémon in PC\n");
 	gba_pc_t *pc = gba_get_pc(save);
-	bool pc_empty = true;
+	uint8_t counts[GBA_BOX_COUNT];
+	bool const pc_empty = !gba_pc_count_boxes(pc, counts);
 	for(uint32_t i = 0; i < numberof(pc->box); i++) {
-		pokemon_list list = list_init(save);
-		list_filter_by_box(&list, i);
-		if(!list.size) continue;
+		if(!counts[i]) continue;
 
 		char16_t tmp[GBA_BOX_NAME_LENGTH];
 		char name[GBA_BOX_NAME_LENGTH];
 		gba_text_to_ucs2(tmp, pc->name[i], GBA_BOX_NAME_LENGTH);
 		utf8_from_ucs2(name, tmp, GBA_BOX_NAME_LENGTH);
-		fprintf(out, "  %-9s %2u Pokémon\n", name, (unsigned)list.size);
-		pc_empty = false;
+		fprintf(out, "  %-9s %2u Pokémon\n", name, (unsigned)counts[i]);
 	}
 	if(pc_empty) fprintf(out, "  (none)\n");
 }
@@ -520,37 +673,39 @@ void fprint_pokemon_summary(FILE *out, pk3_t *full, pk3_box_t *in_box) {
 	fprintf(out, "%s (%c), lv.%d HP:%d/%d %s\n", // TODO: Improve this format.
 		name, pokemon_is_female(&p->box) ? 'F' : 'M', p->party.level,
 		p->party.stats.hp, p->party.stats.max_hp,
-		p->box.held_item ? items[p->box.held_item].name : "");
+		p->box.held_item ? item_label(p->box.held_item) : "");
 
 	fprintf(out, "Moves\n");
 	for(uint8_t i = 0; i < 4; i++) {
 		fprintf(out, "  %u: %-15s PP:%d/%d\n",
-			i+1, moves[p->box.move[i]].name,
-			(int)p->box.move_pp[i], (int)moves[p->box.move[i]].pp);
+			i+1, move_label(p->box.move[i]),
+			(int)p->box.move_pp[i], (int)move_pp(p->box.move[i]));
 	}
 }
 void fprint_items(FILE *out, gba_save_t *save) {
 	assert(save);
-	for(uint8_t i = 0; i < numberof(pockets); i++) {
-		bool pocket_empty = true;
-		fprintf(out, "%s\n", pockets[i].label);
-		for(size_t j = 0; j < gba_get_pocket_size(save, (gba_item_pocket_t)i); j++) {
-			gba_item_slot_t *slot = gba_get_pocket_item(save, (gba_item_pocket_t)i, j);
-			if(!slot->index || !slot->amount) continue; // TODO: break?
-			fprintf(out, "  %3u x %s\n", (unsigned)slot->amount, items[slot->index].name);
-			pocket_empty = false;
+	gba_bag_t bag;
+	if(gba_bag_build(&bag, save)) return;
+	for(uint8_t i = 0; i < POCKETS_COUNT; i++) {
+		fprintf(out, "%s\n", pocket_label(i));
+		for(uint64_t used = bag.used[i]; used; used &= used - 1) {
+			gba_item_slot_t *slot = &bag.slots[i][__builtin_ctzll(used)];
+			fprintf(out, "  %3u x %s\n", (unsigned)slot->amount, item_label(slot->index));
 		}
-		if(pocket_empty) fprintf(out, "  (none)\n");
-		if(i+1 < numberof(pockets)) fprintf(out, "\n");
+		if(!bag.used[i]) fprintf(out, "  (none)\n");
+		if(i+1 < POCKETS_COUNT) fprintf(out, "\n");
 	}
 }
 void fprint_pokedex(FILE *out, gba_save_t *save) {
 	fprintf(out, "Pokédex (%u owned / %u seen)\n", pokedex_count(save, 'O'), pokedex_count(save, 'S'));
-	for(size_t i = 1; i < numberof(species); i++) {
-		bool owned = gba_pokedex_get_owned(save, i-1);
-		bool seen = gba_pokedex_get_seen(save, i-1);
+	uint8_t owned_bits[GBA_POKEDEX_BYTES], seen_bits[GBA_POKEDEX_BYTES];
+	gba_pokedex_export(save, GBA_POKEDEX_LIST_OWNED, owned_bits);
+	gba_pokedex_export(save, GBA_POKEDEX_LIST_SEEN, seen_bits);
+	for(size_t i = 1; i < SPECIES_COUNT; i++) {
+		bool owned = (owned_bits[(i-1) / 8] >> ((i-1) % 8)) & 1;
+		bool seen = (seen_bits[(i-1) / 8] >> ((i-1) % 8)) & 1;
 		if(!(owned || seen)) continue;
-		fprintf(out, "  %c %c %03zu %s\n", owned ? 'O' : ' ', seen ? 'S' : ' ', i, species[i].name);
+		fprintf(out, "  %c %c %03zu %s\n", owned ? 'O' : ' ', seen ? 'S' : ' ', i, species_name(i));
 	}
 }
 void fprint_save(FILE *out, gba_save_t *save) {
@@ -605,28 +760,32 @@ void fprint_hex(FILE *out, char const *buf, size_t len) {
 	if(0 != len % 24) fprintf(out, "\n");
 }
 
-unsigned char *_data = NULL;
-gba_save_t *_save = NULL;
-void save_close(void) {
-	if(_save) { gba_free_save(_save); _save = NULL; }
-	mmap_close(_data); _data = NULL;
+// An open save file. Nothing here is global, so several can be open at once.
+typedef struct {
+	unsigned char *data;
+	gba_save_t *save;
+} save_session;
+
+void save_close(save_session *s) {
+	if(s->save) { gba_free_save(s->save); s->save = NULL; }
+	mmap_close(s->data); s->data = NULL;
 }
-int save_open(char const *path) {
-	if(_data || _save) save_close();
+int save_open(save_session *s, char const *path) {
+	if(s->data || s->save) save_close(s);
 	if(!path) return 0;
-	_data = mmap_open(path);
-	if(!_data) return -1;
-	_save = gba_read_main_save(_data);
-	if(!_save) { save_close(); return -1; }
-	save_encrypt_all(_save, 0);
+	s->data = mmap_open(path);
+	if(!s->data) return -1;
+	s->save = gba_read_main_save(s->data);
+	if(!s->save) { save_close(s); return -1; }
+	save_encrypt_all(s->save, 0);
 	return 0;
 }
-int save_store(void) {
-	save_encrypt_all(_save, 1); // TODO: Build this into the API? Is it safe?
-	gba_save_game(_data, _save);
-	gba_save_game(_data, _save); // TODO: For some reason saving once doesn't work?
+int save_store(save_session *s) {
+	save_encrypt_all(s->save, 1); // TODO: Build this into the API? Is it safe?
+	gba_save_game(s->data, s->save);
+	gba_save_game(s->data, s->save); // TODO: For some reason saving once doesn't work?
 	// TODO: fsync?
-	save_encrypt_all(_save, 0);
+	save_encrypt_all(s->save, 0);
 	return 0;
 }
 
@@ -640,9 +799,13 @@ int main(int argc, char *argv[]) {
 		fprintf(stderr, "\n");
 		return -1;
 	}
-	save_open(argv[1]);
-	fprint_save(stdout, _save);
-	save_close();
+	save_session s = {0};
+	if(save_open(&s, argv[1]) < 0) {
+		fprintf(stderr, "Can't open %s\n", argv[1]);
+		return -1;
+	}
+	fprint_save(stdout, s.save);
+	save_close(&s);
 	return 0;
 }
 #endif
@@ -0,0 +1,164 @@
+// Generates build/pokemon_data_hash.h, the name lookup tables for src/pokemon_data.c.
+// Run by `make`, there should be no need to run it by hand.
+
+// Keys are the tokens from the X-macros plus the normalized display names, each mapped to an id.
+// They are placed with "hash and displace": keys are split into buckets by one half of their
+// hash, then each bucket (largest first) gets the smallest seed that puts all of its keys into
+// free slots. A lookup is one hash of the normalized name, one seed load and one string compare.
+
+#define POKEMON_DATA_HASH_GENERATOR
+#include "../src/pokemon_data.c"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define numberof(x) (sizeof(x) / sizeof(*x))
+
+enum {
+	KEYS_MAX = 512,
+	KEYS_PER_BUCKET = 4,
+	SEED_MAX = UINT16_MAX,
+};
+
+typedef struct {
+	char key[POKEMON_DATA_KEY_MAX];
+	uint64_t hash;
+	uint16_t id;
+} entry_t;
+
+typedef struct {
+	char const *name;
+	size_t count;
+	entry_t entries[KEYS_MAX];
+} table_t;
+
+static void table_add(table_t *const t, uint16_t const id, char const *const str) {
+	assert(t->count < KEYS_MAX);
+	entry_t *const e = &t->entries[t->count];
+	size_t const len = pokemon_data_normalize(e->key, sizeof(e->key), str);
+	assert(len);
+	for(size_t i = 0; i < t->count; i++) {
+		if(0 == strcmp(t->entries[i].key, e->key)) return; // First (lowest id) wins.
+	}
+	e->hash = pokemon_data_hash(e->key, len);
+	e->id = id;
+	t->count++;
+}
+
+static size_t bucket_of(table_t const *const t, entry_t const *const e, size_t const buckets) {
+	(void)t;
+	return (e->hash >> 32) % buckets;
+}
+
+static void table_print(FILE *const out, table_t const *const t) {
+	size_t const size = t->count;
+	size_t const buckets = (size + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+	size_t *const order = calloc(buckets, sizeof(*order));
+	size_t *const fill = calloc(buckets, sizeof(*fill));
+	uint16_t *const seed = calloc(buckets, sizeof(*seed));
+	int32_t *const slot_entry = calloc(size, sizeof(*slot_entry));
+	uint32_t *const slots = calloc(size, sizeof(*slots));
+	assert(order && fill && seed && slot_entry && slots);
+	for(size_t i = 0; i < size; i++) fill[bucket_of(t, &t->entries[i], buckets)]++;
+	for(size_t i = 0; i < size; i++) slot_entry[i] = -1;
+	for(size_t i = 0; i < buckets; i++) order[i] = i;
+	for(size_t i = 0; i < buckets; i++) { // Largest buckets first, they are hardest to place.
+		for(size_t j = i+1; j < buckets; j++) {
+			if(fill[order[j]] > fill[order[i]]) { size_t const x = order[i]; order[i] = order[j]; order[j] = x; }
+		}
+	}
+	for(size_t i = 0; i < buckets; i++) {
+		size_t const b = order[i];
+		if(!fill[b]) break;
+		bool placed = false;
+		for(uint32_t s = 0; s <= SEED_MAX && !placed; s++) {
+			size_t n = 0;
+			bool ok = true;
+			for(size_t e = 0; e < size && ok; e++) {
+				if(bucket_of(t, &t->entries[e], buckets) != b) continue;
+				uint32_t const x = pokemon_data_hash_slot(t->entries[e].hash, s, size);
+				if(slot_entry[x] >= 0) ok = false;
+				for(size_t k = 0; k < n && ok; k++) if(slots[k] == x) ok = false;
+				slots[n++] = x;
+			}
+			if(!ok) continue;
+			n = 0;
+			for(size_t e = 0; e < size; e++) {
+				if(bucket_of(t, &t->entries[e], buckets) != b) continue;
+				slot_entry[slots[n++]] = (int32_t)e;
+			}
+			seed[b] = (uint16_t)s;
+			placed = true;
+		}
+		if(!placed) {
+			fprintf(stderr, "pokemon-data-hash: no seed found for %s bucket %zu\n", t->name, b);
+			exit(1);
+		}
+	}
+
+	fprintf(out, "static uint16_t const %s_hash_seed[%zu] = {", t->name, buckets);
+	for(size_t i = 0; i < buckets; i++) fprintf(out, "%s%u,", i % 16 ? " " : "\n\t", seed[i]);
+	fprintf(out, "\n};\n");
+	fprintf(out, "static uint16_t const %s_hash_id[%zu] = {", t->name, size);
+	for(size_t i = 0; i < size; i++) fprintf(out, "%s%u,", i % 16 ? " " : "\n\t", t->entries[slot_entry[i]].id);
+	fprintf(out, "\n};\n");
+	fprintf(out, "static uint16_t const %s_hash_key[%zu] = {", t->name, size);
+	size_t offset = 0;
+	for(size_t i = 0; i < size; i++) {
+		fprintf(out, "%s%zu,", i % 16 ? " " : "\n\t", offset);
+		offset += strlen(t->entries[slot_entry[i]].key)+1;
+	}
+	assert(offset <= UINT16_MAX);
+	fprintf(out, "\n};\n");
+	fprintf(out, "static char const %s_hash_keys[%zu] =", t->name, offset);
+	for(size_t i = 0; i < size; i++) fprintf(out, "\n\t\"%s\\0\"", t->entries[slot_entry[i]].key);
+	fprintf(out, ";\n\n");
+
+	free(order); free(fill); free(seed); free(slot_entry); free(slots);
+}
+
+static table_t tables[4];
+
+int main(void) {
+	table_t *const s = &tables[0], *const m = &tables[1], *const i = &tables[2], *const l = &tables[3];
+	s->name = "species"; m->name = "moves"; i->name = "items"; l->name = "locations";
+	// Tokens first, so a display name can never shadow another entry's token.
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) table_add(s, id, #token);
+	SPECIES(XX)
+#undef XX
+#define XX(id, token, nameCaps, name, hp, atk, def, spd, satk, sdef) table_add(s, id, name);
+	SPECIES(XX)
+#undef XX
+#define XX(id, token, name, pp) table_add(m, id, #token);
+	MOVES(XX)
+#undef XX
+#define XX(id, token, name, pp) table_add(m, id, name);
+	MOVES(XX)
+#undef XX
+#define XX(id, token, name) table_add(i, id, #token);
+	ITEMS(XX)
+#undef XX
+#define XX(id, token, name) table_add(i, id, name);
+	ITEMS(XX)
+#undef XX
+#define XX(id, token, name) table_add(l, id, #token);
+	LOCATIONS(XX)
+#undef XX
+#define XX(id, token, name) table_add(l, id, name);
+	LOCATIONS(XX)
+#undef XX
+
+	FILE *const out = stdout;
+	fprintf(out, "// Generated by tools/pokemon-data-hash.c from pokemon_data.h, do not edit.\n\n");
+	for(size_t t = 0; t < numberof(tables); t++) table_print(out, &tables[t]);
+	fprintf(out, "#define POKEMON_DATA_HASHES(XX) \\\n");
+	for(size_t t = 0; t < numberof(tables); t++) {
+		size_t const size = tables[t].count;
+		fprintf(out, "\tXX(%s, %zu, %zu)%s\n", tables[t].name, (size + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET, size, t+1 < numberof(tables) ? " \\" : "");
+	}
+	return 0;
+}